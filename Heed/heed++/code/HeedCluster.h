@@ -27,7 +27,9 @@ class HeedCluster: public RegPassivePtr
 };
 
 //extern AbsList< HeedCluster > cluster_bank;  // only for histograms
-extern BlkArr< HeedCluster > cluster_bank; 
+// Cluster bank of the track which is currently being processed
+// (set by the interface before calling the tracking)
+extern BlkArr< HeedCluster >* cluster_bank; 
 
 
 
@@ -219,7 +219,7 @@ void HeedParticle::physics(void)
               {
                 mcout<<"generating new cluster\n";
               }
-              cluster_bank.append
+              cluster_bank->append
                 ( HeedCluster( transferred_energy[qtransfer-1],
                                0,
                                pt,
@@ -228,8 +228,8 @@ void HeedParticle::physics(void)
                                na,
                                ns));
               /*
-                cluster_bank.insert_after
-                ( cluster_bank.get_last_node(),
+                cluster_bank->insert_after
+                ( cluster_bank->get_last_node(),
                 HeedCluster( transferred_energy[qtransfer-1],
                 0,
                 pt,
@@ -282,7 +282,7 @@ void HeedParticle::physics(void)
               ActivePtr< gparticle > ac;
               ac.put(&hp);
               
-              particle_bank.insert_after( particle_bank.get_last_node(), ac);
+              particle_bank->insert_after( particle_bank->get_last_node(), ac);
             }
           }
         }
@@ -273,7 +273,7 @@ void HeedParticle_BGM::physics(void)
 	      {
 		mcout<<"generating new cluster\n";
 	      }
-	      cluster_bank.append
+	      cluster_bank->append
 		( HeedCluster( transferred_energy[qtransfer-1],
 			       0,
 			       pt,
@@ -282,8 +282,8 @@ void HeedParticle_BGM::physics(void)
 			       na,
 			       ns));
 	      /*
-		cluster_bank.insert_after
-		( cluster_bank.get_last_node(),
+		cluster_bank->insert_after
+		( cluster_bank->get_last_node(),
 		HeedCluster( transferred_energy[qtransfer-1],
 		0,
 		pt,
@@ -333,7 +333,7 @@ void HeedParticle_BGM::physics(void)
 	      ActivePtr< gparticle > ac;
 	      ac.put(&hp);
 	      
-	      particle_bank.insert_after( particle_bank.get_last_node(), ac);
+	      particle_bank->insert_after( particle_bank->get_last_node(), ac);
 	    }
 	  }
 	}
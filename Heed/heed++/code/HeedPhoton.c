@@ -242,7 +242,7 @@ void HeedPhoton::physics_after_new_speed(void)
 				    vel,
 				    currpos.time,
 				    particle_number) );
-      particle_bank.insert_after(particle_bank.get_last_node(), ac);
+      particle_bank->insert_after(particle_bank->get_last_node(), ac);
     }
     long qph = ph_energy.get_qel();
     long nph;
@@ -263,7 +263,7 @@ void HeedPhoton::physics_after_new_speed(void)
 			      currpos.time,
 			      particle_number,
 			      ph_energy[nph]) );
-      particle_bank.insert_after(particle_bank.get_last_node(), ac);
+      particle_bank->insert_after(particle_bank->get_last_node(), ac);
     }
     s_delta_generated = 1;
     s_life = 0;
@@ -7,7 +7,7 @@ void treat_particle_bank(int s_erase)
   AbsListNode< ActivePtr< gparticle > >* aln;
   AbsListNode< ActivePtr< gparticle > >* aln1;
 
-  aln = particle_bank.get_first_node();
+  aln = particle_bank->get_first_node();
   while(aln != NULL)
   {
     /*
@@ -33,7 +33,7 @@ void treat_particle_bank(int s_erase)
     //aln->el.print(mcout, 2);
     //RegPassivePtr::s_allow_delete_with_references = 1;
     if(s_erase == 1)
-      particle_bank.erase(aln);
+      particle_bank->erase(aln);
     //RegPassivePtr::s_allow_delete_with_references = 0;
     aln = aln1;
   }
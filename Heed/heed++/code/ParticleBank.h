@@ -4,7 +4,9 @@
 #include "wcpplib/safetl/AbsList.h"
 #include "wcpplib/geometry/gparticle.h"
 
-extern AbsList< ActivePtr< gparticle > > particle_bank;
+// Particle bank of the track which is currently being processed
+// (set by the interface before calling the tracking)
+extern AbsList< ActivePtr< gparticle > >* particle_bank;
 
 
 
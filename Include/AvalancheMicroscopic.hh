@@ -5,14 +5,21 @@
 
 #include <vector>
 #include <string>
+#include <map>
+#include <utility>
 
 #include <TH1.h>
 
 #include "Sensor.hh"
 #include "ViewDrift.hh"
+#include "SpatialHash.hh"
+#include "DriftLinePool.hh"
+#include "RecombinationStatistics.hh"
 
 namespace Garfield {
 
+class AvalancheMC;
+
 class AvalancheMicroscopic {
 
   public:
@@ -72,6 +79,105 @@ class AvalancheMicroscopic {
     void EnableNullCollisionSteps()  {useNullCollisionSteps = true;}
     void DisableNullCollisionSteps() {useNullCollisionSteps = false;}
 
+    // Set the factor by which the null-collision rate is increased
+    // in cloud transport (default: 10)
+    void SetNullCollisionRateFactor(const double f);
+    // Switch on/off adaptive null-collision rate factor in cloud transport:
+    // the factor is fmax for electrons closer than r Onsager radii to an ion
+    // or in a cloud field larger than a fraction ratio of the external field,
+    // and decreases to 1 (no increase) away from other charges
+    void EnableAdaptiveNullCollisionRate(const double fmax = 10., 
+                                         const double r = 3.,
+                                         const double ratio = 0.1);
+    void DisableAdaptiveNullCollisionRate() {useAdaptiveNullRate = false;}
+    // Transport each cloud twice (fixed and adaptive factor)
+    // and compare the fractions of recombined electrons
+    void EnableNullCollisionRateValidation()  {validateNullRate = true;}
+    void DisableNullCollisionRateValidation() {validateNullRate = false;}
+    // Number of steps, mean null-collision rate factor and fraction of steps
+    // with the max. factor in the last cloud transport
+    void GetNullCollisionRateStatistics(int& nSteps, double& mean,
+                                        double& fractionMax) const;
+    // Forget the null-collision rates kept from previous transport calls
+    void ResetNullCollisionRates() {nullCollisionRates.clear();}
+
+    // Switch on/off lockstep transport of clouds: all electrons/holes
+    // are advanced to the end of a common time slice, with the field
+    // of the cloud frozen at the start of the slice; the slice width is
+    // at most dtmax [ns] and such that no electron/hole travels more than 
+    // a fraction f of the length over which its cloud field varies
+    void EnableTimeSlices(const double dtmax, const double f = 0.1);
+    void DisableTimeSlices() {useTimeSlices = false;}
+    // Transport each cloud twice (oldest electron first and lockstep)
+    // and compare the fractions of recombined electrons
+    void EnableTimeSliceValidation()  {validateTimeSlices = true;}
+    void DisableTimeSliceValidation() {validateTimeSlices = false;}
+    // Number of time slices in the last cloud transport
+    int GetNumberOfTimeSlices() const {return nTimeSlices;}
+
+    // Switch on/off split evaluation of the cloud field: the charges 
+    // closer than r [cm] to an electron/hole are summed at every step,
+    // the potential of the other charges is only re-evaluated when other
+    // electrons/holes have moved, charges have been added or the 
+    // electron/hole has moved by more than a fraction f of r 
+    // (not used in lockstep mode)
+    void EnableMultiRateCloudField(const double r, const double f = 0.1);
+    void DisableMultiRateCloudField() {useMultiRateField = false;}
+    // Number of evaluations and of skipped evaluations of the far field
+    // in the last cloud transport
+    void GetFarFieldStatistics(int& nEvaluations, int& nSkipped) const;
+
+    // Counters and cycle timers of the transport loops, reset at each call 
+    // of DriftElectron, AvalancheElectron and AvalancheCloud; they are 
+    // only filled if the library is compiled with -DGARFIELD_INSTRUMENTATION
+    struct instrumentation {
+      // Real and null collisions
+      long nRealCollisions;
+      long nNullCollisions;
+      // Evaluations of the electric field of the sensor
+      long nFieldEvaluations;
+      // Pairs of charges summed in the cloud field
+      long nCloudPairs;
+      // Increases of the null-collision rate during a free flight
+      long nRateIncreases;
+      // Steps for which the cloud field was too high and discarded
+      long nClamps;
+      // Electrons/holes removed from the stack
+      long nErasures;
+      // Cycles spent in the evaluation of the electric field, 
+      // of the cloud field, in the free flights, the collisions 
+      // and the output (movie frames)
+      double cyclesField;
+      double cyclesCloud;
+      double cyclesFlight;
+      double cyclesCollision;
+      double cyclesOutput;
+    };
+    const instrumentation& GetInstrumentation() const {return counters;}
+    // Check if the counters are compiled in
+    static bool HasInstrumentation();
+    // Write the counters to a file in JSON format
+    bool WriteInstrumentation(const std::string& filename) const;
+
+    // Statistics of the end points of the clouds transported 
+    // by AvalancheCloud since the last reset
+    RecombinationStatistics* GetRecombinationStatistics() {return &recombStats;}
+    void ResetRecombinationStatistics() {recombStats.Reset();}
+    bool WriteRecombinationSummary(const std::string& filename) const {
+      return recombStats.WriteSummary(filename);
+    }
+
+    // Stop the cloud transport once all remaining electrons are farther
+    // than k Onsager radii from every ion and their potential energy
+    // is below f kT; they are then retired with status StatusEscaped
+    void EnableEscapeCriterion(const double k = 10., const double f = 1.);
+    void DisableEscapeCriterion() {useEscapeCriterion = false;}
+    // Drift the escaped electrons to their end points 
+    // (e. g. with drift velocity and diffusion from a gas table)
+    // instead of stopping them where they are
+    void SetEscapeDrift(AvalancheMC* drift) {escapeDrift = drift;}
+    void UnsetEscapeDrift() {escapeDrift = 0;}
+
     // Set/get energy threshold for electron transport
     // (useful for delta electrons)
     void   SetElectronTransportCut(const double cut) {deltaCut = cut;}
@@ -127,6 +233,22 @@ class AvalancheMicroscopic {
                 double& x1, double& y1, double& z1, double& t1, double& e1,
                 double& dx1, double& dy1, double& dz1,
                 int& status) const;
+    // Columns of the electron end point table
+    enum EndpointColumn {
+      EndpointX0 = 0, EndpointY0, EndpointZ0, EndpointT0, EndpointE0,
+      EndpointPotential0, EndpointMdi0,
+      EndpointX1, EndpointY1, EndpointZ1, EndpointT1, EndpointE1,
+      EndpointPotential1, EndpointMdi, EndpointMdiMax,
+      EndpointXIon, EndpointYIon, EndpointZIon,
+      nEndpointColumns
+    };
+    // Get one column of the electron end point table (one entry per 
+    // end point, in the order of GetElectronEndpoint); only the requested 
+    // columns are filled, and the pointers remain valid until the next 
+    // call of DriftElectron, AvalancheElectron or AvalancheCloud
+    const double* GetElectronEndpointColumn(const int column);
+    const int* GetElectronEndpointIds();
+    const int* GetElectronEndpointStatus();
     int GetNumberOfElectronDriftLinePoints(const int i = 0) const;
     int GetNumberOfHoleDriftLinePoints(const int i = 0) const;
     void GetElectronDriftLinePoint(double& x, double& y, double& z, 
@@ -198,10 +320,6 @@ class AvalancheMicroscopic {
 
     Sensor* sensor;
 
-    struct point {
-      double x, y, z, t;
-    };
-
     struct electron {
       // Status
       int status;
@@ -223,17 +341,27 @@ class AvalancheMicroscopic {
       // Current kinetic energy and potential energy
       // megan: added current potential energy
       double energy, potential;
-      // Drift line
-      std::vector<point> driftLine;
+      // Drift line (index in the pool, -1 if there are no points)
+      int driftLine;
       double xLast, yLast, zLast;
       // megan: added Electron ID (number in cloud of size n, from 1 to n)
       int id;
       // megan: added mdi to store minDistIon and mdimax to store max distance from any ion
       double mdi0, mdi, mdimax;
+      // Cloud potential (at the position and at the displaced points
+      // used for the field) frozen at the start of the time slice
+      double cloudPotential[4];
+      bool frozen;
     };
     std::vector<electron> stack;
     std::vector<electron> endpointsElectrons;
     std::vector<electron> endpointsHoles;
+    // Points of the drift lines of the current event
+    DriftLinePool driftLines;
+    // Columns of the electron end point table (filled on request)
+    std::vector<std::vector<double> > endpointColumns;
+    std::vector<int> endpointIds;
+    std::vector<int> endpointStatus;
 
     int nPhotons;
     struct photon {
@@ -283,13 +411,67 @@ class AvalancheMicroscopic {
     bool useBandStructureDefault;
     bool useNullCollisionSteps;
     bool useBfield;
+
+    // Null-collision rate factor in cloud transport
+    double nullRateFactor;
+    bool useAdaptiveNullRate;
+    double nullRateFactorMax;
+    double nullRateDistance;
+    double nullRateFieldRatio;
+    bool validateNullRate;
+    // Statistics of the null-collision rate factor
+    int nNullRateSteps;
+    int nNullRateStepsMax;
+    double sumNullRateFactor;
+
+    // Lockstep cloud transport
+    bool useTimeSlices;
+    double timeSliceMax;
+    double timeSliceFraction;
+    bool validateTimeSlices;
+    int nTimeSlices;
+
+    // Split (near/far) evaluation of the cloud field
+    bool useMultiRateField;
+    double multiRateDistance;
+    double multiRateTolerance;
+    int nFarFieldEvaluations;
+    int nFarFieldSkipped;
+
+    // Counters and timers of the last transport call
+    instrumentation counters;
+
+    // Null-collision rate (majorant of the collision rate) 
+    // per medium and band, kept between transport calls
+    struct nullCollisionRate {
+      // Null-collision rate of the medium when the majorant was set
+      double fMedium;
+      // Max. energy covered
+      double eMax;
+      // Majorant
+      double fLim;
+    };
+    std::map<std::pair<int, int>, nullCollisionRate> nullCollisionRates;
+
+    // Exponential variates (unit mean) for the free-flight times, 
+    // sampled in batches (only used with -DGARFIELD_FAST_MATH)
+    std::vector<double> expVariates;
+    int nextExpVariate;
+    double RndmExponential() {
+      if (nextExpVariate >= (int)expVariates.size()) FillExpVariates();
+      return expVariates[nextExpVariate++];
+    }
+    void FillExpVariates();
+
+    // Statistics of recombined/escaped electrons
+    RecombinationStatistics recombStats;
+
+    // Escape criterion
+    bool useEscapeCriterion;
+    double escapeDistance;
+    double escapePotential;
+    AvalancheMC* escapeDrift;
  
-    // Rotation matrices
-    double rb11, rb12, rb13;
-    double rb21, rb22, rb23;
-    double rb31, rb32, rb33;
-    double rx22, rx23, rx32, rx33;
-    
     // Transport cuts
     double deltaCut;
     double gammaCut;
@@ -324,31 +506,144 @@ class AvalancheMicroscopic {
     // Switch on/off debugging messages
     bool debug;
 
+    // Free flight of an electron/hole between two (real or null) collisions
+    struct flight {
+      // Position and time at the start (for the user step procedure)
+      double x, y, z, t;
+      bool hole;
+      // Energy, direction (or wave vector) and velocity at the start
+      double energy;
+      int band;
+      double kx, ky, kz;
+      double vx, vy, vz;
+      // Electric and magnetic field
+      double ex, ey, ez;
+      double bx, by, bz, bmag;
+      // Duration, energy and direction at the end of the flight
+      double dt;
+      double newEnergy;
+      double newKx, newKy, newKz;
+      // Flight ended with a null collision
+      bool isNull;
+      // Number of times the null-collision rate had to be increased
+      int nRateIncreases;
+    };
+    // Equations of motion used in the free flight
+    enum StepType {
+      StepElectricField = 0,
+      StepMagneticField,
+      StepBandStructure
+    };
+    // Sample the duration of a free flight (null-collision method)
+    // and compute the energy, direction and mean velocity after it;
+    // instantiated once per step type so that the inner loop is 
+    // free of branches on the transport options
+    template <int type>
+    bool Flight(flight& f, Medium* medium, double& fLim, 
+                const char* caller);
+
+    // Output options of the transport loops (induced signal, 
+    // drift lines and collision markers), passed as template arguments 
+    // so that the loops of the configurations without them are free 
+    // of the corresponding branches
+    struct noSignal;
+    struct withSignal;
+    struct noPlotting;
+    struct withPlotting;
+
     // Electron transport
+    // (selects the instantiation of TransportElectronLoop)
     bool TransportElectron(
         const double x0, const double y0, const double z0, 
         const double t0, const double e0,
         const double dx0, const double dy0, const double dz0, 
         const bool aval, bool hole);
+    template <class signalPolicy, class plottingPolicy>
+    bool TransportElectronLoop(
+        const double x0, const double y0, const double z0, 
+        const double t0, const double e0,
+        const double dx0, const double dy0, const double dz0, 
+        const bool aval, bool hole);
 
     // Cloud of ionizations transport
+    // (selects the instantiation of TransportCloudLoop)
     bool TransportCloud(
 	const int nIonization, 
 	const double x0[], const double y0[], const double z0[], 
         const double t0[], const double e0[],
         const double dx0[], const double dy0[], const double dz0[], 
         const bool aval, bool hole, bool deBroglieRecomb, const double movieframetime[], const int numberofmovieframes);
+    template <class signalPolicy, class plottingPolicy>
+    bool TransportCloudLoop(
+	const int nIonization, 
+	const double x0[], const double y0[], const double z0[], 
+        const double t0[], const double e0[],
+        const double dx0[], const double dy0[], const double dz0[], 
+        const bool aval, bool hole, bool deBroglieRecomb, const double movieframetime[], const int numberofmovieframes);
+    // Fill a spatial hash table with the positions of the ions in the stack
+    void FillIonTable(SpatialHash& ions) const;
+    // Potential (for a positive charge) of the ions and electrons/holes 
+    // in the stack, except iE, at (x, y, z) and at points displaced by d; 
+    // also returns the distance to the closest charge
+    void ComputeCloudPotential(const int iE,
+                               const double x, const double y, const double z,
+                               const double eps, const double d,
+                               double& p, double& px, double& py, double& pz,
+                               double& rmin) const;
+    // Add the potential of a charge q [e] at (xc, yc, zc); returns 
+    // the distance to (x, y, z)
+    double AddChargePotential(const double q, const double xc, 
+                              const double yc, const double zc,
+                              const double x, const double y, const double z,
+                              const double eps, const double d,
+                              double& p, double& px, 
+                              double& py, double& pz) const;
+    // Potential of the charges farther than the multi-rate distance 
+    // from (x, y, z) (four values as in ComputeCloudPotential), 
+    // and indices of the closer ions and electrons/holes
+    void ComputeFarPotential(const int iE,
+                             const double x, const double y, const double z,
+                             const double eps, const double d,
+                             double* pFar,
+                             std::vector<int>& nearIons,
+                             std::vector<int>& nearElectrons) const;
+    // Add the potential of the closer charges
+    void ComputeNearPotential(const double x, const double y, const double z,
+                              const double eps, const double d,
+                              const std::vector<int>& nearIons,
+                              const std::vector<int>& nearElectrons,
+                              double& p, double& px, 
+                              double& py, double& pz) const;
+    // Freeze the cloud potential of all electrons/holes in the stack
+    // and return the width of the next time slice
+    double FreezeCloudField(const double eps, const double d);
+    // Null-collision rate factor for a given distance to the closest ion
+    // and field of the cloud
+    double ComputeNullRateFactor(const double rIon, const double rOnsager,
+                                 const double eCloud, const double eExt);
+    // Fraction of electrons/holes which have recombined
+    double GetRecombinationFraction(const int nIonization) const;
+    // Add the end points of the last cloud to the statistics
+    void FillRecombinationStatistics();
+    // Check if all electrons/holes in the stack have escaped from the ions
+    bool CheckEscape(const double rOnsager, const double kT) const;
+    // Move the electrons/holes in the stack to the list of end points
+    void RetireEscaped();
+
+    void ResetInstrumentation();
+    void ClearEndpointColumns();
+    // Get the null-collision rate for a medium and band, valid up to 
+    // a max. energy eMax (the collision rate table of the medium is 
+    // extended if needed)
+    double GetNullCollisionRate(Medium* medium, const int band, 
+                                const double eMax);
+    // Keep a null-collision rate which had to be increased during a flight
+    void RaiseNullCollisionRate(Medium* medium, const int band, 
+                                const double fLim);
 
     // Photon transport
     void TransportPhoton(const double x, const double y, const double z,
                          const double t, const double e);
-                         
-    void ComputeRotationMatrix(
-        const double bx, const double by, const double bz, const double bmag,
-        const double ex, const double ey, const double ez);       
-
-    void RotateGlobal2Local(double& dx, double& dy, double& dz);
-    void RotateLocal2Global(double& dx, double& dy, double& dz);
     
 };
 
@@ -0,0 +1,63 @@
+#ifndef G_BOUNDING_VOLUME_HIERARCHY_H
+#define G_BOUNDING_VOLUME_HIERARCHY_H
+
+#include <vector>
+
+namespace Garfield {
+
+// Binary tree of axis-aligned boxes, used to find the volumes
+// (solids, components) whose bounding box contains a given point.
+// Boxes are identified by the index passed to AddBox.
+
+class BoundingVolumeHierarchy {
+
+  public:
+    // Constructor
+    BoundingVolumeHierarchy();
+    // Destructor
+    ~BoundingVolumeHierarchy() {}
+
+    // Add a box with index i
+    void AddBox(const int i,
+                const double xmin, const double ymin, const double zmin,
+                const double xmax, const double ymax, const double zmax);
+    // Sort the boxes into a tree (to be called after the last AddBox)
+    void Build();
+    void Clear();
+    int GetNumberOfBoxes() const {return boxes.size();}
+
+    // Get the indices (larger than imin) of the boxes containing (x, y, z),
+    // in descending order
+    void FindBoxes(const double x, const double y, const double z,
+                   std::vector<int>& indices, const int imin = -1) const;
+
+  private:
+
+    // Max. number of boxes in a leaf
+    static const int nMaxLeaf = 4;
+
+    struct box {
+      double xmin, ymin, zmin;
+      double xmax, ymax, zmax;
+      int index;
+    };
+    std::vector<box> boxes;
+
+    struct node {
+      double xmin, ymin, zmin;
+      double xmax, ymax, zmax;
+      // Largest box index below this node
+      int imax;
+      // Children (inner node) or range of boxes (leaf)
+      int left, right;
+      int first, count;
+    };
+    std::vector<node> nodes;
+
+    int BuildNode(const int first, const int count);
+
+};
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef G_CLOUD_GENERATOR_H
+#define G_CLOUD_GENERATOR_H
+
+#include <vector>
+#include <string>
+
+namespace Garfield {
+
+class Track;
+class TrackHeed;
+class AvalancheMicroscopic;
+class CloudPartition;
+
+// Generate the initial electron-ion pairs for AvalancheCloud from the
+// clusters of an ionising track (TrackHeed, TrackPAI, TrackSimple, ...).
+// The electrons of a track are handed out in batches of bounded size,
+// in the order in which the clusters are produced along the track.
+
+class CloudGenerator {
+
+  public:
+    // Constructor
+    CloudGenerator();
+    // Destructor
+    ~CloudGenerator() {}
+
+    // Track model; with TrackHeed the positions of the individual
+    // conduction electrons of a cluster are used, with other track
+    // classes all electrons of a cluster are placed at its position.
+    void SetTrack(Track* t);
+    void SetTrack(TrackHeed* t);
+
+    // Initial energy of the electrons [eV] (if not provided by the track)
+    void SetInitialEnergy(const double e);
+    // Draw the initial energy from 1 / (E^2 + w^2) between 0 and emax
+    // (default: w = 7.6 eV, emax = 7 eV)
+    void SetEnergySpectrum(const double w, const double emax);
+
+    // Max. number of electron-ion pairs per batch
+    void SetBatchSize(const int n);
+    int GetBatchSize() const {return nBatchMax;}
+
+    // Start a new track
+    bool NewTrack(const double x0, const double y0, const double z0,
+                  const double t0,
+                  const double dx0, const double dy0, const double dz0);
+    // Fill the next batch of electrons; returns false if the track
+    // has no electrons left
+    bool NextBatch();
+
+    // Electrons in the current batch
+    int GetNumberOfElectrons() const {return xb.size();}
+    const double* GetX()  const {return xb.empty() ? 0 : &xb[0];}
+    const double* GetY()  const {return yb.empty() ? 0 : &yb[0];}
+    const double* GetZ()  const {return zb.empty() ? 0 : &zb[0];}
+    const double* GetT()  const {return tb.empty() ? 0 : &tb[0];}
+    const double* GetE()  const {return eb.empty() ? 0 : &eb[0];}
+    const double* GetDx() const {return dxb.empty() ? 0 : &dxb[0];}
+    const double* GetDy() const {return dyb.empty() ? 0 : &dyb[0];}
+    const double* GetDz() const {return dzb.empty() ? 0 : &dzb[0];}
+
+    // Number of batches and electrons handed out for the current track
+    int GetNumberOfBatches() const {return nBatches;}
+    int GetNumberOfPairs() const {return nPairs;}
+
+    // Split each batch into groups of pairs which are far apart from each
+    // other and transport the groups separately
+    void EnablePartitioning(CloudPartition* p);
+    void DisablePartitioning() {partition = 0;}
+
+    // Transport all electrons of the current track, batch by batch
+    bool Transport(AvalancheMicroscopic* aval, const bool deBroglieRecomb);
+
+    void EnableDebugging()  {debug = true;}
+    void DisableDebugging() {debug = false;}
+
+  private:
+
+    std::string className;
+
+    Track* track;
+    TrackHeed* trackHeed;
+
+    bool useSpectrum;
+    double energy;
+    double spectrumWidth;
+    double spectrumMax;
+
+    int nBatchMax;
+    CloudPartition* partition;
+    bool hasTrack;
+    int nBatches;
+    int nPairs;
+
+    // Electrons of the last cluster which have not been handed out yet
+    std::vector<double> xc, yc, zc, tc, ec, dxc, dyc, dzc;
+    int nUsed;
+
+    // Current batch
+    std::vector<double> xb, yb, zb, tb, eb, dxb, dyb, dzb;
+
+    bool debug;
+
+    bool NextCluster();
+    bool TransportGroups(AvalancheMicroscopic* aval, 
+                         const bool deBroglieRecomb);
+    double DrawEnergy() const;
+
+};
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef G_CLOUD_PARTITION_H
+#define G_CLOUD_PARTITION_H
+
+#include <vector>
+#include <string>
+
+namespace Garfield {
+
+// Split a cloud of electron-ion pairs into groups which can be transported
+// independently. Two pairs belong to the same group if they are connected
+// by a chain of pairs closer than the linking distance, which is a
+// multiple of the larger of the Onsager radius and the distance at which
+// the field of an elementary charge equals the external field.
+
+class CloudPartition {
+
+  public:
+    // Constructor
+    CloudPartition();
+    // Destructor
+    ~CloudPartition() {}
+
+    // Onsager radius [cm]
+    void SetOnsagerRadius(const double r);
+    // Magnitude of the external electric field [V/cm]
+    void SetElectricField(const double e);
+    // Relative permittivity of the medium
+    void SetDielectricConstant(const double eps);
+    // Linking distance in units of the interaction range (default: 10)
+    void SetDistanceFactor(const double k);
+    // Interaction range and linking distance [cm]
+    double GetInteractionRange() const;
+    double GetLinkingDistance() const {return distanceFactor * GetInteractionRange();}
+
+    // Assign the pairs at (x[i], y[i], z[i]) to groups;
+    // returns the number of groups
+    int Partition(const int n,
+                  const double x[], const double y[], const double z[]);
+    int GetNumberOfGroups() const {return nGroups;}
+    // Group of pair i
+    int GetGroup(const int i) const;
+    // Indices of the pairs in group g
+    void GetGroupMembers(const int g, std::vector<int>& members) const;
+
+    void EnableDebugging()  {debug = true;}
+    void DisableDebugging() {debug = false;}
+
+  private:
+
+    std::string className;
+
+    double onsagerRadius;
+    double field;
+    double dielectricConstant;
+    double distanceFactor;
+
+    int nGroups;
+    std::vector<int> groups;
+    // Pair indices sorted by group; the members of group g are
+    // groupMembers[groupOffsets[g]] ... groupMembers[groupOffsets[g + 1] - 1]
+    std::vector<int> groupOffsets;
+    std::vector<int> groupMembers;
+
+    bool debug;
+
+    struct cell {
+      int ix, iy, iz;
+      int index;
+      bool operator<(const cell& other) const {
+        if (ix != other.ix) return ix < other.ix;
+        if (iy != other.iy) return iy < other.iy;
+        if (iz != other.iz) return iz < other.iz;
+        return index < other.index;
+      }
+    };
+
+    static int Root(std::vector<int>& parent, int i);
+    void SortMembers();
+
+};
+
+}
+
+#endif
@@ -100,6 +100,13 @@ class ComponentAnalyticField : public ComponentBase {
     void EnableChargeCheck()  {chargeCheck = true;}
     void DisableChargeCheck() {chargeCheck = false;}
 
+    // Evaluate the field of cells without wires, tubes, dipoles and 
+    // point charges (e. g. two parallel planes) in closed form (default: on)
+    void EnableUniformFieldShortcut()  {useUniformShortcut = true;}
+    void DisableUniformFieldShortcut() {useUniformShortcut = false;}
+    // Is the field uniform in the region between the planes?
+    bool IsUniformCell();
+
     int GetNumberOfWires() {return nWires;}
     bool GetWire(const int i, 
                  double& x, double& y, double& diameter, 
@@ -120,6 +127,10 @@ class ComponentAnalyticField : public ComponentBase {
         
     bool cellset;
     bool sigset;
+
+    // Cell without wires, tubes and dipoles 
+    bool uniformCell;
+    bool useUniformShortcut;
     
     bool polar;
 
@@ -72,6 +72,10 @@ class ComponentBase {
     // Set a constant magnetic field 
     void SetMagneticField(const double bx, 
                           const double by, const double bz);
+    // Is the magnetic field the same everywhere?
+    // (to be overridden together with MagneticField)
+    virtual
+    bool HasUniformMagneticField() {return true;}
 
     // Ready for use?
     virtual
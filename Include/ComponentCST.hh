@@ -7,7 +7,6 @@
 #define G_COMPONENT_CST_H
 
 #include <vector>
-#include "TMatrixD.h"
 #include "ComponentFieldMap.hh"
 
 namespace Garfield {
@@ -60,8 +59,7 @@ class ComponentCST: public ComponentFieldMap {
     // Verify periodicities
     void UpdatePeriodicity();
     int FindElementCube(const double x, const double y, const double z,
-                        double& t1, double& t2, double& t3,
-                        TMatrixD* &jac, std::vector<TMatrixD*> &dN);
+                        double& t1, double& t2, double& t3);
     double GetElementVolume(const int i);
     void GetAspectRatio(const int i, double& dmin, double& dmax);
     static bool Greater(const double &a, const double &b) {return (a > b);};
@@ -69,7 +67,26 @@ class ComponentCST: public ComponentFieldMap {
     void GetNodesForElement(int element, std::vector<int> &nodes);
 
   private:
-    void ClearVec(std::vector<TMatrixD*> &vec);
+    // Element number for each cell of the grid
+    std::vector<int> m_elementIndex;
+    // Potentials and weighting potentials at the nodes
+    std::vector<double> m_potential;
+    std::vector<std::vector<double> > m_weightingPotential;
+    // Cell indices found in the previous call
+    int m_lastIx, m_lastIy, m_lastIz;
+
+    // Find the cell containing a point and the local coordinates [0, 1]
+    int FindCell(const double x, const double y, const double z,
+                 unsigned int& i, unsigned int& j, unsigned int& k,
+                 double& u, double& v, double& w);
+    static bool FindLine(const std::vector<double>& lines, const double x,
+                         int& index);
+    // Trilinear interpolation of a nodal quantity and its gradient
+    void Interpolate(const std::vector<double>& f,
+                     const unsigned int i, const unsigned int j,
+                     const unsigned int k,
+                     const double u, const double v, const double w,
+                     double& f0, double& fx, double& fy, double& fz);
 };
 
 struct PolygonInfo {
@@ -2,7 +2,6 @@
 #define G_COMPONENT_FIELD_MAP_H
 
 #include "ComponentBase.hh"
-#include "TMatrixD.h"
 
 namespace Garfield {
 
@@ -186,8 +185,7 @@ class ComponentFieldMap : public ComponentBase {
             double jac[4][4], double& det, int imap);
     // Calculate coordinates for a cube
     int CoordinatesCube(double x, double y, double z,
-            double& t1, double& t2, double& t3,
-            TMatrixD* &jac, std::vector<TMatrixD*> &dN, int imap);
+            double& t1, double& t2, double& t3, int imap);
 
     // Calculate Jacobian for curved quadratic triangles            
     void Jacobian3(int i, double u, double v, double w,
@@ -200,7 +198,7 @@ class ComponentFieldMap : public ComponentBase {
                     double& det, double jac[4][4]);
     // Calculate Jacobian for a cube
     void JacobianCube(int i, double t1, double t2, double t3,
-                    TMatrixD* &jac, std::vector<TMatrixD*> &dN);
+                      double jac[3][3], double dN[8][3]);
 
     // Find the element for a point in curved quadratic quadrilaterals
     int FindElement5(const double x, const double y, const double z,
@@ -212,8 +210,7 @@ class ComponentFieldMap : public ComponentBase {
                       double jac[4][4], double& det);
     // Find the element for a point in a cube
     int FindElementCube(const double x, const double y, const double z,
-                      double& t1, double& t2, double& t3,
-                      TMatrixD* &jac, std::vector<TMatrixD*> &dN);
+                        double& t1, double& t2, double& t3);
                       
     // Move (xpos, ypos, zpos) to field map coordinates
     void MapCoordinates(double& xpos, double& ypos, double& zpos,
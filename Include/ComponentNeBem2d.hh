@@ -45,6 +45,19 @@ class ComponentNeBem2d : public ComponentBase {
     void DisableRandomCollocation() {randomCollocation = false;}
     void SetMaxNumberOfIterations(const int niter);
 
+    // Solve the boundary element equations iteratively (restarted GMRES)
+    // instead of by LU decomposition (recommended for large numbers of
+    // elements); the iteration stops when the relative residual is 
+    // below tol or after nmax iterations
+    void EnableIterativeSolver() {
+      iterativeSolver = true; ready = false; matrixFactorisedFlag = false;
+    }
+    void DisableIterativeSolver() {
+      iterativeSolver = false; ready = false; matrixFactorisedFlag = false;
+    }
+    void SetIterativeSolverParameters(const double tol, const int nmax,
+                                      const int restart = 50);
+
     int GetNumberOfPanels()   {return nPanels;}
     int GetNumberOfWires()    {return nWires;}
     int GetNumberOfElements() {return nElements;}
@@ -54,14 +67,12 @@ class ComponentNeBem2d : public ComponentBase {
     static const int Local2Global = -1;
     static const int Global2Local = 1;
  
-    // Influence matrix
-    std::vector<std::vector<double> > influenceMatrix;
-    // Inverse of the influence matrix
-    std::vector<std::vector<double> > inverseMatrix;
+    // Influence matrix (nElements + 1 rows and columns, stored row by row),
+    // replaced by its LU decomposition after factorisation
+    std::vector<double> influenceMatrix;
     // Right hand side vector (boundary conditions)
     std::vector<double> boundaryConditions;
-    // Temporary arrays used during LU decomposition
-    std::vector<double> col;
+    // Row permutation of the LU decomposition
     std::vector<int> index;
      
  
@@ -73,6 +84,12 @@ class ComponentNeBem2d : public ComponentBase {
     bool randomCollocation;
     int nMaxIterations;
 
+    // Iterative solver settings
+    bool iterativeSolver;
+    double solverTolerance;
+    int nMaxSolverIterations;
+    int nKrylov;
+
     int nPanels;
     struct panel {
       // Coordinates of boundary points
@@ -121,15 +138,18 @@ class ComponentNeBem2d : public ComponentBase {
     };  
     std::vector<element> elements;
   
-    bool matrixInversionFlag;
+    bool matrixFactorisedFlag;
     
     bool Initialise();
     bool Discretise();
     bool ComputeInfluenceMatrix();
     void SplitElement(const int iel);
-    bool InvertMatrix();
+    bool Factorise();
     bool LUDecomposition();
-    void LUSubstitution();
+    void LUSubstitution(std::vector<double>& x);
+    void MultiplyInfluenceMatrix(const std::vector<double>& x,
+                                 std::vector<double>& y);
+    bool SolveIterative(std::vector<double>& x);
     bool GetBoundaryConditions();
     bool Solve();
     bool CheckConvergence();
@@ -131,6 +131,12 @@ class ComponentTcad2d : public ComponentBase {
 
     // Element from the previous call
     int lastElement;
+    // Uniform search grid over the bounding box, 
+    // with the list of elements overlapping each cell
+    int nGridX, nGridY;
+    double xGridStep, yGridStep;
+    std::vector<int> gridStart;
+    std::vector<int> gridElements;
     // Shape functions for interpolation 
     // (local coordinates)
     double w[nMaxVertices];
@@ -140,6 +146,9 @@ class ComponentTcad2d : public ComponentBase {
     // Periodicities
     void UpdatePeriodicity();    
 
+    // Locate the element containing a point (-1 if outside the mesh)
+    int FindElement(const double x, const double y);
+    bool CheckElement(const double x, const double y, const int i);
     bool CheckRectangle(const double x, const double y, const int i);
     bool CheckTriangle(const double x, const double y, const int i);
     bool CheckLine(const double x, const double y, const int i);
@@ -147,6 +156,9 @@ class ComponentTcad2d : public ComponentBase {
     bool LoadGrid(const std::string gridfilename);
     bool LoadData(const std::string datafilename);
     void FindNeighbours();
+    void BuildSearchGrid();
+    int GridCoordinate(const double u, const double umin,
+                       const double step, const int n) const;
     void Cleanup();
 
 };
@@ -126,6 +126,15 @@ class ComponentTcad3d : public ComponentBase {
 
     // Element from the previous call
     int lastElement;
+    // Tetrahedra sharing the face opposite to vertex j of element i
+    // (index 4 * i + j, -1 if there is none)
+    std::vector<int> neighbours;
+    // Uniform search grid over the bounding box, 
+    // with the list of elements overlapping each cell
+    int nGridX, nGridY, nGridZ;
+    double xGridStep, yGridStep, zGridStep;
+    std::vector<int> gridStart;
+    std::vector<int> gridElements;
     // Node point weighting factors for interpolation 
     // (local coordinates)
     double w[nMaxVertices];
@@ -135,6 +144,10 @@ class ComponentTcad3d : public ComponentBase {
     // Periodicities
     void UpdatePeriodicity();    
 
+    // Locate the element containing a point (-1 if outside the mesh)
+    int FindElement(const double x, const double y, const double z);
+    bool CheckElement(const double x, const double y, const double z,
+                      const int i);
     bool CheckTetrahedron(const double x, const double y, const double z, 
                           const int i);
     bool CheckTriangle(const double x, const double y, const double z, 
@@ -142,6 +155,10 @@ class ComponentTcad3d : public ComponentBase {
 
     bool LoadGrid(const std::string gridfilename);
     bool LoadData(const std::string datafilename);
+    void FindNeighbours();
+    void BuildSearchGrid();
+    int GridCoordinate(const double u, const double umin,
+                       const double step, const int n) const;
     void Cleanup();
 
 };
@@ -0,0 +1,64 @@
+#ifndef G_DRIFT_LINE_POOL_H
+#define G_DRIFT_LINE_POOL_H
+
+#include <vector>
+
+namespace Garfield {
+
+// Storage for the drift lines of the electrons/holes in an avalanche.
+// The points of all drift lines are kept in blocks of fixed size in a
+// single array; Clear forgets the drift lines but keeps the memory,
+// which is reused by the next event.
+// Drift lines are identified by the index returned by NewLine.
+
+class DriftLinePool {
+
+  public:
+    // Constructor
+    DriftLinePool();
+    // Destructor
+    ~DriftLinePool() {}
+
+    // Remove all drift lines (the memory is kept)
+    void Clear();
+
+    // Start a new (empty) drift line
+    int NewLine();
+    // Append a point to a drift line
+    void AddPoint(const int line, const double x, const double y,
+                  const double z, const double t);
+
+    int GetNumberOfLines() const {return nLines;}
+    int GetNumberOfPoints(const int line) const;
+    // Get the coordinates of point ip (0 ... n - 1) of a drift line
+    bool GetPoint(const int line, const int ip,
+                  double& x, double& y, double& z, double& t) const;
+
+    // Number of points which can be stored without new allocations
+    int GetCapacity() const {return xp.size();}
+
+  private:
+
+    // Number of points in a block
+    static const int nBlockSize = 64;
+
+    // Point coordinates (nBlockSize consecutive entries per block)
+    std::vector<double> xp, yp, zp, tp;
+    int nBlocks;
+
+    struct line {
+      // Blocks of the drift line (in order)
+      std::vector<int> blocks;
+      // Number of points
+      int n;
+    };
+    std::vector<line> lines;
+    int nLines;
+
+    int NewBlock();
+
+};
+
+}
+
+#endif
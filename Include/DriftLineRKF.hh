@@ -27,15 +27,20 @@ namespace Garfield {
 
     void SetMaxSteps(int max) {maxSteps = max;};
 
-    void DriftElectron(const double x0, const double y0, const double z0,
+    bool DriftElectron(const double x0, const double y0, const double z0,
                        const double t0);
-    void DriftHole(const double x0, const double y0, const double z0,
+    bool DriftHole(const double x0, const double y0, const double z0,
                    const double t0);
-    void DriftIon(const double x0, const double y0, const double z0,
+    bool DriftIon(const double x0, const double y0, const double z0,
                   const double t0);
 
     void GetEndPoint(double& xend, double& yend, double& zend, double& tend,
 		     std::string& status) const;
+    // Mean and rms of the arrival time of the last drift line
+    void GetDriftTime(double& meanTime, double& rmsTime) const;
+    // Multiplication factor (exp. of integrated alpha - eta) 
+    // along the last drift line
+    double GetGain() const {return lastGain;}
 
     void EnableDebugging()  {debug = true;}
     void DisableDebugging() {debug = false;}
@@ -62,7 +67,10 @@ namespace Garfield {
     bool debug;
     bool verbose;
 
-    void DriftLine(double x0, double y0, double z0, double t0,  
+    double lastMeanTime, lastRmsTime;
+    double lastGain;
+
+    bool DriftLine(double x0, double y0, double z0, double t0,  
                    double& meanTime, double& rmsTime,                   
                    std::string particleType);
     // Used to drift a particle to the edge of a boundary.
@@ -74,6 +82,8 @@ namespace Garfield {
     double IntegrateDiffusion(const double x,  const double y,  const double z,
 			      const double xe, const double ye, const double ze,
                               const std::string particleType);
+    // Used to determine the gain over the drift line
+    double IntegrateTownsend(const std::string particleType);
     
     // These variables store the position and radius ofa trapping wire
     double xWire, yWire, rWire;
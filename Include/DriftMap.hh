@@ -0,0 +1,120 @@
+#ifndef G_DRIFTMAP_H
+#define G_DRIFTMAP_H
+
+#include <vector>
+#include <string>
+
+namespace Garfield {
+
+// Table of drift times, arrival time spreads, gains and
+// end-point electrodes on a (locally refined) regular grid,
+// as computed by DriftMapBuilder from DriftLineRKF drift lines.
+// Used in place of drift line calculations in fast simulations.
+
+class DriftMap {
+
+  friend class DriftMapBuilder;
+
+  public:
+    // Constructor
+    DriftMap();
+    // Destructor
+    ~DriftMap() {}
+
+    // Read/write the map from/to a binary file
+    bool Load(const std::string filename);
+    bool Save(const std::string filename) const;
+    // Add the nodes computed in another (partial) map with the same grid
+    bool Merge(const DriftMap& other);
+    void Clear();
+
+    bool IsReady() const {return ready;}
+    // Check if all nodes of the map have been computed
+    bool IsComplete() const;
+    bool GetArea(double& xmin, double& ymin, double& zmin,
+                 double& xmax, double& ymax, double& zmax) const;
+    int GetNumberOfNodes() const {return nodes.size() + fineNodes.size();}
+    int GetNumberOfRefinedCells() const;
+    std::string GetParticleType() const {return particle;}
+
+    // End-point electrodes
+    int GetNumberOfElectrodes() const {return labels.size();}
+    bool GetElectrode(const int i, std::string& label) const;
+
+    // Interpolate the mean drift time, its rms and the gain
+    // and determine the electrode where the drift line ends (-1 if none)
+    bool Evaluate(const double x, const double y, const double z,
+                  double& t, double& rms, double& gain, int& electrode);
+    // Sample the arrival time of a particle starting at (x, y, z, t0)
+    bool Drift(const double x, const double y, const double z,
+               const double t0, double& t1, int& electrode);
+
+    void EnableDebugging()  {debug = true;}
+    void DisableDebugging() {debug = false;}
+
+  private:
+
+    std::string className;
+
+    bool ready;
+
+    // Particle type ("electron", "hole" or "ion")
+    std::string particle;
+    // Labels of the electrodes
+    std::vector<std::string> labels;
+
+    // 2D maps are defined in the x-y plane at z = zMin
+    bool is3d;
+    // Number of coarse cells in x, y, z (nZ = 0 for 2D maps)
+    int nX, nY, nZ;
+    double xMin, yMin, zMin;
+    double xMax, yMax, zMax;
+    double dX, dY, dZ;
+    // Number of sub-cells per axis in refined cells
+    int nRefine;
+
+    struct node {
+      // Mean drift time and rms
+      float t, rms;
+      // Multiplication factor
+      float gain;
+      // End-point electrode
+      short electrode;
+      // 1: computed, 0: not computed, -1: drift line failed
+      signed char status;
+    };
+    // Nodes of the coarse grid
+    std::vector<node> nodes;
+    // Offset of the refined node block for each coarse cell (-1 if none)
+    std::vector<int> fineIndex;
+    std::vector<node> fineNodes;
+
+    bool debug;
+
+    bool Initialise(const bool threeD,
+                    const double x0, const double y0, const double z0,
+                    const double x1, const double y1, const double z1,
+                    const int nx, const int ny, const int nz,
+                    const int nr, const std::string type);
+    bool HasSameGrid(const DriftMap& other) const;
+
+    int NodeIndex(const int ix, const int iy, const int iz) const {
+      return (iz * (nY + 1) + iy) * (nX + 1) + ix;
+    }
+    int CellIndex(const int ix, const int iy, const int iz) const {
+      return (iz * nY + iy) * nX + ix;
+    }
+    int FineNodeIndex(const int offset,
+                      const int jx, const int jy, const int jz) const {
+      return offset + (jz * (nRefine + 1) + jy) * (nRefine + 1) + jx;
+    }
+    int GetNumberOfFineNodesPerCell() const {
+      return is3d ? (nRefine + 1) * (nRefine + 1) * (nRefine + 1) :
+                    (nRefine + 1) * (nRefine + 1);
+    }
+
+};
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef G_DRIFTMAP_BUILDER_H
+#define G_DRIFTMAP_BUILDER_H
+
+#include <vector>
+#include <string>
+
+#include "Sensor.hh"
+#include "DriftLineRKF.hh"
+#include "DriftMap.hh"
+
+namespace Garfield {
+
+// Fill a DriftMap with drift times, diffusion and gain computed by
+// DriftLineRKF on a regular grid. Cells in which the end points or
+// drift times of the corner nodes differ by more than a given tolerance
+// are subdivided. The grid can be split in slabs along x which are
+// computed in separate jobs and combined afterwards using DriftMap::Merge.
+
+class DriftMapBuilder {
+
+  public:
+    // Constructor
+    DriftMapBuilder();
+    // Destructor
+    ~DriftMapBuilder() {}
+
+    void SetSensor(Sensor* s);
+
+    // Set the region covered by the map
+    // 2D map in the x-y plane at a given z
+    void SetArea(const double xmin, const double ymin,
+                 const double xmax, const double ymax, const double z = 0.);
+    // 3D map
+    void SetArea(const double xmin, const double ymin, const double zmin,
+                 const double xmax, const double ymax, const double zmax);
+    // Set the number of coarse cells (nz = 0 for 2D maps)
+    void SetGrid(const int nx, const int ny, const int nz = 0);
+    // Set the number of sub-cells per axis of a refined cell and
+    // the drift time difference between the nodes of a cell
+    // (relative to the mean drift time) beyond which a cell is refined
+    void SetRefinement(const int n, const double tol);
+    void DisableRefinement() {useRefinement = false;}
+
+    // Particle type ("electron", "hole" or "ion")
+    void SetParticleType(const std::string type);
+
+    // Settings of the drift line calculation
+    void SetIntegrationAccuracy(const double a) {drift.SetIntegrationAccuracy(a);}
+    void SetMaximumStepSize(const double s) {drift.SetMaximumStepSize(s);}
+
+    // Compute only the slab of coarse cells job (0 ... nJobs - 1)
+    void SetJob(const int job, const int nJobs);
+
+    bool Build(DriftMap& map);
+
+    void EnableDebugging()  {debug = true;}
+    void DisableDebugging() {debug = false;}
+
+  private:
+
+    std::string className;
+
+    Sensor* sensor;
+    DriftLineRKF drift;
+
+    bool hasArea;
+    bool is3d;
+    double xMin, yMin, zMin;
+    double xMax, yMax, zMax;
+
+    int nX, nY, nZ;
+
+    bool useRefinement;
+    int nRefine;
+    double tolerance;
+
+    std::string particle;
+
+    int iJob, nJobs;
+
+    // Labels of the electrodes in the sensor
+    std::vector<std::string> labels;
+
+    int nDriftLines;
+
+    bool debug;
+
+    // Compute a drift line and fill the node
+    void ComputeNode(const double x, const double y, const double z,
+                     DriftMap::node& n);
+    // Check if a coarse cell needs to be subdivided
+    bool NeedsRefinement(const DriftMap& map,
+                         const int ix, const int iy, const int iz) const;
+    void RefineCell(DriftMap& map, const int ix, const int iy, const int iz);
+
+};
+
+}
+
+#endif
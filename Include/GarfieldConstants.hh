@@ -41,6 +41,7 @@ static const int StatusAttached             =  -7;
 static const int StatusRecombined           =  -8;
 static const int StatusBelowTransportCut    = -16;
 static const int StatusOutsideTimeWindow    = -17;
+static const int StatusEscaped              = -18;
 static const double Small = 1.e-20;
 
 static const double BoundaryDistance = 1.e-8;
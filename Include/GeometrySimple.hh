@@ -7,6 +7,7 @@
 
 #include "GeometryBase.hh"
 #include "Solid.hh"
+#include "BoundingVolumeHierarchy.hh"
 
 namespace Garfield {
 
@@ -34,6 +35,14 @@ class GeometrySimple : public GeometryBase {
     void Clear();
     void PrintSolids();
 
+    // Switch on/off the search tree over the bounding boxes of the solids
+    // (built at the first query, default: on)
+    void EnableSearchTree()  {useSearchTree = true;}
+    void DisableSearchTree() {useSearchTree = false;}
+    // Rebuild the search tree (after changing the dimensions of solids
+    // which are already in the geometry)
+    void UpdateSearchTree() {hasSearchTree = false;}
+
     bool IsInside(const double x, const double y, const double z);
     // Bounding box (envelope of geometry)
     bool IsInBoundingBox(const double x, const double y, const double z);
@@ -65,6 +74,14 @@ class GeometrySimple : public GeometryBase {
     };
     std::vector<solid> solids;
 
+    // Search tree over the bounding boxes of the solids
+    bool useSearchTree;
+    bool hasSearchTree;
+    BoundingVolumeHierarchy searchTree;
+    std::vector<int> candidates;
+    // Solid found in the previous call
+    int lastSolid;
+
     // Bounding box ranges
     bool hasBoundingBox;
     double xMinBoundingBox, yMinBoundingBox, zMinBoundingBox;
@@ -72,6 +89,10 @@ class GeometrySimple : public GeometryBase {
 
     // Switch on/off debugging messages
     bool debug; 
+
+    // Index of the solid at (x, y, z), -1 if none
+    int FindSolid(const double x, const double y, const double z);
+    void BuildSearchTree();
     
 };
   
@@ -9,6 +9,9 @@
 
 #pragma link C++ class Garfield::AvalancheMicroscopic;
 #pragma link C++ class Garfield::AvalancheMC;
+#pragma link C++ class Garfield::DriftMap;
+#pragma link C++ class Garfield::DriftMapBuilder;
+#pragma link C++ class Garfield::RecombinationStatistics;
 
 #pragma link C++ class Garfield::Medium;
 #pragma link C++ class Garfield::MediumGas;
@@ -45,6 +48,8 @@
 #pragma link C++ class Garfield::TrackElectron;
 #pragma link C++ class Garfield::TrackBichsel;
 #pragma link C++ class Garfield::TrackPAI;
+#pragma link C++ class Garfield::CloudGenerator;
+#pragma link C++ class Garfield::CloudPartition;
 
 #pragma link C++ function Garfield::RndmUniform();
 
@@ -30,6 +30,14 @@ double RndmUniformPos() {
 
 }
 
+// Draw n random numbers uniformly distributed in the range [0, 1)
+inline
+void RndmUniformArray(const int n, double* r) {
+
+  randomEngine.DrawArray(n, r);
+
+}
+
 // Draw a Gaussian random variate with mean zero and standard deviation one
 inline
 double RndmGaussian() {
@@ -13,6 +13,10 @@ class RandomEngine {
     
     // Draw a random number
     virtual double Draw() = 0;
+    // Draw n random numbers
+    virtual void DrawArray(const int n, double* r) {
+      for (int i = 0; i < n; ++i) r[i] = Draw();
+    }
     // Initialise the random number generator
     virtual void   Seed(unsigned int s) = 0;
   
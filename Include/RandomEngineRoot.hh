@@ -18,6 +18,7 @@ class RandomEngineRoot : public RandomEngine {
     ~RandomEngineRoot();    
     // Call the random number generator
     double Draw() {return rng.Rndm();}
+    void DrawArray(const int n, double* r) {rng.RndmArray(n, r);}
     // Initialise the random number generator
     void Seed(unsigned int s);
     
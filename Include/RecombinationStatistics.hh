@@ -0,0 +1,105 @@
+#ifndef G_RECOMBINATION_STATISTICS_H
+#define G_RECOMBINATION_STATISTICS_H
+
+#include <vector>
+#include <string>
+
+namespace Garfield {
+
+// Running statistics of the end points of electron-ion clouds:
+// numbers of recombined, attached, timed-out and escaped electrons and
+// of electrons which left the drift medium, per cloud and summed over a run,
+// histograms and moments of the recombination time and of the
+// largest distance to the closest ion reached by each electron.
+
+class RecombinationStatistics {
+
+  public:
+    // Constructor
+    RecombinationStatistics();
+    // Destructor
+    ~RecombinationStatistics() {}
+
+    // Set the binning of the histograms (resets the statistics)
+    void SetTimeHistogram(const int nBins, const double tmax);
+    void SetDistanceHistogram(const int nBins, const double rmax);
+
+    // Clear the accumulated statistics
+    void Reset();
+
+    // Fill the end points of one cloud
+    void BeginCloud();
+    // Time t [ns] since creation and largest distance d [cm] to the
+    // closest ion
+    void Fill(const int status, const double t, const double d);
+    void EndCloud();
+
+    int GetNumberOfClouds() const {return nClouds;}
+    // Number of electrons in total and with a given outcome
+    int GetNumberOfElectrons() const {return nTotal;}
+    int GetNumberOfRecombined() const {return nRecombined;}
+    int GetNumberOfAttached() const {return nAttached;}
+    int GetNumberOfTimedOut() const {return nTimedOut;}
+    int GetNumberOfLeftMedium() const {return nLeftMedium;}
+    int GetNumberOfEscaped() const {return nEscaped;}
+    int GetNumberOfOther() const {return nOther;}
+    // Same for the last cloud
+    int GetNumberOfElectronsInLastCloud() const {return nTotalCloud;}
+    int GetNumberOfRecombinedInLastCloud() const {return nRecombinedCloud;}
+
+    // Fraction of recombined electrons and its binomial error
+    double GetRecombinationFraction() const;
+    double GetRecombinationFractionError() const;
+    // Mean and standard deviation of the fraction per cloud
+    double GetMeanCloudRecombinationFraction() const {return fMean;}
+    double GetRmsCloudRecombinationFraction() const;
+
+    // Mean and standard deviation of the recombination time [ns]
+    double GetMeanRecombinationTime() const {return tMean;}
+    double GetRmsRecombinationTime() const;
+    // Mean and standard deviation of the largest distance to an ion [cm]
+    double GetMeanDistance() const {return dMean;}
+    double GetRmsDistance() const;
+
+    // Histograms (contents of bin i, overflow in the last bin)
+    int GetNumberOfTimeBins() const {return nTimeBins;}
+    double GetTimeBinWidth() const {return tBinWidth;}
+    int GetTimeBinContent(const int i) const;
+    int GetNumberOfDistanceBins() const {return nDistanceBins;}
+    double GetDistanceBinWidth() const {return dBinWidth;}
+    int GetDistanceBinContent(const int i, const bool recombined) const;
+
+    // Write a summary (counts, fractions, moments and histograms)
+    bool WriteSummary(const std::string& filename) const;
+
+  private:
+
+    std::string className;
+
+    int nClouds;
+    int nTotal;
+    int nRecombined, nAttached, nTimedOut, nLeftMedium, nEscaped, nOther;
+    int nTotalCloud, nRecombinedCloud;
+
+    // Online moments (Welford)
+    double fMean, fM2;
+    double tMean, tM2;
+    double dMean, dM2;
+    int nDistance;
+
+    int nTimeBins;
+    double tBinWidth;
+    std::vector<int> timeHistogram;
+    int nDistanceBins;
+    double dBinWidth;
+    // Recombined and not recombined electrons
+    std::vector<int> distanceHistogramRecombined;
+    std::vector<int> distanceHistogramOther;
+
+    static void Update(const double x, const int n, double& mean, double& m2);
+
+};
+
+}
+
+#endif
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "ComponentBase.hh"
+#include "BoundingVolumeHierarchy.hh"
 
 namespace Garfield {
 
@@ -23,6 +24,7 @@ class Sensor {
     // Add an electrode
     void AddElectrode(ComponentBase* comp, std::string label);
     int GetNumberOfElectrodes() {return nElectrodes;}
+    bool GetElectrode(const int i, std::string& label);
     // Remove all components, electrodes and reset the sensor
     void Clear();
     
@@ -38,6 +40,8 @@ class Sensor {
     void MagneticField(const double x, const double y, const double z,
                        double& bx, double& by, double& bz,
                        int& status);
+    // Is the magnetic field of all components uniform?
+    bool HasUniformMagneticField();
 
     // Get the weighting field at (x, y, z)
     void WeightingField(const double x, const double y, const double z,
@@ -50,6 +54,11 @@ class Sensor {
     // Get the medium at (x, y, z)
     bool GetMedium(const double x, const double y, const double z, 
                    Medium*& medium);
+    // Use the bounding boxes of the components to find the component
+    // at a given point (default: off); the boxes are read at the first
+    // call to GetMedium after switching on or adding a component
+    void EnableComponentSearchTree()  {useSearchTree = true; hasSearchTree = false;}
+    void DisableComponentSearchTree() {useSearchTree = false;}
 
     // Set the user area
     bool SetArea();
@@ -116,6 +125,13 @@ class Sensor {
     };
     std::vector<component> components;
     int lastComponent;
+    // Search tree over the bounding boxes of the components
+    bool useSearchTree;
+    bool hasSearchTree;
+    BoundingVolumeHierarchy searchTree;
+    // Components without bounding box
+    std::vector<int> unboundedComponents;
+    std::vector<int> candidates;
     
     // Electrodes
     int nElectrodes;
@@ -165,6 +181,7 @@ class Sensor {
     // Return the current sensor size
     bool GetBoundingBox(double& xmin, double& ymin, double& zmin,
                         double& xmax, double& ymax, double& zmax);
+    void BuildSearchTree();
 
 };
 
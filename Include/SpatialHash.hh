@@ -0,0 +1,67 @@
+#ifndef G_SPATIAL_HASH_H
+#define G_SPATIAL_HASH_H
+
+#include <vector>
+
+namespace Garfield {
+
+// Uniform grid of cubic cells, hashed into a fixed number of buckets,
+// holding a set of points for fast nearest-neighbour queries.
+// Points are identified by their index in the list passed to Build.
+
+class SpatialHash {
+
+  public:
+    // Constructor
+    SpatialHash();
+    // Destructor
+    ~SpatialHash() {}
+
+    // Set the cell size [cm] (automatic choice if <= 0)
+    void SetCellSize(const double d) {cellSize = d;}
+    double GetCellSize() const {return cellSize;}
+
+    // Fill the table with a new set of points
+    void Build(const std::vector<double>& x, const std::vector<double>& y,
+               const std::vector<double>& z);
+    void Clear();
+    int GetNumberOfPoints() const {return xp.size();}
+
+    // Find the point closest to (x, y, z) within a distance rmax;
+    // returns false if there is no such point
+    bool FindNearest(const double x, const double y, const double z,
+                     const double rmax, int& index, double& dist) const;
+    // Find the point closest to (x, y, z) at any distance;
+    // returns false if the table is empty
+    bool FindNearest(const double x, const double y, const double z,
+                     int& index, double& dist) const;
+
+  private:
+
+    // Max. number of cell shells searched before falling back
+    // to a loop over all points
+    static const int nMaxShells = 3;
+
+    double cellSize;
+    // Cell size actually used for the current set of points
+    double cell;
+
+    // Point coordinates
+    std::vector<double> xp, yp, zp;
+    // Points in each bucket (compressed row storage)
+    int nBuckets;
+    std::vector<int> bucketStart;
+    std::vector<int> entries;
+
+    int CellIndex(const double u) const;
+    int Bucket(const int ix, const int iy, const int iz) const;
+    // Search the cells at Chebyshev distance k from (ix, iy, iz)
+    void SearchShell(const double x, const double y, const double z,
+                     const int ix, const int iy, const int iz, const int k,
+                     int& index, double& d2) const;
+
+};
+
+}
+
+#endif
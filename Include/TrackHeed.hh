@@ -87,6 +87,17 @@ class TrackHeed : public Track {
  
     bool ready;
     bool hasActiveTrack;
+
+    // Heed run state of this track (particle and cluster banks, 
+    // particle counter), made current before calling Heed
+    struct heedState;
+    heedState* state;
+    bool useEfield;
+    bool useBfield;
+    // Number of this instance (to make the names of the matter
+    // definitions unique)
+    int instanceId;
+    static int nInstances;
   
     double      mediumDensity;
     std::string mediumName;
@@ -132,6 +143,8 @@ class TrackHeed : public Track {
     double lX, lY, lZ;
     double cX, cY, cZ;
 
+    void Activate();
+    std::string GetMatterName(const std::string& name) const;
     bool Setup(Medium* medium); 
     bool SetupGas(Medium* medium);
     bool SetupMaterial(Medium* medium);
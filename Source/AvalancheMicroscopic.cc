@@ -1,12 +1,48 @@
 #include <iostream>
+#include <fstream>
 #include <cmath>
+#include <algorithm>
 #include <string>
+#include <ctime>
 
 #include "AvalancheMicroscopic.hh"
+#include "AvalancheMC.hh"
 #include "FundamentalConstants.hh"
 #include "GarfieldConstants.hh"
 #include "Random.hh"
 #include "MediumMagboltz.hh"
+#include "FastMath.hh"
+
+// Instrumentation of the transport loops (compiled out by default)
+#ifdef GARFIELD_INSTRUMENTATION
+#define GARFIELD_COUNT(counter, n) counters.counter += (n)
+#define GARFIELD_TIMER_START(start) const double start = ReadCycleCounter()
+#define GARFIELD_TIMER_STOP(start, cycles) \
+  counters.cycles += ReadCycleCounter() - start
+#else
+#define GARFIELD_COUNT(counter, n)
+#define GARFIELD_TIMER_START(start)
+#define GARFIELD_TIMER_STOP(start, cycles)
+#endif
+
+namespace {
+
+#ifdef GARFIELD_INSTRUMENTATION
+inline double ReadCycleCounter() {
+
+#if defined(__i386__) || defined(__x86_64__)
+  unsigned int lo, hi;
+  __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+  return 4294967296. * hi + lo;
+#else
+  // No cycle counter, use the processor time in microseconds.
+  return 1.e6 * double(clock()) / CLOCKS_PER_SEC;
+#endif
+
+}
+#endif
+
+}
 
 namespace Garfield {
 
@@ -24,8 +60,17 @@ AvalancheMicroscopic::AvalancheMicroscopic() :
   useDriftLines(false), usePhotons(false), 
   useBandStructureDefault(true),
   useNullCollisionSteps(false), useBfield(false),
-  rb11(1.), rb12(0.), rb13(0.), rb21(0.), rb22(1.), rb23(0.),
-  rb31(0.), rb32(0.), rb33(1.), rx22(1.), rx23(0.), rx32(0.), rx33(1.),
+  nullRateFactor(10.), useAdaptiveNullRate(false),
+  nullRateFactorMax(10.), nullRateDistance(3.), nullRateFieldRatio(0.1),
+  validateNullRate(false),
+  nNullRateSteps(0), nNullRateStepsMax(0), sumNullRateFactor(0.),
+  useTimeSlices(false), timeSliceMax(0.), timeSliceFraction(0.1),
+  validateTimeSlices(false), nTimeSlices(0),
+  useMultiRateField(false), multiRateDistance(0.), multiRateTolerance(0.1),
+  nFarFieldEvaluations(0), nFarFieldSkipped(0), counters(),
+  nextExpVariate(0),
+  useEscapeCriterion(false), escapeDistance(10.), escapePotential(1.),
+  escapeDrift(0),
   deltaCut(0.), gammaCut(0.),
   sizeCut(-1), nCollSkip(1),
   hasTimeWindow(false), tMin(0.), tMax(0.),
@@ -46,6 +91,7 @@ AvalancheMicroscopic::AvalancheMicroscopic() :
   endpointsElectrons.reserve(1000);
   endpointsHoles.reserve(1000);
   photons.reserve(100);
+  endpointColumns.resize(nEndpointColumns);
   stack.clear();
   endpointsElectrons.clear();
   endpointsHoles.clear();
@@ -285,6 +331,165 @@ AvalancheMicroscopic::UnsetTimeWindow() {
 
 }
 
+void
+AvalancheMicroscopic::SetNullCollisionRateFactor(const double f) {
+
+  if (f < 1.) {
+    std::cerr << className << "::SetNullCollisionRateFactor:\n";
+    std::cerr << "    Factor must be at least 1.\n";
+    return;
+  }
+  nullRateFactor = f;
+
+}
+
+void
+AvalancheMicroscopic::EnableAdaptiveNullCollisionRate(const double fmax,
+                                                      const double r,
+                                                      const double ratio) {
+
+  if (fmax < 1.) {
+    std::cerr << className << "::EnableAdaptiveNullCollisionRate:\n";
+    std::cerr << "    Max. factor must be at least 1.\n";
+    return;
+  }
+  if (r <= 0. || ratio <= 0.) {
+    std::cerr << className << "::EnableAdaptiveNullCollisionRate:\n";
+    std::cerr << "    Distance and field ratio must be greater than zero.\n";
+    return;
+  }
+  nullRateFactorMax = fmax;
+  nullRateDistance = r;
+  nullRateFieldRatio = ratio;
+  useAdaptiveNullRate = true;
+
+}
+
+void
+AvalancheMicroscopic::EnableTimeSlices(const double dtmax, const double f) {
+
+  if (dtmax <= 0. || f <= 0.) {
+    std::cerr << className << "::EnableTimeSlices:\n";
+    std::cerr << "    Max. slice width and fraction must be greater than zero.\n";
+    return;
+  }
+  timeSliceMax = dtmax;
+  timeSliceFraction = f;
+  useTimeSlices = true;
+
+}
+
+void
+AvalancheMicroscopic::EnableMultiRateCloudField(const double r, 
+                                                const double f) {
+
+  if (r <= 0. || f <= 0.) {
+    std::cerr << className << "::EnableMultiRateCloudField:\n";
+    std::cerr << "    Distance and tolerance must be greater than zero.\n";
+    return;
+  }
+  multiRateDistance = r;
+  multiRateTolerance = f;
+  useMultiRateField = true;
+
+}
+
+void
+AvalancheMicroscopic::GetFarFieldStatistics(int& nEvaluations, 
+                                            int& nSkipped) const {
+
+  nEvaluations = nFarFieldEvaluations;
+  nSkipped = nFarFieldSkipped;
+
+}
+
+bool
+AvalancheMicroscopic::HasInstrumentation() {
+
+#ifdef GARFIELD_INSTRUMENTATION
+  return true;
+#else
+  return false;
+#endif
+
+}
+
+void
+AvalancheMicroscopic::ResetInstrumentation() {
+
+  counters.nRealCollisions = counters.nNullCollisions = 0;
+  counters.nFieldEvaluations = 0;
+  counters.nCloudPairs = 0;
+  counters.nRateIncreases = 0;
+  counters.nClamps = 0;
+  counters.nErasures = 0;
+  counters.cyclesField = counters.cyclesCloud = 0.;
+  counters.cyclesFlight = counters.cyclesCollision = 0.;
+  counters.cyclesOutput = 0.;
+
+}
+
+bool
+AvalancheMicroscopic::WriteInstrumentation(const std::string& filename) const {
+
+  std::ofstream outfile(filename.c_str(), std::ios::out);
+  if (!outfile) {
+    std::cerr << className << "::WriteInstrumentation:\n";
+    std::cerr << "    Could not open file " << filename << ".\n";
+    return false;
+  }
+  outfile.precision(12);
+  outfile << "{\n";
+  outfile << "  \"enabled\": " 
+          << (HasInstrumentation() ? "true" : "false") << ",\n";
+  outfile << "  \"real_collisions\": " << counters.nRealCollisions << ",\n";
+  outfile << "  \"null_collisions\": " << counters.nNullCollisions << ",\n";
+  outfile << "  \"field_evaluations\": " 
+          << counters.nFieldEvaluations << ",\n";
+  outfile << "  \"cloud_pairs\": " << counters.nCloudPairs << ",\n";
+  outfile << "  \"rate_increases\": " << counters.nRateIncreases << ",\n";
+  outfile << "  \"clamps\": " << counters.nClamps << ",\n";
+  outfile << "  \"erasures\": " << counters.nErasures << ",\n";
+  outfile << "  \"cycles\": {\n";
+  outfile << "    \"field\": " << counters.cyclesField << ",\n";
+  outfile << "    \"cloud\": " << counters.cyclesCloud << ",\n";
+  outfile << "    \"flight\": " << counters.cyclesFlight << ",\n";
+  outfile << "    \"collision\": " << counters.cyclesCollision << ",\n";
+  outfile << "    \"output\": " << counters.cyclesOutput << "\n";
+  outfile << "  }\n";
+  outfile << "}\n";
+  outfile.close();
+  return true;
+
+}
+
+void
+AvalancheMicroscopic::EnableEscapeCriterion(const double k, const double f) {
+
+  if (k <= 0. || f <= 0.) {
+    std::cerr << className << "::EnableEscapeCriterion:\n";
+    std::cerr << "    Distance and potential factors must be greater than zero.\n";
+    return;
+  }
+  escapeDistance = k;
+  escapePotential = f;
+  useEscapeCriterion = true;
+
+}
+
+void
+AvalancheMicroscopic::GetNullCollisionRateStatistics(int& nSteps, 
+                                                     double& mean, 
+                                                     double& fractionMax) const {
+
+  nSteps = nNullRateSteps;
+  mean = fractionMax = 0.;
+  if (nNullRateSteps <= 0) return;
+  mean = sumNullRateFactor / nNullRateSteps;
+  fractionMax = double(nNullRateStepsMax) / nNullRateSteps;
+
+}
+
 void 
 AvalancheMicroscopic::GetElectronEndpoint(const int i, 
   double& x0, double& y0, double& z0, double& t0, double& e0,
@@ -314,6 +519,84 @@ AvalancheMicroscopic::GetElectronEndpoint(const int i,
 
 }
 
+const double*
+AvalancheMicroscopic::GetElectronEndpointColumn(const int column) {
+
+  if (column < 0 || column >= nEndpointColumns) {
+    std::cerr << className << "::GetElectronEndpointColumn:\n";
+    std::cerr << "    Column index " << column << " out of range.\n";
+    return 0;
+  }
+  const int n = endpointsElectrons.size();
+  if (n <= 0) return 0;
+  std::vector<double>& values = endpointColumns[column];
+  if ((int)values.size() == n) return &values[0];
+
+  double electron::* member = 0;
+  switch (column) {
+    case EndpointX0:         member = &electron::x0; break;
+    case EndpointY0:         member = &electron::y0; break;
+    case EndpointZ0:         member = &electron::z0; break;
+    case EndpointT0:         member = &electron::t0; break;
+    case EndpointE0:         member = &electron::e0; break;
+    case EndpointPotential0: member = &electron::potential0; break;
+    case EndpointMdi0:       member = &electron::mdi0; break;
+    case EndpointX1:         member = &electron::x; break;
+    case EndpointY1:         member = &electron::y; break;
+    case EndpointZ1:         member = &electron::z; break;
+    case EndpointT1:         member = &electron::t; break;
+    case EndpointE1:         member = &electron::energy; break;
+    case EndpointPotential1: member = &electron::potential; break;
+    case EndpointMdi:        member = &electron::mdi; break;
+    case EndpointMdiMax:     member = &electron::mdimax; break;
+    case EndpointXIon:       member = &electron::xi; break;
+    case EndpointYIon:       member = &electron::yi; break;
+    default:                 member = &electron::zi; break;
+  }
+  values.resize(n);
+  for (int i = 0; i < n; ++i) values[i] = endpointsElectrons[i].*member;
+  return &values[0];
+
+}
+
+const int*
+AvalancheMicroscopic::GetElectronEndpointIds() {
+
+  const int n = endpointsElectrons.size();
+  if (n <= 0) return 0;
+  if ((int)endpointIds.size() != n) {
+    endpointIds.resize(n);
+    for (int i = 0; i < n; ++i) endpointIds[i] = endpointsElectrons[i].id;
+  }
+  return &endpointIds[0];
+
+}
+
+const int*
+AvalancheMicroscopic::GetElectronEndpointStatus() {
+
+  const int n = endpointsElectrons.size();
+  if (n <= 0) return 0;
+  if ((int)endpointStatus.size() != n) {
+    endpointStatus.resize(n);
+    for (int i = 0; i < n; ++i) {
+      endpointStatus[i] = endpointsElectrons[i].status;
+    }
+  }
+  return &endpointStatus[0];
+
+}
+
+void
+AvalancheMicroscopic::ClearEndpointColumns() {
+
+  // Keep the memory for the next event.
+  for (int i = nEndpointColumns; i--;) endpointColumns[i].clear();
+  endpointIds.clear();
+  endpointStatus.clear();
+
+}
+
 // megan: added versions with id, potential0, potential
 void
 AvalancheMicroscopic::GetElectronEndpoint(const int i,
@@ -489,7 +772,7 @@ AvalancheMicroscopic::GetNumberOfElectronDriftLinePoints(const int i) const {
   
   if (!useDriftLines) return 2;
 
-  return endpointsElectrons[i].driftLine.size() + 2;
+  return driftLines.GetNumberOfPoints(endpointsElectrons[i].driftLine) + 2;
 
 }
 
@@ -504,7 +787,7 @@ AvalancheMicroscopic::GetNumberOfHoleDriftLinePoints(const int i) const {
   
   if (!useDriftLines) return 2;
 
-  return endpointsHoles[i].driftLine.size() + 2;
+  return driftLines.GetNumberOfPoints(endpointsHoles[i].driftLine) + 2;
 
 }
 
@@ -527,7 +810,7 @@ AvalancheMicroscopic::GetElectronDriftLinePoint(
     return;
   }
 
-  const int np = endpointsElectrons[iel].driftLine.size();
+  const int np = driftLines.GetNumberOfPoints(endpointsElectrons[iel].driftLine);
   if (ip > np) {
     x = endpointsElectrons[iel].x; 
     y = endpointsElectrons[iel].y; 
@@ -536,10 +819,7 @@ AvalancheMicroscopic::GetElectronDriftLinePoint(
     return;
   }
 
-  x = endpointsElectrons[iel].driftLine[ip - 1].x;
-  y = endpointsElectrons[iel].driftLine[ip - 1].y;
-  z = endpointsElectrons[iel].driftLine[ip - 1].z;
-  t = endpointsElectrons[iel].driftLine[ip - 1].t;
+  driftLines.GetPoint(endpointsElectrons[iel].driftLine, ip - 1, x, y, z, t);
 
 }
 
@@ -562,7 +842,7 @@ AvalancheMicroscopic::GetHoleDriftLinePoint(
     return;
   }
 
-  const int np = endpointsHoles[ih].driftLine.size();
+  const int np = driftLines.GetNumberOfPoints(endpointsHoles[ih].driftLine);
   if (ip > np) {
     x = endpointsHoles[ih].x; 
     y = endpointsHoles[ih].y; 
@@ -571,10 +851,7 @@ AvalancheMicroscopic::GetHoleDriftLinePoint(
     return;
   }
 
-  x = endpointsHoles[ih].driftLine[ip - 1].x;
-  y = endpointsHoles[ih].driftLine[ip - 1].y;
-  z = endpointsHoles[ih].driftLine[ip - 1].z;
-  t = endpointsHoles[ih].driftLine[ip - 1].t;
+  driftLines.GetPoint(endpointsHoles[ih].driftLine, ip - 1, x, y, z, t);
 
 }
 
@@ -686,11 +963,14 @@ AvalancheMicroscopic::DriftElectron(
   // Clear the list of electrons and photons.
   endpointsElectrons.clear(); 
   endpointsHoles.clear();
+  driftLines.Clear();
+  ClearEndpointColumns();
   photons.clear();
 
   // Reset the particle counters.
   nPhotons = nElectrons = nHoles = nIons = 0; 
   nElectronEndpoints = nHoleEndpoints = 0;
+  ResetInstrumentation();
 
   return TransportElectron(x0, y0, z0, t0, e0, dx0, dy0, dz0, false, false);
 
@@ -704,11 +984,14 @@ AvalancheMicroscopic::AvalancheElectron(
   // Clear the list of electrons, holes and photons.
   endpointsElectrons.clear();
   endpointsHoles.clear();
+  driftLines.Clear();
+  ClearEndpointColumns();
   photons.clear();
 
   // Reset the particle counters.
   nPhotons = nElectrons = nHoles = nIons = 0; 
   nElectronEndpoints = nHoleEndpoints = 0;
+  ResetInstrumentation();
 
   return TransportElectron(x0, y0, z0, t0, e0, dx0, dy0, dz0, true, false);
 
@@ -723,21 +1006,449 @@ AvalancheMicroscopic::AvalancheCloud(
   // Clear the list of electrons, holes and photons.
   endpointsElectrons.clear();
   endpointsHoles.clear();
+  driftLines.Clear();
+  ClearEndpointColumns();
   photons.clear();
 
   // Reset the particle counters.
   nPhotons = nElectrons = nHoles = nIons = 0; 
   nElectronEndpoints = nHoleEndpoints = 0;
+  ResetInstrumentation();
+
+  if (validateTimeSlices && useTimeSlices) {
+    // Transport the cloud with the oldest electron first scheduler first.
+    useTimeSlices = false;
+    const bool okOldest = TransportCloud(nIonization, x0, y0, z0, t0, e0, dx0, dy0, dz0, true, false, deBroglieRecomb, movieframetime, numberofmovieframes);
+    useTimeSlices = true;
+    if (!okOldest) return false;
+    const double fOldest = GetRecombinationFraction(nIonization);
+
+    endpointsElectrons.clear();
+    endpointsHoles.clear();
+    driftLines.Clear();
+    ClearEndpointColumns();
+    photons.clear();
+    nPhotons = nElectrons = nHoles = nIons = 0; 
+    nElectronEndpoints = nHoleEndpoints = 0;
+    if (!TransportCloud(nIonization, x0, y0, z0, t0, e0, dx0, dy0, dz0, true, false, deBroglieRecomb, movieframetime, numberofmovieframes)) {
+      return false;
+    }
+    const double fLockstep = GetRecombinationFraction(nIonization);
+    FillRecombinationStatistics();
+
+    const double sigma = sqrt((fOldest * (1. - fOldest) + 
+                               fLockstep * (1. - fLockstep)) / nIonization);
+    std::cout << className << "::AvalancheCloud:\n";
+    std::cout << "    Recombination fraction with oldest electron first: " 
+              << fOldest << "\n";
+    std::cout << "    Recombination fraction in lockstep (max. slice " 
+              << timeSliceMax << " ns, fraction " << timeSliceFraction << "): " 
+              << fLockstep << " (" << nTimeSlices << " slices)\n";
+    if (fabs(fLockstep - fOldest) > 3. * sigma) {
+      std::cerr << className << "::AvalancheCloud:\n";
+      std::cerr << "    Recombination fractions differ by more than three standard deviations.\n";
+    }
+    return true;
+  }
+
+  if (!validateNullRate || !useAdaptiveNullRate) {
+    if (!TransportCloud(nIonization, x0, y0, z0, t0, e0, dx0, dy0, dz0, true, false, deBroglieRecomb, movieframetime, numberofmovieframes)) {
+      return false;
+    }
+    FillRecombinationStatistics();
+    return true;
+  }
 
-  return TransportCloud(nIonization, x0, y0, z0, t0, e0, dx0, dy0, dz0, true, false, deBroglieRecomb, movieframetime, numberofmovieframes);
+  // Transport the cloud with the fixed null-collision rate factor first.
+  useAdaptiveNullRate = false;
+  const bool okFixed = TransportCloud(nIonization, x0, y0, z0, t0, e0, dx0, dy0, dz0, true, false, deBroglieRecomb, movieframetime, numberofmovieframes);
+  useAdaptiveNullRate = true;
+  if (!okFixed) return false;
+  const double fFixed = GetRecombinationFraction(nIonization);
+  const int nStepsFixed = nNullRateSteps;
+
+  endpointsElectrons.clear();
+  endpointsHoles.clear();
+  driftLines.Clear();
+  ClearEndpointColumns();
+  photons.clear();
+  nPhotons = nElectrons = nHoles = nIons = 0; 
+  nElectronEndpoints = nHoleEndpoints = 0;
+  if (!TransportCloud(nIonization, x0, y0, z0, t0, e0, dx0, dy0, dz0, true, false, deBroglieRecomb, movieframetime, numberofmovieframes)) {
+    return false;
+  }
+  const double fAdaptive = GetRecombinationFraction(nIonization);
+  FillRecombinationStatistics();
+
+  // Statistical uncertainty of the difference.
+  const double sigma = sqrt((fFixed * (1. - fFixed) + 
+                             fAdaptive * (1. - fAdaptive)) / nIonization);
+  std::cout << className << "::AvalancheCloud:\n";
+  std::cout << "    Recombination fraction with fixed null-collision rate factor ("
+            << nullRateFactor << "): " << fFixed << " (" << nStepsFixed << " steps)\n";
+  std::cout << "    Recombination fraction with adaptive factor (max. "
+            << nullRateFactorMax << "): " << fAdaptive << " (" << nNullRateSteps << " steps)\n";
+  if (fabs(fAdaptive - fFixed) > 3. * sigma) {
+    std::cerr << className << "::AvalancheCloud:\n";
+    std::cerr << "    Recombination fractions differ by more than three standard deviations.\n";
+  }
+  return true;
 
 }
 
+void
+AvalancheMicroscopic::FillRecombinationStatistics() {
+
+  recombStats.BeginCloud();
+  for (int i = 0; i < (int)endpointsElectrons.size(); ++i) {
+    const electron& e = endpointsElectrons[i];
+    recombStats.Fill(e.status, e.t - e.t0, e.mdimax);
+  }
+  for (int i = 0; i < (int)endpointsHoles.size(); ++i) {
+    const electron& h = endpointsHoles[i];
+    recombStats.Fill(h.status, h.t - h.t0, h.mdimax);
+  }
+  recombStats.EndCloud();
+
+}
+
+bool
+AvalancheMicroscopic::CheckEscape(const double rOnsager, 
+                                  const double kT) const {
+
+  // The criterion is only meaningful if the Onsager radius is known.
+  if (rOnsager <= 0.) return false;
+  const double rmin = escapeDistance * rOnsager;
+  const double umax = escapePotential * kT;
+  for (int i = stack.size(); i--;) {
+    if (stack[i].mdi < rmin) return false;
+    if (fabs(stack[i].potential) > umax) return false;
+  }
+  return true;
+
+}
+
+void
+AvalancheMicroscopic::RetireEscaped() {
+
+  double x0 = 0., y0 = 0., z0 = 0., t0 = 0.;
+  double x1 = 0., y1 = 0., z1 = 0., t1 = 0.;
+  int status = 0;
+  const int nSize = stack.size();
+  for (int i = 0; i < nSize; ++i) {
+    electron& e = stack[i];
+    if (escapeDrift) {
+      // Drift the electron/hole to the end of its drift line.
+      const bool ok = e.hole ? escapeDrift->DriftHole(e.x, e.y, e.z, e.t) :
+                               escapeDrift->DriftElectron(e.x, e.y, e.z, e.t);
+      const int nEndpoints = e.hole ? 
+                             escapeDrift->GetNumberOfHoleEndpoints() :
+                             escapeDrift->GetNumberOfElectronEndpoints();
+      if (ok && nEndpoints > 0) {
+        if (e.hole) {
+          escapeDrift->GetHoleEndpoint(0, x0, y0, z0, t0, 
+                                          x1, y1, z1, t1, status);
+        } else {
+          escapeDrift->GetElectronEndpoint(0, x0, y0, z0, t0, 
+                                              x1, y1, z1, t1, status);
+        }
+        e.x = x1; e.y = y1; e.z = z1; e.t = t1;
+      }
+    }
+    e.status = StatusEscaped;
+    if (e.hole) {
+      endpointsHoles.push_back(e);
+    } else {
+      endpointsElectrons.push_back(e);
+    }
+  }
+  stack.clear();
+
+}
+
+double
+AvalancheMicroscopic::GetRecombinationFraction(const int nIonization) const {
+
+  if (nIonization <= 0) return 0.;
+  int nRecombined = 0;
+  for (int i = endpointsElectrons.size(); i--;) {
+    if (endpointsElectrons[i].status == StatusRecombined) ++nRecombined;
+  }
+  for (int i = endpointsHoles.size(); i--;) {
+    if (endpointsHoles[i].status == StatusRecombined) ++nRecombined;
+  }
+  return double(nRecombined) / nIonization;
+
+}
+
+template <int type>
+bool
+AvalancheMicroscopic::Flight(flight& f, Medium* medium, double& fLim,
+                             const char* caller) {
+
+  // Numerical prefactors in equation of motion
+  const double c1 = SpeedOfLight * sqrt(2. / ElectronMass);
+  const double c2 = c1 * c1 / 4.;
+  // Cyclotron frequency
+  double cwt = 1., swt = 0.;
+  double wb = 0.;
+  // Numerical factors
+  double a1 = 0., a2 = 0., a3 = 0., a4 = 0.;
+  // Magnetic field: unit vector along B, component of E along B,
+  // velocity along B, E x B drift velocity, 
+  // velocity perpendicular to B in the drifting frame (u) and b x u
+  double ubx = 0., uby = 0., ubz = 0.;
+  double ePar = 0., vPar = 0.;
+  double vdx = 0., vdy = 0., vdz = 0.;
+  double ux = 0., uy = 0., uz = 0.;
+  double wx = 0., wy = 0., wz = 0.;
+  // Velocity after the step (band structure)
+  double newVx = 0., newVy = 0., newVz = 0.;
+
+  if (type == StepMagneticField) {
+    // Calculate the cyclotron frequency.
+    wb = OmegaCyclotronOverB * f.bmag;
+    // The motion is a uniform acceleration along B, the E x B drift
+    // and a rotation around B. Instead of rotating into a frame with
+    // B along the x axis (and E in the x-z plane), the components 
+    // are computed directly in the lab frame.
+    ubx = f.bx / f.bmag; uby = f.by / f.bmag; ubz = f.bz / f.bmag;
+    const double v = c1 * sqrt(f.energy);
+    f.vx = v * f.kx; f.vy = v * f.ky; f.vz = v * f.kz;
+    ePar = f.ex * ubx + f.ey * uby + f.ez * ubz;
+    vPar = f.vx * ubx + f.vy * uby + f.vz * ubz;
+    vdx = (f.ey * ubz - f.ez * uby) / f.bmag;
+    vdy = (f.ez * ubx - f.ex * ubz) / f.bmag;
+    vdz = (f.ex * uby - f.ey * ubx) / f.bmag;
+    ux = f.vx - vPar * ubx - vdx;
+    uy = f.vy - vPar * uby - vdy;
+    uz = f.vz - vPar * ubz - vdz;
+    wx = uby * uz - ubz * uy;
+    wy = ubz * ux - ubx * uz;
+    wz = ubx * uy - uby * ux;
+    a1 = vPar * ePar;
+    a2 = c2 * ePar * ePar;
+    // Work done by the electric field on the rotating component
+    // (the drift is perpendicular to E)
+    a3 = (f.ex * ux + f.ey * uy + f.ez * uz) / wb;
+    a4 = (f.ex * wx + f.ey * wy + f.ez * wz) / wb;
+  } else if (type == StepBandStructure) {
+    f.energy = medium->GetElectronEnergy(f.kx, f.ky, f.kz, 
+                                         f.vx, f.vy, f.vz, f.band);
+  } else {
+    // No band structure, no magnetic field.
+    // Calculate the velocity vector.
+    const double v = c1 * sqrt(f.energy);
+    f.vx = v * f.kx; f.vy = v * f.ky; f.vz = v * f.kz;
+    a1 = f.vx * f.ex + f.vy * f.ey + f.vz * f.ez;
+    a2 = c2 * (f.ex * f.ex + f.ey * f.ey + f.ez * f.ez);
+  }
+
+  if (hasUserHandleStep) {
+    userHandleStep(f.x, f.y, f.z, f.t, f.energy, f.kx, f.ky, f.kz, f.hole);
+  }
+
+  // Determine the timestep.
+  const double energy = f.energy;
+  double dt = 0.;
+  double newEnergy = 0.;
+  f.isNull = false;
+  f.nRateIncreases = 0;
+  while (1) {
+    // Sample the flight time.
+#ifdef GARFIELD_FAST_MATH
+    const double s = RndmExponential();
+#else
+    const double s = -log(RndmUniformPos());
+#endif
+    dt += s / fLim;
+    // Calculate the energy after the proposed step.
+    if (type == StepMagneticField) {
+#ifdef GARFIELD_FAST_MATH
+      FastSinCos(wb * dt, swt, cwt);
+#else
+      cwt = cos(wb * dt); swt = sin(wb * dt);
+#endif
+      newEnergy = std::max(energy + (a1 + a2 * dt) * dt + 
+                           a3 * swt - a4 * (1. - cwt), 
+                           Small);
+    } else if (type == StepBandStructure) {
+      newEnergy = std::max(medium->GetElectronEnergy(
+                                        f.kx + f.ex * dt * SpeedOfLight,
+                                        f.ky + f.ey * dt * SpeedOfLight,
+                                        f.kz + f.ez * dt * SpeedOfLight, 
+                                        newVx, newVy, newVz, f.band), 
+                           Small);
+    } else {
+      newEnergy = std::max(energy + (a1 + a2 * dt) * dt, Small);
+    }
+    // Get the real collision rate at the updated energy.
+    const double fReal = medium->GetElectronCollisionRate(newEnergy, f.band);
+    if (fReal <= 0.) {
+      std::cerr << className << "::" << caller << ":\n";
+      std::cerr << "    Got collision rate <= 0.\n";
+      std::cerr << "    At " << newEnergy << " eV (band " << f.band << ").\n";
+      return false;
+    }
+    if (fReal > fLim) {
+      // Real collision rate is higher than null-collision rate
+      // (energy beyond the range covered by the null-collision rate).
+      dt -= s / fLim;
+      // Raise the null-collision rate above the real rate and try again.
+      fLim = 1.05 * fReal;
+      ++f.nRateIncreases;
+      GARFIELD_COUNT(nRateIncreases, 1);
+      if (debug) {
+        std::cout << className << "::" << caller << ":\n";
+        std::cout << "    Increasing null-collision rate to " << fLim 
+                  << " ns-1 at " << newEnergy << " eV (band " 
+                  << f.band << ").\n";
+      }
+      continue;
+    }
+    // Check for real or null collision.
+    if (RndmUniform() <= fReal / fLim) {
+      GARFIELD_COUNT(nRealCollisions, 1);
+      break;
+    }
+    GARFIELD_COUNT(nNullCollisions, 1);
+    if (useNullCollisionSteps) {
+      f.isNull = true;
+      break;
+    }
+  }
+  f.dt = dt;
+  f.newEnergy = newEnergy;
+
+  // Update the directions (at instant before collision)
+  // and calculate the proposed new position.
+  if (type == StepMagneticField) {
+    // Calculate the new velocity.
+    const double vParNew = vPar + 2. * c2 * ePar * dt;
+    newVx = vParNew * ubx + vdx + ux * cwt - wx * swt;
+    newVy = vParNew * uby + vdy + uy * cwt - wy * swt;
+    newVz = vParNew * ubz + vdz + uz * cwt - wz * swt;
+    // Normalise.
+    const double v = sqrt(newVx * newVx + newVy * newVy + newVz * newVz);
+    f.newKx = newVx / v; f.newKy = newVy / v; f.newKz = newVz / v; 
+    // Calculate the step in coordinate space (mean velocity).
+    const double vParMean = vPar + c2 * ePar * dt;
+    const double fs = swt / (wb * dt);
+    const double fc = (1. - cwt) / (wb * dt);
+    f.vx = vParMean * ubx + vdx + ux * fs - wx * fc;
+    f.vy = vParMean * uby + vdy + uy * fs - wy * fc;
+    f.vz = vParMean * ubz + vdz + uz * fs - wz * fc;
+  } else if (type == StepBandStructure) {
+    // Update the wave-vector.
+    f.newKx = f.kx + f.ex * dt * SpeedOfLight;
+    f.newKy = f.ky + f.ey * dt * SpeedOfLight;
+    f.newKz = f.kz + f.ez * dt * SpeedOfLight;
+    // Average velocity over the step.
+    f.vx = 0.5 * (f.vx + newVx);
+    f.vy = 0.5 * (f.vy + newVy);
+    f.vz = 0.5 * (f.vz + newVz);
+  } else {
+    // Update the direction.
+    a1 = sqrt(energy / newEnergy);
+    a2 = 0.5 * c1 * dt / sqrt(newEnergy);
+    f.newKx = f.kx * a1 + f.ex * a2; 
+    f.newKy = f.ky * a1 + f.ey * a2; 
+    f.newKz = f.kz * a1 + f.ez * a2;
+    // Calculate the step in coordinate space.
+    a1 = c1 * sqrt(energy);
+    a2 = dt * c2; 
+    f.vx = f.kx * a1 + f.ex * a2;
+    f.vy = f.ky * a1 + f.ey * a2;
+    f.vz = f.kz * a1 + f.ez * a2;
+  }
+  return true;
+
+}
+
+// Output options of the transport loops (template arguments)
+// Induced signal
+struct AvalancheMicroscopic::noSignal {
+  static const bool enabled = false;
+  static void Add(Sensor*, const bool, const double, const double,
+                  const double, const double, const double, 
+                  const double, const double, const double) {}
+};
+
+struct AvalancheMicroscopic::withSignal {
+  static const bool enabled = true;
+  static void Add(Sensor* sensor, const bool hole, 
+                  const double t, const double dt,
+                  const double x, const double y, const double z,
+                  const double vx, const double vy, const double vz) {
+    sensor->AddSignal(hole ? +1 : -1, t, dt, x, y, z, vx, vy, vz);
+  }
+};
+
+// Drift lines and collision markers
+struct AvalancheMicroscopic::noPlotting {
+  static void AddPoint(DriftLinePool&, const bool, int&, 
+                       const double, const double, const double,
+                       const double) {}
+  static void AddMarker(ViewDrift*, const bool, const int,
+                        const double, const double, const double) {}
+};
+
+struct AvalancheMicroscopic::withPlotting {
+  static void AddPoint(DriftLinePool& driftLines, const bool use, int& line,
+                       const double x, const double y, const double z,
+                       const double t) {
+    if (!use) return;
+    if (line < 0) line = driftLines.NewLine();
+    driftLines.AddPoint(line, x, y, z, t);
+  }
+  static void AddMarker(ViewDrift* viewer, const bool use, const int type,
+                        const double x, const double y, const double z) {
+    if (!use) return;
+    switch (type) {
+      case ElectronCollisionTypeIonisation:
+        viewer->AddIonisationMarker(x, y, z);
+        break;
+      case ElectronCollisionTypeAttachment:
+        viewer->AddAttachmentMarker(x, y, z);
+        break;
+      case ElectronCollisionTypeExcitation:
+        viewer->AddExcitationMarker(x, y, z);
+        break;
+    }
+  }
+};
+
 bool 
 AvalancheMicroscopic::TransportElectron(
     const double x0, const double y0, const double z0, const double t0, 
     const double e0, const double dx0, const double dy0, const double dz0,
     const bool aval, bool hole) {
+
+  // Select the instantiation of the transport loop.
+  const bool plotting = usePlotting || useDriftLines;
+  if (useSignal) {
+    if (plotting) {
+      return TransportElectronLoop<withSignal, withPlotting>(
+          x0, y0, z0, t0, e0, dx0, dy0, dz0, aval, hole);
+    }
+    return TransportElectronLoop<withSignal, noPlotting>(
+        x0, y0, z0, t0, e0, dx0, dy0, dz0, aval, hole);
+  }
+  if (plotting) {
+    return TransportElectronLoop<noSignal, withPlotting>(
+        x0, y0, z0, t0, e0, dx0, dy0, dz0, aval, hole);
+  }
+  return TransportElectronLoop<noSignal, noPlotting>(
+      x0, y0, z0, t0, e0, dx0, dy0, dz0, aval, hole);
+
+}
+
+template <class signalPolicy, class plottingPolicy>
+bool 
+AvalancheMicroscopic::TransportElectronLoop(
+    const double x0, const double y0, const double z0, const double t0, 
+    const double e0, const double dx0, const double dy0, const double dz0,
+    const bool aval, bool hole) {
   
   // Make sure that the sensor is defined.
   if (!sensor) {
@@ -783,10 +1494,6 @@ AvalancheMicroscopic::TransportElectron(
   // Get the id number of the drift medium.
   int id = medium->GetId();    
   
-  // Numerical prefactors in equation of motion
-  const double c1 = SpeedOfLight * sqrt(2. / ElectronMass);
-  const double c2 = c1 * c1 / 4.;
-
   // Temporary stack of photons produced in the de-excitation cascade.
   std::vector<double> stackPhotonsTime;   stackPhotonsTime.clear();
   std::vector<double> stackPhotonsEnergy; stackPhotonsEnergy.clear();
@@ -795,9 +1502,6 @@ AvalancheMicroscopic::TransportElectron(
   double ex = 0., ey = 0., ez = 0., emag = 0.;
   double bx = 0., by = 0., bz = 0., bmag = 0.;
   int status = 0;
-  // Cyclotron frequency
-  double cwt = 1., swt = 0.;
-  double wb = 0.;
   // Flag indicating if magnetic field is usable
   bool bOk = true;
 
@@ -813,7 +1517,6 @@ AvalancheMicroscopic::TransportElectron(
   double dt = 0.;
   // Direction, velocity and energy after a step
   double newKx = 0., newKy = 0., newKz = 0.;
-  double newVx = 0., newVy = 0., newVz = 0.;
   double newEnergy = 0.;
   // Collision type (elastic, ionisation, attachment, inelastic, ...)
   int cstype;
@@ -823,10 +1526,8 @@ AvalancheMicroscopic::TransportElectron(
   // Number of secondaries
   int nion = 0, ndxc = 0; 
   
-  // Random number
-  double r;
-  // Numerical factors
-  double a1 = 0., a2 = 0., a3 = 0., a4 = 0.;
+  // Free flight between collisions
+  flight fl;
 
   // Clear the stack.
   stack.clear();     
@@ -852,7 +1553,7 @@ AvalancheMicroscopic::TransportElectron(
   newElectron.xLast = x0; 
   newElectron.yLast = y0; 
   newElectron.zLast = z0;
-  newElectron.driftLine.clear();
+  newElectron.driftLine = -1;
   stack.push_back(newElectron);
   if (hole) {
     ++nHoles;
@@ -890,7 +1591,7 @@ AvalancheMicroscopic::TransportElectron(
   }
 
   // Get the null-collision rate.
-  double fLim = medium->GetElectronNullCollisionRate(band);
+  double fLim = GetNullCollisionRate(medium, band, e0);
   if (fLim <= 0.) {
     std::cerr << className << "::TransportElectron:\n";
     std::cerr << "    Got null-collision rate <= 0.\n";
@@ -923,7 +1624,10 @@ AvalancheMicroscopic::TransportElectron(
       int nCollTemp = 0;
 
       // Get the local electric field and medium.
+      GARFIELD_TIMER_START(tField);
       sensor->ElectricField(x, y, z, ex, ey, ez, medium, status);
+      GARFIELD_TIMER_STOP(tField, cyclesField);
+      GARFIELD_COUNT(nFieldEvaluations, 1);
       // Sign change for electrons.
       if (!hole) {
         ex = -ex; ey = -ey; ez = -ez;
@@ -961,6 +1665,7 @@ AvalancheMicroscopic::TransportElectron(
           endpointsElectrons.push_back(stack[iE]);
         }
         stack.erase(stack.begin() + iE);
+        GARFIELD_COUNT(nErasures, 1);
         if (debug) {
           std::cout << className << "::TransportElectron:\n";
           if (hole) {
@@ -1015,6 +1720,7 @@ AvalancheMicroscopic::TransportElectron(
             endpointsElectrons.push_back(stack[iE]);
           }
           stack.erase(stack.begin() + iE);
+          GARFIELD_COUNT(nErasures, 1);
           if (debug) {
             std::cout << className << "::TransportElectron:\n";
             std::cout << "    Kinetic energy (" << energy << ")"
@@ -1049,6 +1755,7 @@ AvalancheMicroscopic::TransportElectron(
             endpointsElectrons.push_back(stack[iE]);
           }
           stack.erase(stack.begin() + iE);
+          GARFIELD_COUNT(nErasures, 1);
           if (debug) {
             std::cout << className << "::TransportElectron:\n";
             if (hole) {
@@ -1082,6 +1789,7 @@ AvalancheMicroscopic::TransportElectron(
               endpointsElectrons.push_back(stack[iE]);
             }
             stack.erase(stack.begin() + iE);
+            GARFIELD_COUNT(nErasures, 1);
             ok = false;
             if (debug) {
               std::cout << className << "::TransportElectron:\n";
@@ -1097,7 +1805,7 @@ AvalancheMicroscopic::TransportElectron(
             useBandStructure = false;
           }
           // Update the null-collision rate.
-          fLim = medium->GetElectronNullCollisionRate(band);
+          fLim = GetNullCollisionRate(medium, band, energy);
           if (fLim <= 0.) {
             std::cerr << className << "::TransportElectron:\n"; 
             std::cerr << "    Got null-collision rate <= 0.\n";
@@ -1105,137 +1813,47 @@ AvalancheMicroscopic::TransportElectron(
           }          
         }
 
+        // Free flight up to the next (real or null) collision.
+        fl.x = x; fl.y = y; fl.z = z; fl.t = t; fl.hole = hole;
+        fl.energy = energy; fl.band = band;
+        fl.kx = kx; fl.ky = ky; fl.kz = kz;
+        fl.vx = vx; fl.vy = vy; fl.vz = vz;
+        fl.ex = ex; fl.ey = ey; fl.ez = ez;
+        fl.bx = bx; fl.by = by; fl.bz = bz; fl.bmag = bmag;
+        GARFIELD_TIMER_START(tFlight);
         if (useBfield && bOk) {
-          // Calculate the cyclotron frequency.
-          wb = OmegaCyclotronOverB * bmag;
-          // Rotate the direction vector into the local coordinate system.
-          ComputeRotationMatrix(bx, by, bz, bmag, ex, ey, ez);
-          RotateGlobal2Local(kx, ky, kz);
-          // Calculate the electric field in the rotated system.
-          RotateGlobal2Local(ex, ey, ez);
-          // Calculate the velocity vector in the local frame.
-          const double v = c1 * sqrt(energy);
-          vx = v * kx; vy = v * ky; vz = v * kz;
-          a1 = vx * ex;
-          a2 = c2 * ex * ex;
-          a3 = ez / bmag - vy;
-          a4 = (ez / wb); 
-        } else if (useBandStructure) {
-          energy = medium->GetElectronEnergy(kx, ky, kz, vx, vy, vz, band);
-        } else {
-          // No band structure, no magnetic field.
-          // Calculate the velocity vector.
-          const double v = c1 * sqrt(energy);
-          vx = v * kx; vy = v * ky; vz = v * kz;
-          
-          a1 = vx * ex + vy * ey + vz * ez;
-          a2 = c2 * (ex * ex + ey * ey + ez * ez);
-        }
-
-        if (hasUserHandleStep) {
-          userHandleStep(x, y, z, t, energy, kx, ky, kz, hole);
-        }
-  
-        // Determine the timestep.
-        dt = 0.;
-        while (1) {
-          // Sample the flight time.
-          r = RndmUniformPos();
-          dt += - log(r) / fLim;
-          // Calculate the energy after the proposed step.
-          if (useBfield && bOk) {
-            cwt = cos(wb * dt); swt = sin(wb * dt);
-            newEnergy = std::max(energy + (a1 + a2 * dt) * dt + 
-                                 a4 * (a3 * (1. - cwt) + vz * swt), 
-                                 Small);
-          } else if (useBandStructure) {
-            newEnergy = std::max(medium->GetElectronEnergy(
-                                              kx + ex * dt * SpeedOfLight,
-                                              ky + ey * dt * SpeedOfLight,
-                                              kz + ez * dt * SpeedOfLight, 
-                                              newVx, newVy, newVz, band), 
-                                 Small);
-          } else {
-            newEnergy = std::max(energy + (a1 + a2 * dt) * dt, Small);
-          }
-          // Get the real collision rate at the updated energy.
-          double fReal = medium->GetElectronCollisionRate(newEnergy, band);
-          if (fReal <= 0.) {
-            std::cerr << className << "::TransportElectron:\n";
-            std::cerr << "    Got collision rate <= 0.\n";
-            std::cerr << "    At " << newEnergy << " eV (band " << band << ").\n";
+          if (!Flight<StepMagneticField>(fl, medium, fLim, "TransportElectron")) {
             return false;
           }
-          if (fReal > fLim) {
-            // Real collision rate is higher than null-collision rate.
-            dt += log(r) / fLim;
-            // Increase the null collision rate and try again.
-            std::cerr << className << "::TransportElectron:\n";
-            std::cerr << "    Increasing null-collision rate by 5%.\n"; 
-            if (useBandStructure) std::cerr << "    Band " << band << "\n";
-            fLim *= 1.05;
-            continue;
+        } else if (useBandStructure) {
+          if (!Flight<StepBandStructure>(fl, medium, fLim, "TransportElectron")) {
+            return false;
           }
-
-          // Check for real or null collision.
-          if (RndmUniform() <= fReal / fLim) break;
-          if (useNullCollisionSteps) {
-            isNullCollision = true;
-            break;
+        } else {
+          if (!Flight<StepElectricField>(fl, medium, fLim, "TransportElectron")) {
+            return false;
           }
         }
-        if (!ok) break;
+        GARFIELD_TIMER_STOP(tFlight, cyclesFlight);
+        if (fl.nRateIncreases > 0) RaiseNullCollisionRate(medium, band, fLim);
+        energy = fl.energy; band = fl.band;
+        kx = fl.kx; ky = fl.ky; kz = fl.kz;
+        vx = fl.vx; vy = fl.vy; vz = fl.vz;
+        ex = fl.ex; ey = fl.ey; ez = fl.ez;
+        dt = fl.dt;
+        newEnergy = fl.newEnergy;
+        newKx = fl.newKx; newKy = fl.newKy; newKz = fl.newKz;
+        isNullCollision = fl.isNull;
 
         // Increase the collision counter.
         ++nCollTemp;
 
-        // Update the directions (at instant before collision)
-        // and calculate the proposed new position.
-        if (useBfield && bOk) {
-          // Calculate the new velocity.
-          newVx = vx + 2. * c2 * ex * dt;
-          newVy = vz * swt - a3 * cwt + ez / bmag;
-          newVz = vz * cwt + a3 * swt;
-          // Normalise and rotate back to the lab frame.
-          const double v = sqrt(newVx * newVx + newVy * newVy + 
-                                newVz * newVz);
-          newKx = newVx / v; newKy = newVy / v; newKz = newVz / v; 
-          RotateLocal2Global(newKx, newKy, newKz);
-          // Calculate the step in coordinate space.
-          vx += c2 * ex * dt;
-          ky = (vz * (1. - cwt) - a3 * swt) / (wb * dt) + ez / bmag;
-          kz = (vz * swt + a3 * (1. - cwt)) / (wb * dt); 
-          vy = ky; vz = kz;
-          // Rotate back to the lab frame.
-          RotateLocal2Global(vx, vy, vz);
-        } else if (useBandStructure) {
-          // Update the wave-vector.
-          newKx = kx + ex * dt * SpeedOfLight;
-          newKy = ky + ey * dt * SpeedOfLight;
-          newKz = kz + ez * dt * SpeedOfLight;
-          // Average velocity over the step.
-          vx = 0.5 * (vx + newVx);
-          vy = 0.5 * (vy + newVy);
-          vz = 0.5 * (vz + newVz);
-        } else {
-          // Update the direction.
-          a1 = sqrt(energy / newEnergy);
-          a2 = 0.5 * c1 * dt / sqrt(newEnergy);
-          newKx = kx * a1 + ex * a2; 
-          newKy = ky * a1 + ey * a2; 
-          newKz = kz * a1 + ez * a2;
-
-          // Calculate the step in coordinate space.
-          a1 = c1 * sqrt(energy);
-          a2 = dt * c2; 
-          vx = kx * a1 + ex * a2;
-          vy = ky * a1 + ey * a2;
-          vz = kz * a1 + ez * a2;
-        }
- 
         // Get the electric field and medium at the proposed new position.
+        GARFIELD_TIMER_START(tField);
         sensor->ElectricField(x + vx * dt, y + vy * dt, z + vz * dt, 
                               ex, ey, ez, medium, status);
+        GARFIELD_TIMER_STOP(tField, cyclesField);
+        GARFIELD_COUNT(nFieldEvaluations, 1);
         if (!hole) {
           ex = -ex; ey = -ey; ez = -ez;
         }
@@ -1262,29 +1880,16 @@ AvalancheMicroscopic::TransportElectron(
             xM = x + d * dx; yM = y + d * dy; zM = z + d * dz; 
             // Check if the mid-point is inside the drift medium.
             sensor->ElectricField(xM, yM, zM, ex, ey, ez, medium, status);
+            GARFIELD_COUNT(nFieldEvaluations, 1);
             if (status == 0) {
               x = xM; y = yM; z = zM; t += dt;
             } 
           }
           // Place the endpoint OUTSIDE the drift medium
           x += d * dx; y += d * dy; z += d * dz; 
-          if (useSignal) {
-            if (hole) {
-              sensor->AddSignal(+1, stack[iE].t, 
-                                t - stack[iE].t, 
-                                0.5 * (x + stack[iE].x), 
-                                0.5 * (y + stack[iE].y),
-                                0.5 * (z + stack[iE].z), 
-                                vx, vy, vz);
-            } else {
-              sensor->AddSignal(-1, stack[iE].t,
-                                t - stack[iE].t,
-                                0.5 * (x + stack[iE].x),
-                                0.5 * (y + stack[iE].y),
-                                0.5 * (z + stack[iE].z),
-                                vx, vy, vz);
-            }
-          }
+          signalPolicy::Add(sensor, hole, stack[iE].t, t - stack[iE].t,
+                            0.5 * (x + stack[iE].x), 0.5 * (y + stack[iE].y),
+                            0.5 * (z + stack[iE].z), vx, vy, vz);
           stack[iE].x = x; 
           stack[iE].y = y; 
           stack[iE].z = z;
@@ -1299,6 +1904,7 @@ AvalancheMicroscopic::TransportElectron(
             endpointsElectrons.push_back(stack[iE]);
           }
           stack.erase(stack.begin() + iE);
+          GARFIELD_COUNT(nErasures, 1);
           ok = false;
           if (debug) {
             std::cout << className << "::TransportElectron:\n";
@@ -1341,23 +1947,9 @@ AvalancheMicroscopic::TransportElectron(
           x += d * dx; y += d * dy; z += d * dz;
 
           // If switched on, calculate the induced signal over this step.
-          if (useSignal) {
-            if (hole) {
-              sensor->AddSignal(+1, stack[iE].t,
-                                t - stack[iE].t,
-                                0.5 * (x + stack[iE].x),
-                                0.5 * (y + stack[iE].y),
-                                0.5 * (z + stack[iE].z),
-                                vx, vy, vz);
-            } else {
-              sensor->AddSignal(-1, stack[iE].t, 
-                                t - stack[iE].t, 
-                                0.5 * (x + stack[iE].x), 
-                                0.5 * (y + stack[iE].y),
-                                0.5 * (z + stack[iE].z), 
-                                vx, vy, vz);
-            }
-          }
+          signalPolicy::Add(sensor, hole, stack[iE].t, t - stack[iE].t,
+                            0.5 * (x + stack[iE].x), 0.5 * (y + stack[iE].y),
+                            0.5 * (z + stack[iE].z), vx, vy, vz);
           stack[iE].x = x; 
           stack[iE].y = y; 
           stack[iE].z = z;
@@ -1372,6 +1964,7 @@ AvalancheMicroscopic::TransportElectron(
             endpointsElectrons.push_back(stack[iE]);
           }
           stack.erase(stack.begin() + iE);
+          GARFIELD_COUNT(nErasures, 1);
           ok = false;
           if (debug) {
             std::cout << className << "::TransportElectron:\n";
@@ -1391,20 +1984,14 @@ AvalancheMicroscopic::TransportElectron(
                                   x + vx * dt, y + vy * dt, z + vz * dt,
                                   xCross, yCross, zCross)) {
           // If switched on, calculated the induced signal over this step.
-          if (useSignal) {
+          if (signalPolicy::enabled) {
             dt = sqrt(pow(xCross - x, 2) + 
                       pow(yCross - y, 2) + 
                       pow(zCross - z, 2)) / 
                  sqrt(vx * vx + vy * vy + vz * vz); 
-            if (hole) {
-              sensor->AddSignal(+1, t, dt, 0.5 * (x + xCross),
-                                           0.5 * (y + yCross),
-                                           0.5 * (z + zCross), vx, vy, vz);
-            } else {
-              sensor->AddSignal(-1, t, dt, 0.5 * (x + xCross),
-                                           0.5 * (y + yCross),
-                                           0.5 * (z + zCross), vx, vy, vz);
-            }
+            signalPolicy::Add(sensor, hole, t, dt, 0.5 * (x + xCross),
+                              0.5 * (y + yCross), 0.5 * (z + zCross),
+                              vx, vy, vz);
           }
           stack[iE].x = xCross; 
           stack[iE].y = yCross; 
@@ -1420,6 +2007,7 @@ AvalancheMicroscopic::TransportElectron(
             endpointsElectrons.push_back(stack[iE]);
           }
           stack.erase(stack.begin() + iE);
+          GARFIELD_COUNT(nErasures, 1);
           ok = false;
           if (debug) {
             std::cout << className << "::TransportElectron:\n";
@@ -1430,17 +2018,9 @@ AvalancheMicroscopic::TransportElectron(
         }
         
         // If switched on, calculate the induced signal.
-        if (useSignal) {
-          if (hole) {
-            sensor->AddSignal(+1, t, dt, x + 0.5 * vx * dt,
-                                         y + 0.5 * vy * dt,
-                                         z + 0.5 * vz * dt, vx, vy, vz);
-          } else {
-            sensor->AddSignal(-1, t, dt, x + 0.5 * vx * dt, 
-                                         y + 0.5 * vy * dt,
-                                         z + 0.5 * vy * dt, vx, vy, vz);
-          }
-        }
+        signalPolicy::Add(sensor, hole, t, dt, x + 0.5 * vx * dt,
+                          y + 0.5 * vy * dt, z + 0.5 * vz * dt,
+                          vx, vy, vz);
 
         // Update the coordinates.
         x += vx * dt; y += vy * dt; z += vz * dt; t += dt;
@@ -1471,9 +2051,11 @@ AvalancheMicroscopic::TransportElectron(
         }
         
         // Get the collision type and parameters.
+        GARFIELD_TIMER_START(tCollision);
         medium->GetElectronCollision(newEnergy, cstype, level, 
                                      energy, newKx, newKy, newKz, 
                                      nion, ndxc, band);
+        GARFIELD_TIMER_STOP(tCollision, cyclesCollision);
 
         // If activated, histogram the distance with respect to the
         // last collision.
@@ -1517,9 +2099,8 @@ AvalancheMicroscopic::TransportElectron(
             break;
           // Ionising collision
           case ElectronCollisionTypeIonisation:
-            if (usePlotting && plotIonisations) {
-              viewer->AddIonisationMarker(x, y, z);
-            }
+            plottingPolicy::AddMarker(viewer, usePlotting && plotIonisations,
+                                      ElectronCollisionTypeIonisation, x, y, z);
             if (hasUserHandleIonisation) {
               userHandleIonisation(x, y, z, t, cstype, level, medium);
             }
@@ -1556,7 +2137,7 @@ AvalancheMicroscopic::TransportElectron(
                   newElectron.kz = ctheta;
                 }
                 newElectron.status = 0;
-                newElectron.driftLine.clear();
+                newElectron.driftLine = -1;
                 if (aval && (sizeCut <= 0 || (int)stack.size() < sizeCut)) {
                   stack.push_back(newElectron);
                 }
@@ -1590,7 +2171,7 @@ AvalancheMicroscopic::TransportElectron(
                   newElectron.kz = ctheta;
                 }
                 newElectron.status = 0;
-                newElectron.driftLine.clear();
+                newElectron.driftLine = -1;
                 if (aval && (sizeCut <= 0 || (int)stack.size() < sizeCut)) {
                   stack.push_back(newElectron);
                 }
@@ -1608,9 +2189,8 @@ AvalancheMicroscopic::TransportElectron(
             break;
           // Attachment
           case ElectronCollisionTypeAttachment:
-            if (usePlotting && plotAttachments) {
-              viewer->AddAttachmentMarker(x, y, z);
-            }
+            plottingPolicy::AddMarker(viewer, usePlotting && plotAttachments,
+                                      ElectronCollisionTypeAttachment, x, y, z);
             if (hasUserHandleAttachment) {
               userHandleAttachment(x, y, z, t, cstype, level, medium);
             }
@@ -1628,6 +2208,7 @@ AvalancheMicroscopic::TransportElectron(
               --nElectrons;
             }
             stack.erase(stack.begin() + iE);
+            GARFIELD_COUNT(nErasures, 1);
             ok = false;
             break;
           // Inelastic collision
@@ -1638,9 +2219,8 @@ AvalancheMicroscopic::TransportElectron(
             break;
           // Excitation
           case ElectronCollisionTypeExcitation:
-            if (usePlotting && plotExcitations) {
-              viewer->AddExcitationMarker(x, y, z);
-            }
+            plottingPolicy::AddMarker(viewer, usePlotting && plotExcitations,
+                                      ElectronCollisionTypeExcitation, x, y, z);
             if (hasUserHandleInelastic) {
               userHandleInelastic(x, y, z, t, cstype, level, medium);
             }
@@ -1678,6 +2258,7 @@ AvalancheMicroscopic::TransportElectron(
                   double fx = 0., fy = 0., fz = 0.;
                   sensor->ElectricField(xDxc, yDxc, zDxc, 
                                         fx, fy, fz, dxcMedium, status);
+                  GARFIELD_COUNT(nFieldEvaluations, 1);
                   // Check if this location is inside a drift medium.
                   if (status != 0) continue;
                   // Check if this location is inside the drift area.
@@ -1702,7 +2283,7 @@ AvalancheMicroscopic::TransportElectron(
                   newElectron.ky = sin(phi) * stheta;
                   newElectron.kz = ctheta;
                   newElectron.status = 0;
-                  newElectron.driftLine.clear();
+                  newElectron.driftLine = -1;
                   // Add the electron to the list.
                   stack.push_back(newElectron);
                   // Increment the electron and ion counters.
@@ -1781,11 +2362,8 @@ AvalancheMicroscopic::TransportElectron(
       stack[iE].ky = ky; 
       stack[iE].kz = kz;
       // Add a new point to the drift line (if enabled).
-      if (useDriftLines) {
-        point newPoint;
-        newPoint.x = x; newPoint.y = y; newPoint.z = z; newPoint.t = t;
-        stack[iE].driftLine.push_back(newPoint);
-      }
+      plottingPolicy::AddPoint(driftLines, useDriftLines, stack[iE].driftLine,
+                               x, y, z, t);
     }
   }
   nElectronEndpoints = endpointsElectrons.size();
@@ -1849,10 +2427,43 @@ AvalancheMicroscopic::TransportElectron(
   }
   return true;
     
+}
+
+bool 
+AvalancheMicroscopic::TransportCloud(
+    const int nIonization, 
+    const double x0[], const double y0[], const double z0[], 
+    const double t0[], const double e0[],
+    const double dx0[], const double dy0[], const double dz0[],
+    const bool aval, bool hole, bool deBroglieRecomb, 
+    const double movieframetime[], const int numberofmovieframes) {
+
+  // Select the instantiation of the transport loop.
+  const bool plotting = usePlotting || useDriftLines;
+  if (useSignal) {
+    if (plotting) {
+      return TransportCloudLoop<withSignal, withPlotting>(
+          nIonization, x0, y0, z0, t0, e0, dx0, dy0, dz0, aval, hole, 
+          deBroglieRecomb, movieframetime, numberofmovieframes);
+    }
+    return TransportCloudLoop<withSignal, noPlotting>(
+        nIonization, x0, y0, z0, t0, e0, dx0, dy0, dz0, aval, hole, 
+        deBroglieRecomb, movieframetime, numberofmovieframes);
+  }
+  if (plotting) {
+    return TransportCloudLoop<noSignal, withPlotting>(
+        nIonization, x0, y0, z0, t0, e0, dx0, dy0, dz0, aval, hole, 
+        deBroglieRecomb, movieframetime, numberofmovieframes);
+  }
+  return TransportCloudLoop<noSignal, noPlotting>(
+      nIonization, x0, y0, z0, t0, e0, dx0, dy0, dz0, aval, hole, 
+      deBroglieRecomb, movieframetime, numberofmovieframes);
+
 }
 
   // Azriel new function (based on TransportElectron) to transport the cloud of electrons ions and excitations
-bool AvalancheMicroscopic::TransportCloud(
+template <class signalPolicy, class plottingPolicy>
+bool AvalancheMicroscopic::TransportCloudLoop(
     const int nIonization, const double x0[], const double y0[], const double z0[], const double t0[], const double e0[], const double dx0[], const double dy0[], const double dz0[],
     const bool aval, bool hole, bool deBroglieRecomb, const double movieframetime[], const int numberofmovieframes) {
 
@@ -1873,9 +2484,6 @@ bool AvalancheMicroscopic::TransportCloud(
     std::cerr << "    Sensor is not defined.\n";
     return false;
   }
-  // Numerical prefactors in equation of motion
-  const double c1 = SpeedOfLight * sqrt(2. / ElectronMass);
-  const double c2 = c1 * c1 / 4.;
   
   // Temporary stack of photons produced in the de-excitation cascade.
   std::vector<double> stackPhotonsTime;   stackPhotonsTime.clear();
@@ -1885,11 +2493,13 @@ bool AvalancheMicroscopic::TransportCloud(
   double ex = 0., ey = 0., ez = 0., emag = 0.;
   double bx = 0., by = 0., bz = 0., bmag = 0.;
   int status = 0;
-  // Cyclotron frequency
-  double cwt = 1., swt = 0.;
-  double wb = 0.;
   // Flag indicating if magnetic field is usable
   bool bOk = true;
+  // Magnetic field [Tesla], if it is the same everywhere
+  // (then the sensor is queried only once)
+  const bool uniformBfield = useBfield && sensor->HasUniformMagneticField();
+  double bx0 = 0., by0 = 0., bz0 = 0.;
+  if (uniformBfield) sensor->MagneticField(0., 0., 0., bx0, by0, bz0, status);
   
   // Index of the conduction band (irrelevant for gases)
   int band = -1;
@@ -1898,7 +2508,6 @@ bool AvalancheMicroscopic::TransportCloud(
   double dt = 0.;
   // Direction, velocity and energy after a step
   double newKx = 0., newKy = 0., newKz = 0.;
-  double newVx = 0., newVy = 0., newVz = 0.;
   double newEnergy = 0.;
   // Collision type (elastic, ionisation, attachment, inelastic, ...)
   int cstype;
@@ -1908,10 +2517,8 @@ bool AvalancheMicroscopic::TransportCloud(
   // Number of secondaries
   int nion = 0, ndxc = 0; 
   
-  // Random number
-  double r;
-  // Numerical factors
-  double a1 = 0., a2 = 0., a3 = 0., a4 = 0.;
+  // Free flight between collisions
+  flight fl;
   
   // Clear the stack.
   stack.clear();     
@@ -1923,12 +2530,34 @@ bool AvalancheMicroscopic::TransportCloud(
   int id = 0;
   bool useBandStructure =  false;
   double fLim = 0.;
-  double finer_tracking_factor = 10.;
-  std::cout << "finer_tracking_factor = " << finer_tracking_factor << std::endl << std::endl;
+  // Null-collision rate of the medium and factor by which it is increased
+  // to make sure the field of the cloud and the recombination condition
+  // are accurately simulated
+  double fLimMedium = 0.;
+  double fLimFactor = useAdaptiveNullRate ? nullRateFactorMax : nullRateFactor;
+  if (useAdaptiveNullRate) {
+    std::cout << "Adaptive null-collision rate factor, max. " << nullRateFactorMax 
+              << " within " << nullRateDistance << " Onsager radii" << std::endl << std::endl;
+  } else {
+    std::cout << "Null-collision rate factor = " << nullRateFactor << std::endl << std::endl;
+  }
+  nNullRateSteps = nNullRateStepsMax = 0;
+  sumNullRateFactor = 0.;
   double vx, vy, vz;
   double kx, ky, kz;
   electron newElectron;
   bool first_electron = true;
+  // Kinetic energy above which an electron is reset below the 
+  // ionisation threshold (see the clamp after each step)
+  const double eKineticMax = 8.;
+  // Max. kinetic energy expected in the cloud transport: the largest 
+  // initial energy plus the energy gained in the field of the cloud 
+  // (at most eKineticMax)
+  double eMaxCloud = 0.;
+  for (int i = 0; i < nIonization; ++i) {
+    eMaxCloud = std::max(eMaxCloud, e0[i]);
+  }
+  eMaxCloud += eKineticMax;
 
   // megan: factor to multiply OnsagerRadius that determines distance at which electrons are released
   double onsagerFactor = 0.1;
@@ -2047,9 +2676,10 @@ bool AvalancheMicroscopic::TransportCloud(
       newElectron.xLast = newElectron.x; 
       newElectron.yLast = newElectron.y; 
       newElectron.zLast = newElectron.z;
-      newElectron.driftLine.clear();
+      newElectron.driftLine = -1;
       // megan: add electron id to keep track of them
       newElectron.id = ionization+1;
+      newElectron.frozen = false;
       stack.push_back(newElectron);
 
 //      megan: to verify that onsager radius and potential are correctly incorporated
@@ -2101,7 +2731,8 @@ bool AvalancheMicroscopic::TransportCloud(
       // Get the null-collision rate.
       if (first_electron) {
 	first_electron = false;
-	fLim = medium->GetElectronNullCollisionRate(band)*finer_tracking_factor;
+	fLimMedium = GetNullCollisionRate(medium, band, eMaxCloud);
+	fLim = fLimMedium * fLimFactor;
         //std::cout << "fLim = " << fLim << std::endl;
 	if (fLim <= 0.) {
 	  std::cerr << className << "::Cloud:\n";
@@ -2185,7 +2816,6 @@ bool AvalancheMicroscopic::TransportCloud(
 
   // Status flag
   double dex,dey,dez;
-  double rdist_dx, rdist_dy, rdist_dz;
   double potential_dx, potential_dy, potential_dz;
   double cloud_ex, cloud_ey, cloud_ez;
   double dre;
@@ -2199,6 +2829,26 @@ bool AvalancheMicroscopic::TransportCloud(
   dre = 1e-8;
   bool ok = true;
 
+  // Ion positions, hashed on a grid with a cell size of the order of the
+  // Onsager radius, for finding the ion closest to an electron without
+  // looping over the whole stack. The table is refilled whenever electrons
+  // are added to or removed from the stack.
+  SpatialHash ions;
+  ions.SetCellSize(OnsagerRadius);
+  bool ionsChanged = true;
+  // Thermal energy, for the escape criterion.
+  const double kTemperature = BoltzmannConstant * medium->GetTemperature();
+  // End of the current time slice (lockstep mode)
+  double tSlice = -1.e99;
+  nTimeSlices = 0;
+  // Potential of the distant charges (multi-rate mode), point at which it 
+  // was evaluated, number of electrons/holes at that time and close charges
+  double pFar[4] = {0., 0., 0., 0.};
+  double xFar = 0., yFar = 0., zFar = 0.;
+  int nFar = 0;
+  std::vector<int> nearIons, nearElectrons;
+  nFarFieldEvaluations = nFarFieldSkipped = 0;
+
 // turns true when first particle hits tMax
   // megan: make variables needed for movie
   int framenumber=0;
@@ -2221,6 +2871,36 @@ bool AvalancheMicroscopic::TransportCloud(
     const int nSize = stack.size();
     if (nSize <= 0) break;
 
+    // Stop if all electrons/holes are out of reach of the ions.
+    if (useEscapeCriterion && CheckEscape(OnsagerRadius, kTemperature)) {
+      if (debug) {
+        std::cout << className << "::TransportCloud:\n";
+        std::cout << "    " << nSize << " electrons/holes escaped.\n";
+      }
+      RetireEscaped();
+      ionsChanged = true;
+      break;
+    }
+
+    // In lockstep mode, open the next time slice once all electrons/holes
+    // have reached the end of the current one.
+    if (useTimeSlices) {
+      double tFirst = stack[0].t;
+      for (int iE = nSize; iE--;) tFirst = std::min(tFirst, stack[iE].t);
+      if (tFirst > tSlice) {
+        GARFIELD_TIMER_START(tCloud);
+        tSlice = tFirst + FreezeCloudField(DielectricConst, dre);
+        GARFIELD_TIMER_STOP(tCloud, cyclesCloud);
+        GARFIELD_COUNT(nCloudPairs, stack.size() * (2 * stack.size() - 1));
+        ++nTimeSlices;
+        if (debug) {
+          std::cout << className << "::TransportCloud:\n";
+          std::cout << "    Time slice " << nTimeSlices << " from " 
+                    << tFirst << " to " << tSlice << " ns.\n";
+        }
+      }
+    }
+
     // Loop over all electrons/holes in the avalanche.
     for (int iE = nSize; iE--;) {
       // Get an electron/hole from the stack.
@@ -2236,8 +2916,6 @@ bool AvalancheMicroscopic::TransportCloud(
       hole = stack[iE].hole;
 
       //      std::cout << "Electron from stack (xi,yi,zi,x,y,z,t) " << stack[iE].xi << " "  << stack[iE].yi << " " << stack[iE].zi << " " << x << " " << y << " " << z << " " << t << "\n";
-      minDistIon = 1e99;
-      minDistIonIndex = -1;
       
       ok = true;
       
@@ -2245,7 +2923,10 @@ bool AvalancheMicroscopic::TransportCloud(
       int nCollTemp = 0;
 
       // Get the local electric field and medium.
+      GARFIELD_TIMER_START(tField);
       sensor->ElectricField(x, y, z, ex, ey, ez, medium, status);
+      GARFIELD_TIMER_STOP(tField, cyclesField);
+      GARFIELD_COUNT(nFieldEvaluations, 1);
 
 
       // Azriel Here add the electric field from the ions and other electrons
@@ -2291,53 +2972,59 @@ bool AvalancheMicroscopic::TransportCloud(
 
       }
 
-      if (iE != toldestindex && n2Size>0) continue;
+      if (useTimeSlices) {
+        // Skip electrons/holes which have reached the end of the slice.
+        if (t > tSlice) continue;
+      } else if (iE != toldestindex && n2Size>0) continue;
 
-      // since we just declared n2Size = stack.size(), this will always be the correct stack size      
-      for (int iE2 = n2Size; iE2--;) {
-       
-	x2 = stack[iE2].x; 
-	y2 = stack[iE2].y; 
-	z2 = stack[iE2].z;
-
-	xion = stack[iE2].xi; 
-	yion = stack[iE2].yi; 
-	zion = stack[iE2].zi;
-	
-	// distance to ions (calculations assume we are computing the force on a positive charge)
-	// field is then reversed if indeed we are tracking an electron (most common case)
-	rdist = sqrt((xion-x)*(xion-x)+(yion-y)*(yion-y)+(zion-z)*(zion-z));
-	// std::cout << "Location 1 distance to ion: "<< rdist << "\n";
-	potential += ElementaryCharge/(4*Pi*DielectricConst*rdist);
-	rdist_dx = sqrt((xion-(x+dre))*(xion-(x+dre))+(yion-y)*(yion-y)+(zion-z)*(zion-z));
-	potential_dx += ElementaryCharge/(4*Pi*DielectricConst*rdist_dx);
-	rdist_dy = sqrt((xion-x)*(xion-x)+(yion-(y+dre))*(yion-(y+dre))+(zion-z)*(zion-z));
-	potential_dy += ElementaryCharge/(4*Pi*DielectricConst*rdist_dy);
-	rdist_dz = sqrt((xion-x)*(xion-x)+(yion-y)*(yion-y)+(zion-(z+dre))*(zion-(z+dre)));
-	potential_dz += ElementaryCharge/(4*Pi*DielectricConst*rdist_dz);
-
-        // store shortest distance to ion for recombination
-        if (rdist < minDistIon){
-          minDistIon = rdist;
-          minDistIonIndex = iE2;
+      // Find the closest ion (for the recombination check).
+      if (ionsChanged) {
+        FillIonTable(ions);
+        ionsChanged = false;
+      }
+      ions.FindNearest(x, y, z, minDistIonIndex, minDistIon);
+
+      GARFIELD_TIMER_START(tCloud);
+      if (useTimeSlices) {
+        // Use the cloud potential frozen at the start of the slice.
+        if (!stack[iE].frozen) {
+          // Electron/hole was produced during the slice.
+          double rCharge = 0.;
+          electron& e = stack[iE];
+          ComputeCloudPotential(iE, x, y, z, DielectricConst, dre,
+                                e.cloudPotential[0], e.cloudPotential[1],
+                                e.cloudPotential[2], e.cloudPotential[3],
+                                rCharge);
+          GARFIELD_COUNT(nCloudPairs, 2 * stack.size() - 1);
+          e.frozen = true;
         }
-
-	// distance to electron
-	rdist = sqrt((x2-x)*(x2-x)+(y2-y)*(y2-y)+(z2-z)*(z2-z));  
-	rdist_dx = sqrt((x2-(x+dre))*(x2-(x+dre))+(y2-y)*(y2-y)+(z2-z)*(z2-z));
-	rdist_dy = sqrt((x2-x)*(x2-x)+(y2-(y+dre))*(y2-(y+dre))+(z2-z)*(z2-z));
-	rdist_dz = sqrt((x2-x)*(x2-x)+(y2-y)*(y2-y)+(z2-(z+dre))*(z2-(z+dre)));
-
-	if (iE != iE2) {
-	  // potential from electrons excluding self
-	  potential -= ElementaryCharge/(4*Pi*DielectricConst*rdist);
-	  potential_dx -= ElementaryCharge/(4*Pi*DielectricConst*rdist_dx);
-	  potential_dy -= ElementaryCharge/(4*Pi*DielectricConst*rdist_dy);
-	  potential_dz -= ElementaryCharge/(4*Pi*DielectricConst*rdist_dz);
- //std::cout << "top potential for last electron " << stack[iE].id << ", iE " << iE << " of stack size " << stack.size() << " from electron " << stack[iE2].id << ", iE2 " << iE2
- //<< " : "  << ElementaryCharge/(4*Pi*DielectricConst*rdist) << std::endl;
-	}	
+        potential    = stack[iE].cloudPotential[0];
+        potential_dx = stack[iE].cloudPotential[1];
+        potential_dy = stack[iE].cloudPotential[2];
+        potential_dz = stack[iE].cloudPotential[3];
+      } else if (useMultiRateField) {
+        // The other electrons/holes have moved since the last trace.
+        ComputeFarPotential(iE, x, y, z, DielectricConst, dre, pFar,
+                            nearIons, nearElectrons);
+        GARFIELD_COUNT(nCloudPairs, 2 * stack.size() - 1);
+        xFar = x; yFar = y; zFar = z;
+        nFar = stack.size();
+        ++nFarFieldEvaluations;
+        potential    = pFar[0];
+        potential_dx = pFar[1];
+        potential_dy = pFar[2];
+        potential_dz = pFar[3];
+        ComputeNearPotential(x, y, z, DielectricConst, dre, 
+                             nearIons, nearElectrons, potential, 
+                             potential_dx, potential_dy, potential_dz);
+      } else {
+        double rCharge = 0.;
+        ComputeCloudPotential(iE, x, y, z, DielectricConst, dre,
+                              potential, potential_dx, potential_dy, 
+                              potential_dz, rCharge);
+        GARFIELD_COUNT(nCloudPairs, 2 * stack.size() - 1);
       }
+      GARFIELD_TIMER_STOP(tCloud, cyclesCloud);
 
       if (minDistIon > stack[iE].mdimax) stack[iE].mdimax = minDistIon;
 
@@ -2365,6 +3052,10 @@ bool AvalancheMicroscopic::TransportCloud(
 
       // Azriel here need to add protections if field too high (near charges)
 
+      fLimFactor = ComputeNullRateFactor(minDistIon, OnsagerRadius,
+                                         sqrt(cloud_ex * cloud_ex + cloud_ey * cloud_ey + cloud_ez * cloud_ez),
+                                         sqrt(ex * ex + ey * ey + ez * ez));
+
       // if (potential > 1.0) { std::cerr << "V: " << potential << " " << x << " " << y << " " << z << "\n";}
 
       // if the electric field between x,y,z and x+dre,y+dre,z+dre is greater than 4.445e8 V/cm,
@@ -2376,6 +3067,7 @@ bool AvalancheMicroscopic::TransportCloud(
         ey += cloud_ey;
         ez += cloud_ez;
       } else {
+        GARFIELD_COUNT(nClamps, 1);
         std::cout << "High cloud electric field of " << sqrt(cloud_ex*cloud_ex + cloud_ey*cloud_ey + cloud_ez*cloud_ez) 
         << " eV calculated, using only electric field due to electrodes" << std::endl;
         std::cout << "    potential " << potential << " p_dx " << potential_dx << " p_dy " << potential_dy << " p_dz " << potential_dz << std::endl;
@@ -2418,6 +3110,8 @@ bool AvalancheMicroscopic::TransportCloud(
           endpointsElectrons.push_back(stack[iE]);
         }
         stack.erase(stack.begin() + iE);
+        GARFIELD_COUNT(nErasures, 1);
+        ionsChanged = true;
         if (debug) {
           std::cout << className << "::TransportCloud:\n";
           if (hole) {
@@ -2432,7 +3126,11 @@ bool AvalancheMicroscopic::TransportCloud(
 
       // If switched on, get the local magnetic field.
       if (useBfield) {
-        sensor->MagneticField(x, y, z, bx, by, bz, status);
+        if (uniformBfield) {
+          bx = bx0; by = by0; bz = bz0;
+        } else {
+          sensor->MagneticField(x, y, z, bx, by, bz, status);
+        }
         if (hole) {
           bx *=  Tesla2Internal; 
           by *=  Tesla2Internal;
@@ -2459,6 +3157,7 @@ bool AvalancheMicroscopic::TransportCloud(
       //if () framenumber++;
 //old      if (t>=movieframetime[framenumber]&&(t<movieframetime[framenumber+1]||framenumber+1==numberofmovieframes)&&framenumber<numberofmovieframes) {
         if (numberofmovieframes!=0&&t>=movieframetime[framenumber]&&framenumber<=numberofmovieframes) {
+          GARFIELD_TIMER_START(tOutput);
           framenumber++;
           int numelectrons = stack.size();
           
@@ -2482,6 +3181,7 @@ bool AvalancheMicroscopic::TransportCloud(
               << " minDistIonMax= " << stack[i].mdimax << std::endl << std::endl;
             } 
           } 
+          GARFIELD_TIMER_STOP(tOutput, cyclesOutput);
         }
 /*       
         if (t>=tMax&&tMaxprint==0) {
@@ -2560,6 +3260,8 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
             endpointsElectrons.push_back(stack[iE]);
           }
           stack.erase(stack.begin() + iE);
+          GARFIELD_COUNT(nErasures, 1);
+          ionsChanged = true;
           if (debug) {
             std::cout << className << "::TransportCloud:\n";
             std::cout << "    Kinetic energy (" << energy << ")"
@@ -2604,6 +3306,8 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
 //int testvar = stack.begin();
 //std::cout << "on time out check stack.begin(): " << testvar << std::endl;
           stack.erase(stack.begin() + iE);
+          GARFIELD_COUNT(nErasures, 1);
+          ionsChanged = true;
           if (debug) {
             std::cout << className << "::TransportCloud:\n";
             if (hole) {
@@ -2639,6 +3343,8 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
               endpointsElectrons.push_back(stack[iE]);
             }
             stack.erase(stack.begin() + iE);
+            GARFIELD_COUNT(nErasures, 1);
+            ionsChanged = true;
             ok = false;
             if (debug) {
               std::cout << className << "::TransportCloud:\n";
@@ -2654,7 +3360,9 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
             useBandStructure = false;
           }
           // Update the null-collision rate.
-          fLim = medium->GetElectronNullCollisionRate(band)*finer_tracking_factor;
+          fLimMedium = GetNullCollisionRate(medium, band, 
+                                            std::max(eMaxCloud, energy));
+          fLim = fLimMedium * fLimFactor;
           if (fLim <= 0.) {
             std::cerr << className << "::TransportCloud:\n"; 
             std::cerr << "    Got null-collision rate <= 0.\n";
@@ -2662,160 +3370,46 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
           }          
         }
 
+        // Null-collision rate increased by the factor for the current position.
+        fLim = fLimMedium * fLimFactor;
+        // Free flight up to the next (real or null) collision.
+        fl.x = x; fl.y = y; fl.z = z; fl.t = t; fl.hole = hole;
+        fl.energy = energy; fl.band = band;
+        fl.kx = kx; fl.ky = ky; fl.kz = kz;
+        fl.vx = vx; fl.vy = vy; fl.vz = vz;
+        fl.ex = ex; fl.ey = ey; fl.ez = ez;
+        fl.bx = bx; fl.by = by; fl.bz = bz; fl.bmag = bmag;
+        GARFIELD_TIMER_START(tFlight);
         if (useBfield && bOk) {
-          // Calculate the cyclotron frequency.
-          wb = OmegaCyclotronOverB * bmag;
-          // Rotate the direction vector into the local coordinate system.
-          ComputeRotationMatrix(bx, by, bz, bmag, ex, ey, ez);
-          RotateGlobal2Local(kx, ky, kz);
-          // Calculate the electric field in the rotated system.
-          RotateGlobal2Local(ex, ey, ez);
-          // Calculate the velocity vector in the local frame.
-          const double v = c1 * sqrt(energy);
-          vx = v * kx; vy = v * ky; vz = v * kz;
-          a1 = vx * ex;
-          a2 = c2 * ex * ex;
-          a3 = ez / bmag - vy;
-          a4 = (ez / wb); 
-        } else if (useBandStructure) {
-          energy = medium->GetElectronEnergy(kx, ky, kz, vx, vy, vz, band);
-        } else {
-          // No band structure, no magnetic field.
-          // Calculate the velocity vector.
-          const double v = c1 * sqrt(energy);
-          vx = v * kx; vy = v * ky; vz = v * kz;
-          
-          a1 = vx * ex + vy * ey + vz * ez;
-          a2 = c2 * (ex * ex + ey * ey + ez * ez);
-        }
-
-        if (hasUserHandleStep) {
-          userHandleStep(x, y, z, t, energy, kx, ky, kz, hole);
-        }
-  
-        // Determine the timestep.
-        dt = 0.;
-        while (1) {
-          // Sample the flight time.
-          r = RndmUniformPos();
-	  // Azriel increase the null collision rate by finer_tracking_factor to make sure field transport and 
-	  // recombination condition are accurately simulated 
-	  // may be more natural to make this rate as a function of the onsager radius 
-//std::cout << "null coll stepwise (x,y-.2,z,t,energy,electron,nCollTemp,counter_steps) " << x << " " << y-.2 << " " << z << " " << t << " " << energy << " " ;
-//std::cout << stack[iE].id << " " << nCollTemp << " " << counter_steps << std::endl;
-          dt += - log(r) / fLim ;
-          // Calculate the energy after the proposed step.
-          if (useBfield && bOk) {
-            cwt = cos(wb * dt); swt = sin(wb * dt);
-            newEnergy = std::max(energy + (a1 + a2 * dt) * dt + 
-                                 a4 * (a3 * (1. - cwt) + vz * swt), 
-                                 Small);
-          } else if (useBandStructure) {
-            newEnergy = std::max(medium->GetElectronEnergy(
-                                              kx + ex * dt * SpeedOfLight,
-                                              ky + ey * dt * SpeedOfLight,
-                                              kz + ez * dt * SpeedOfLight, 
-                                              newVx, newVy, newVz, band), 
-                                 Small);
-          } else {
-            newEnergy = std::max(energy + (a1 + a2 * dt) * dt, Small);
-          }
-          // Get the real collision rate at the updated energy.
-          double fReal = medium->GetElectronCollisionRate(newEnergy, band);
-          if (fReal <= 0.) {
-            std::cerr << className << "::TransportCloud:\n";
-            std::cerr << "    Got collision rate <= 0.\n";
-            std::cerr << "    At " << newEnergy << " eV (band " << band << ").\n";
+          if (!Flight<StepMagneticField>(fl, medium, fLim, "TransportCloud")) {
             return false;
           }
-          if (fReal > fLim) {
-            // Real collision rate is higher than null-collision rate.
-            dt += log(r) / fLim;
-            // Increase the null collision rate and try again.
-            std::cerr << className << "::TransportCloud:\n";
-            std::cerr << "    Increasing null-collision rate by 5%.\n"; 
-            if (useBandStructure) std::cerr << "    Band " << band << "\n";
-            fLim *= 1.05;
-            continue;
-          }
-
-//std::cout << " fLim= " << fLim << " fReal= " << fReal << " newEnergy= " << newEnergy << " null= " << isNullCollision
-//<< " dt= " << dt << " x= " << x << "\n";
-
-          // Check for real or null collision.
-          if (RndmUniform() <= fReal / fLim) {
-//std::cout << "fReal= " << fReal << " newEnergy= " << newEnergy << " null= R "
-//<< " dt= " << dt << " x= " << x << " y= " << y << " z= " << z;
-            break;
+        } else if (useBandStructure) {
+          if (!Flight<StepBandStructure>(fl, medium, fLim, "TransportCloud")) {
+            return false;
           }
-          if (useNullCollisionSteps) {
-            isNullCollision = true;
-
-//std::cout << "fReal= " << fReal << " newEnergy= " << newEnergy << " null= " << isNullCollision
-//<< " dt= " << dt << " x= " << x << " y= " << y << " z= " << z;
-            break;
-          } else {
-//std::cout << "fReal= " << fReal << " newEnergy= " << newEnergy << " null= " << isNullCollision
-//<< " dt= " << dt << " x= " << x << " y= " << y << " z= " << z << " vx= " << vx << " dx= " << 0 << "\n";
+        } else {
+          if (!Flight<StepElectricField>(fl, medium, fLim, "TransportCloud")) {
+            return false;
           }
         }
-        if (!ok) break;
+        GARFIELD_TIMER_STOP(tFlight, cyclesFlight);
+        if (fl.nRateIncreases > 0) {
+          fLimMedium = fLim / fLimFactor;
+          RaiseNullCollisionRate(medium, band, fLimMedium);
+        }
+        energy = fl.energy; band = fl.band;
+        kx = fl.kx; ky = fl.ky; kz = fl.kz;
+        vx = fl.vx; vy = fl.vy; vz = fl.vz;
+        ex = fl.ex; ey = fl.ey; ez = fl.ez;
+        dt = fl.dt;
+        newEnergy = fl.newEnergy;
+        newKx = fl.newKx; newKy = fl.newKy; newKz = fl.newKz;
+        isNullCollision = fl.isNull;
 
         // Increase the collision counter.
         ++nCollTemp;
 
-//if (!isNullCollision) {
-//std::cout << "real coll stepwise (x,y-.2,z,t,energy,potential,electron,nCollTemp) " << x << " " << y-.2 << " " << z << " " ;
-//old std::cout << sqrt((stack[iE].x-x)*(stack[iE].x-x)+(stack[iE].y-y)*(stack[iE].y-y)+(stack[iE].z-z)*(stack[iE].z-z)) << " " << t << " " << t-stack[iE].t << " " << newEnergy << " " ;
-//std::cout << t << " " << newEnergy << " " ;
-//std::cout << potential << " " << stack[iE].id << " " << nCollTemp << std::endl;
-//}
-        // Update the directions (at instant before collision)
-        // and calculate the proposed new position.
-        if (useBfield && bOk) {
-          // Calculate the new velocity.
-          newVx = vx + 2. * c2 * ex * dt;
-          newVy = vz * swt - a3 * cwt + ez / bmag;
-          newVz = vz * cwt + a3 * swt;
-          // Normalise and rotate back to the lab frame.
-          const double v = sqrt(newVx * newVx + newVy * newVy + 
-                                newVz * newVz);
-          newKx = newVx / v; newKy = newVy / v; newKz = newVz / v; 
-          RotateLocal2Global(newKx, newKy, newKz);
-          // Calculate the step in coordinate space.
-          vx += c2 * ex * dt;
-          ky = (vz * (1. - cwt) - a3 * swt) / (wb * dt) + ez / bmag;
-          kz = (vz * swt + a3 * (1. - cwt)) / (wb * dt); 
-          vy = ky; vz = kz;
-          // Rotate back to the lab frame.
-          RotateLocal2Global(vx, vy, vz);
-
-          //          std::cout << "Yasu: " << vx << " " << vy << " " << vz << std::endl;
-        } else if (useBandStructure) {
-          // Update the wave-vector.
-          newKx = kx + ex * dt * SpeedOfLight;
-          newKy = ky + ey * dt * SpeedOfLight;
-          newKz = kz + ez * dt * SpeedOfLight;
-          // Average velocity over the step.
-          vx = 0.5 * (vx + newVx);
-          vy = 0.5 * (vy + newVy);
-          vz = 0.5 * (vz + newVz);
-        } else {
-          // Update the direction.
-          a1 = sqrt(energy / newEnergy);
-          a2 = 0.5 * c1 * dt / sqrt(newEnergy);
-          newKx = kx * a1 + ex * a2; 
-          newKy = ky * a1 + ey * a2; 
-          newKz = kz * a1 + ez * a2;
-
-          // Calculate the step in coordinate space.
-          a1 = c1 * sqrt(energy);
-          a2 = dt * c2; 
-          vx = kx * a1 + ex * a2;
-          vy = ky * a1 + ey * a2;
-          vz = kz * a1 + ez * a2;
-        }
- 
         // Get the electric field and medium at the proposed new position:
 	x3 = x + vx * dt;
 	y3 = y + vy * dt;
@@ -2826,8 +3420,11 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
 //<< " v= " << sqrt(vx*vx + vy*vy + vz*vz) << " vcalc= " << sqrt(2*energy*1.60217657e-19/9.10938215e-31)*1e-7 << " dist= " << sqrt((x-x3)*(x-x3)+(y-y3)*(y-y3)+(z-z3)*(z-z3)) 
 //<< " t= " << t << " x= " << x << "\n";
 
+        GARFIELD_TIMER_START(tField);
         sensor->ElectricField(x3, y3, z3, 
                               ex, ey, ez, medium, status);
+        GARFIELD_TIMER_STOP(tField, cyclesField);
+        GARFIELD_COUNT(nFieldEvaluations, 1);
 
 	// add here the field from elelctrons and ions in the event
 	potential = 0.;
@@ -2835,55 +3432,54 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
 	potential_dy = 0.;
 	potential_dz = 0.;
 	
-	minDistIon = 1e99;
-	minDistIonIndex = -1;
+	// Find the closest ion (for the recombination check).
+	if (ionsChanged) {
+	  FillIonTable(ions);
+	  ionsChanged = false;
+	}
+	ions.FindNearest(x3, y3, z3, minDistIonIndex, minDistIon);
 
 	// consider all the ions/electrons that still exist
-        // megan: used to be iE2 = n1Size -  wrong varible (it is from the beginning of the simulation when the initial kinetic energy is corrected,
-        // always equal to size of original cloud). using stack.size() always gets the correct size after recombinations and electrons that have timed out.
-	for (int iE2 = stack.size(); iE2--;) {
-
-	  x2 = stack[iE2].x; 
-	  y2 = stack[iE2].y; 
-	  z2 = stack[iE2].z;
-
-	  xion = stack[iE2].xi; 
-	  yion = stack[iE2].yi; 
-	  zion = stack[iE2].zi;
-	  
-          // distance to ions (calculations assume we are computing the force on a positive charge)
-          // field is then reversed if indeed we are tracking an electron (most common case)
-	  rdist = sqrt((xion-x3)*(xion-x3)+(yion-y3)*(yion-y3)+(zion-z3)*(zion-z3));
-	  // std::cout << "Location 1 distance to ion: " << rdist << "\n" ;
-	  potential += ElementaryCharge/(4*Pi*DielectricConst*rdist);
-	  rdist_dx = sqrt((xion-(x3+dre))*(xion-(x3+dre))+(yion-y3)*(yion-y3)+(zion-z3)*(zion-z3));
-	  potential_dx += ElementaryCharge/(4*Pi*DielectricConst*rdist_dx);
-	  rdist_dy = sqrt((xion-x3)*(xion-x3)+(yion-(y3+dre))*(yion-(y3+dre))+(zion-z3)*(zion-z3));
-	  potential_dy += ElementaryCharge/(4*Pi*DielectricConst*rdist_dy);
-	  rdist_dz = sqrt((xion-x3)*(xion-x3)+(yion-y3)*(yion-y3)+(zion-(z3+dre))*(zion-(z3+dre)));
-	  potential_dz += ElementaryCharge/(4*Pi*DielectricConst*rdist_dz);
-
-	  // store shortest distance to ion for recombination
-	  if (rdist < minDistIon){
-	    minDistIon = rdist;
-	    minDistIonIndex = iE2;
+	// (in lockstep mode, the cloud field is frozen within the slice)
+	GARFIELD_TIMER_START(tCloud);
+	if (useTimeSlices) {
+	  potential    = stack[iE].cloudPotential[0];
+	  potential_dx = stack[iE].cloudPotential[1];
+	  potential_dy = stack[iE].cloudPotential[2];
+	  potential_dz = stack[iE].cloudPotential[3];
+	} else if (useMultiRateField) {
+	  // Re-evaluate the potential of the distant charges only if 
+	  // the electron/hole has moved too far or charges have been added.
+	  const double dFar = multiRateTolerance * multiRateDistance;
+	  const double d2 = (x3 - xFar) * (x3 - xFar) + (y3 - yFar) * (y3 - yFar) +
+	                    (z3 - zFar) * (z3 - zFar);
+	  if (d2 > dFar * dFar || (int)stack.size() != nFar) {
+	    ComputeFarPotential(iE, x3, y3, z3, DielectricConst, dre, pFar,
+	                        nearIons, nearElectrons);
+	    GARFIELD_COUNT(nCloudPairs, 2 * stack.size() - 1 - 
+	                   nearIons.size() - nearElectrons.size());
+	    xFar = x3; yFar = y3; zFar = z3;
+	    nFar = stack.size();
+	    ++nFarFieldEvaluations;
+	  } else {
+	    ++nFarFieldSkipped;
 	  }
-	  // distance to electrons
-	  rdist = sqrt((x2-x3)*(x2-x3)+(y2-y3)*(y2-y3)+(z2-z3)*(z2-z3));  
-	  rdist_dx = sqrt((x2-(x3+dre))*(x2-(x3+dre))+(y2-y3)*(y2-y3)+(z2-z3)*(z2-z3));
-	  rdist_dy = sqrt((x2-x3)*(x2-x3)+(y2-(y3+dre))*(y2-(y3+dre))+(z2-z3)*(z2-z3));
-	  rdist_dz = sqrt((x2-x3)*(x2-x3)+(y2-y3)*(y2-y3)+(z2-(z3+dre))*(z2-(z3+dre)));
-	  
-	  if (iE != iE2) {
-	    // potential from electrons excluding self
-	    potential -= ElementaryCharge/(4*Pi*DielectricConst*rdist);
-	    potential_dx -= ElementaryCharge/(4*Pi*DielectricConst*rdist_dx);
-	    potential_dy -= ElementaryCharge/(4*Pi*DielectricConst*rdist_dy);
-	    potential_dz -= ElementaryCharge/(4*Pi*DielectricConst*rdist_dz);
-// std::cout << "mid-trace potential for last electron " << stack[iE].id << ", iE " << iE << " of stack size " << stack.size() << " from electron " << stack[iE2].id << ", iE2 " << iE2
-// << " : "  << ElementaryCharge/(4*Pi*DielectricConst*rdist) << std::endl;
-	  }	
+	  potential    = pFar[0];
+	  potential_dx = pFar[1];
+	  potential_dy = pFar[2];
+	  potential_dz = pFar[3];
+	  ComputeNearPotential(x3, y3, z3, DielectricConst, dre, 
+	                       nearIons, nearElectrons, potential, 
+	                       potential_dx, potential_dy, potential_dz);
+	  GARFIELD_COUNT(nCloudPairs, nearIons.size() + nearElectrons.size());
+	} else {
+	  double rCharge = 0.;
+	  ComputeCloudPotential(iE, x3, y3, z3, DielectricConst, dre,
+	                        potential, potential_dx, potential_dy, 
+	                        potential_dz, rCharge);
+	  GARFIELD_COUNT(nCloudPairs, 2 * stack.size() - 1);
 	}
+	GARFIELD_TIMER_STOP(tCloud, cyclesCloud);
 
 	// if (potential > 4.0) { std::cerr << "V: " << potential << " " << x << " " << y << " " << z << "\n";}
 
@@ -2908,6 +3504,10 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
           << sqrt(cloud_ex*cloud_ex + cloud_ey*cloud_ey + cloud_ez*cloud_ez) << " " << counter_steps << " " << minDistIon << std::endl << std::endl;
         }
 
+        fLimFactor = ComputeNullRateFactor(minDistIon, OnsagerRadius,
+                                           sqrt(cloud_ex * cloud_ex + cloud_ey * cloud_ey + cloud_ez * cloud_ez),
+                                           sqrt(ex * ex + ey * ey + ez * ez));
+
         // if the electric field between x,y,z and x+dre,y+dre,z+dre is greater than 4.445e8 V/cm,
         // equal to the electric field at the radius from a +1 ion where the electron has a potential of -8eV,
         // use only electric field due to parallel plates
@@ -2916,6 +3516,7 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
           ey += cloud_ey;
           ez += cloud_ez;
         } else {
+          GARFIELD_COUNT(nClamps, 1);
           std::cout << "High cloud electric field of " << sqrt(cloud_ex*cloud_ex + cloud_ey*cloud_ey + cloud_ez*cloud_ez)
           << " eV calculated, using only electric field due to electrodes" << std::endl;
           std::cout << "    potential " << potential << " p_dx " << potential_dx << " p_dy " << potential_dy << " p_dz " << potential_dz << std::endl;
@@ -2960,29 +3561,16 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
             xM = x + d * dx; yM = y + d * dy; zM = z + d * dz; 
             // Check if the mid-point is inside the drift medium.
             sensor->ElectricField(xM, yM, zM, ex, ey, ez, medium, status);
+            GARFIELD_COUNT(nFieldEvaluations, 1);
             if (status == 0) {
               x = xM; y = yM; z = zM; t += dt;
             } 
           }
           // Place the endpoint OUTSIDE the drift medium
           x += d * dx; y += d * dy; z += d * dz; 
-          if (useSignal) {
-            if (hole) {
-              sensor->AddSignal(+1, stack[iE].t, 
-                                t - stack[iE].t, 
-                                0.5 * (x + stack[iE].x), 
-                                0.5 * (y + stack[iE].y),
-                                0.5 * (z + stack[iE].z), 
-                                vx, vy, vz);
-            } else {
-              sensor->AddSignal(-1, stack[iE].t,
-                                t - stack[iE].t,
-                                0.5 * (x + stack[iE].x),
-                                0.5 * (y + stack[iE].y),
-                                0.5 * (z + stack[iE].z),
-                                vx, vy, vz);
-            }
-          }
+          signalPolicy::Add(sensor, hole, stack[iE].t, t - stack[iE].t,
+                            0.5 * (x + stack[iE].x), 0.5 * (y + stack[iE].y),
+                            0.5 * (z + stack[iE].z), vx, vy, vz);
           stack[iE].x = x; 
           stack[iE].y = y; 
           stack[iE].z = z;
@@ -2997,6 +3585,8 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
             endpointsElectrons.push_back(stack[iE]);
           }
           stack.erase(stack.begin() + iE);
+          GARFIELD_COUNT(nErasures, 1);
+          ionsChanged = true;
           ok = false;
           if (debug) {
             std::cout << className << "::TransportCloud:\n";
@@ -3041,23 +3631,9 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
           x += d * dx; y += d * dy; z += d * dz;
 
           // If switched on, calculate the induced signal over this step.
-          if (useSignal) {
-            if (hole) {
-              sensor->AddSignal(+1, stack[iE].t,
-                                t - stack[iE].t,
-                                0.5 * (x + stack[iE].x),
-                                0.5 * (y + stack[iE].y),
-                                0.5 * (z + stack[iE].z),
-                                vx, vy, vz);
-            } else {
-              sensor->AddSignal(-1, stack[iE].t, 
-                                t - stack[iE].t, 
-                                0.5 * (x + stack[iE].x), 
-                                0.5 * (y + stack[iE].y),
-                                0.5 * (z + stack[iE].z), 
-                                vx, vy, vz);
-            }
-          }
+          signalPolicy::Add(sensor, hole, stack[iE].t, t - stack[iE].t,
+                            0.5 * (x + stack[iE].x), 0.5 * (y + stack[iE].y),
+                            0.5 * (z + stack[iE].z), vx, vy, vz);
           stack[iE].x = x; 
           stack[iE].y = y; 
           stack[iE].z = z;
@@ -3072,6 +3648,8 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
             endpointsElectrons.push_back(stack[iE]);
           }
           stack.erase(stack.begin() + iE);
+          GARFIELD_COUNT(nErasures, 1);
+          ionsChanged = true;
           ok = false;
           if (debug) {
             std::cout << className << "::TransportCloud:\n";
@@ -3091,20 +3669,14 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
                                   x + vx * dt, y + vy * dt, z + vz * dt,
                                   xCross, yCross, zCross)) {
           // If switched on, calculated the induced signal over this step.
-          if (useSignal) {
+          if (signalPolicy::enabled) {
             dt = sqrt(pow(xCross - x, 2) + 
                       pow(yCross - y, 2) + 
                       pow(zCross - z, 2)) / 
                  sqrt(vx * vx + vy * vy + vz * vz); 
-            if (hole) {
-              sensor->AddSignal(+1, t, dt, 0.5 * (x + xCross),
-                                           0.5 * (y + yCross),
-                                           0.5 * (z + zCross), vx, vy, vz);
-            } else {
-              sensor->AddSignal(-1, t, dt, 0.5 * (x + xCross),
-                                           0.5 * (y + yCross),
-                                           0.5 * (z + zCross), vx, vy, vz);
-            }
+            signalPolicy::Add(sensor, hole, t, dt, 0.5 * (x + xCross),
+                              0.5 * (y + yCross), 0.5 * (z + zCross),
+                              vx, vy, vz);
           }
           stack[iE].x = xCross; 
           stack[iE].y = yCross; 
@@ -3122,6 +3694,8 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
             endpointsElectrons.push_back(stack[iE]);
           }
           stack.erase(stack.begin() + iE);
+          GARFIELD_COUNT(nErasures, 1);
+          ionsChanged = true;
           ok = false;
           if (debug) {
             std::cout << className << "::TransportCloud:\n";
@@ -3132,17 +3706,9 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
         }
         
         // If switched on, calculate the induced signal.
-        if (useSignal) {
-          if (hole) {
-            sensor->AddSignal(+1, t, dt, x + 0.5 * vx * dt,
-                                         y + 0.5 * vy * dt,
-                                         z + 0.5 * vz * dt, vx, vy, vz);
-          } else {
-            sensor->AddSignal(-1, t, dt, x + 0.5 * vx * dt, 
-                                         y + 0.5 * vy * dt,
-                                         z + 0.5 * vy * dt, vx, vy, vz);
-          }
-        }
+        signalPolicy::Add(sensor, hole, t, dt, x + 0.5 * vx * dt,
+                          y + 0.5 * vy * dt, z + 0.5 * vz * dt,
+                          vx, vy, vz);
 
         // Update the coordinates.
         x += vx * dt; y += vy * dt; z += vz * dt; t += dt;
@@ -3156,7 +3722,11 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
 
         // If switched on, get the magnetic field at the new location.
         if (useBfield) {
-          sensor->MagneticField(x, y, z, bx, by, bz, status);
+          if (uniformBfield) {
+            bx = bx0; by = by0; bz = bz0;
+          } else {
+            sensor->MagneticField(x, y, z, bx, by, bz, status);
+          }
           if (hole) {
             bx *=  Tesla2Internal;
             by *=  Tesla2Internal;
@@ -3177,7 +3747,7 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
 	// total energy includes only the kinetic energy and the potential 
 	// from electrons and ions (but excludes the external electric field, correct??)
 	// and electron within Onsager radius of some ion
-	if (newEnergy > 8.0) {
+	if (newEnergy > eKineticMax) {
 	  std::cout << "High kinetic energy of: " << newEnergy << "\n";
 	  newEnergy = 7.0;
 	  std::cout << "Force to remain below ionization threshold: " << newEnergy << "\n";
@@ -3203,10 +3773,12 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
 
         // use the electron's deBroglie wavelength as the radius for the recombination condition instead of the
         // Onsager radius if deBroglieRecomb (passed from command line arg in example.C as 0 or 1) is true. True by default.
-        double recombRadius;
-        double deBroglieWavelength = 1.226426e-7/sqrt(newEnergy);
-        if (deBroglieRecomb && deBroglieWavelength < OnsagerRadius) recombRadius = deBroglieWavelength;
-        else recombRadius = OnsagerRadius;
+        // (only needed for a bound electron close to an ion)
+        double recombRadius = OnsagerRadius;
+        if (deBroglieRecomb && newEnergy + potential < 0. && minDistIon < OnsagerRadius) {
+          const double deBroglieWavelength = 1.226426e-7/sqrt(newEnergy);
+          if (deBroglieWavelength < OnsagerRadius) recombRadius = deBroglieWavelength;
+        }
 //      std::cout << "recombRadius= " << recombRadius << std::endl;
 
 	if ( (newEnergy + potential < 0.) && (minDistIon < recombRadius) ) {
@@ -3255,6 +3827,8 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
           }
 //std::cout << "on recomb check stack.begin(): " << stack.begin() << std::endl;
           stack.erase(stack.begin() + iE);
+          GARFIELD_COUNT(nErasures, 1);
+          ionsChanged = true;
           ok = false;
           if (debug) {
             std::cout << className << "::TransportCloud:\n";
@@ -3300,9 +3874,11 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
 //std::cout << std::endl << "energy before " << newEnergy << " kx0 " << newKx << " ky0 " << newKy << " kz0 " << newKz << std::endl;
 
         // Get the collision type and parameters.
+        GARFIELD_TIMER_START(tCollision);
         medium->GetElectronCollision(newEnergy, cstype, level, 
                                      energy, newKx, newKy, newKz, 
                                      nion, ndxc, band);
+        GARFIELD_TIMER_STOP(tCollision, cyclesCollision);
 
 //std::cout << "energy after " << energy << " kxf " << newKx << " kyf " << newKy << " kzf " << newKz << std::endl;  
 
@@ -3348,9 +3924,8 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
             break;
           // Ionising collision
           case ElectronCollisionTypeIonisation:
-            if (usePlotting && plotIonisations) {
-              viewer->AddIonisationMarker(x, y, z);
-            }
+            plottingPolicy::AddMarker(viewer, usePlotting && plotIonisations,
+                                      ElectronCollisionTypeIonisation, x, y, z);
             if (hasUserHandleIonisation) {
               userHandleIonisation(x, y, z, t, cstype, level, medium);
             }
@@ -3411,9 +3986,11 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
                 << esec << " " << nIonizationTotal << std::endl;
 
                 newElectron.status = 0;
-                newElectron.driftLine.clear();
+                newElectron.driftLine = -1;
+                newElectron.frozen = false;
                 if (aval && (sizeCut <= 0 || (int)stack.size() < sizeCut)) {
                   stack.push_back(newElectron);
+                  ionsChanged = true;
                 }
                 // Increment the electron counter.
                 ++nElectrons;
@@ -3445,9 +4022,11 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
                   newElectron.kz = ctheta;
                 }
                 newElectron.status = 0;
-                newElectron.driftLine.clear();
+                newElectron.driftLine = -1;
+                newElectron.frozen = false;
                 if (aval && (sizeCut <= 0 || (int)stack.size() < sizeCut)) {
                   stack.push_back(newElectron);
+                  ionsChanged = true;
                 }
                 // Increment the hole counter.
                 ++nHoles;
@@ -3463,9 +4042,8 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
             break;
           // Attachment
           case ElectronCollisionTypeAttachment:
-            if (usePlotting && plotAttachments) {
-              viewer->AddAttachmentMarker(x, y, z);
-            }
+            plottingPolicy::AddMarker(viewer, usePlotting && plotAttachments,
+                                      ElectronCollisionTypeAttachment, x, y, z);
             if (hasUserHandleAttachment) {
               userHandleAttachment(x, y, z, t, cstype, level, medium);
             }
@@ -3487,6 +4065,8 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
             std::cout << "Electron " << stack[iE].id << " of " << nIonizationTotal << " has attached at (x,y,z,t,e,potential,status):\n" 
             << x << " " << y << " " << z << " " << t << " with E(eV)= " << energy << " " << potential << " status = " << stack[iE].status << std::endl;
             stack.erase(stack.begin() + iE);
+            GARFIELD_COUNT(nErasures, 1);
+            ionsChanged = true;
             ok = false;
             break;
           // Inelastic collision
@@ -3497,9 +4077,8 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
             break;
           // Excitation
           case ElectronCollisionTypeExcitation:
-            if (usePlotting && plotExcitations) {
-              viewer->AddExcitationMarker(x, y, z);
-            }
+            plottingPolicy::AddMarker(viewer, usePlotting && plotExcitations,
+                                      ElectronCollisionTypeExcitation, x, y, z);
             if (hasUserHandleInelastic) {
               userHandleInelastic(x, y, z, t, cstype, level, medium);
             }
@@ -3537,6 +4116,7 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
                   double fx = 0., fy = 0., fz = 0.;
                   sensor->ElectricField(xDxc, yDxc, zDxc, 
                                         fx, fy, fz, dxcMedium, status);
+                  GARFIELD_COUNT(nFieldEvaluations, 1);
                   // Check if this location is inside a drift medium.
                   if (status != 0) continue;
                   // Check if this location is inside the drift area.
@@ -3561,9 +4141,11 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
                   newElectron.ky = sin(phi) * stheta;
                   newElectron.kz = ctheta;
                   newElectron.status = 0;
-                  newElectron.driftLine.clear();
+                  newElectron.driftLine = -1;
+                  newElectron.frozen = false;
                   // Add the electron to the list.
                   stack.push_back(newElectron);
+                  ionsChanged = true;
                   // Increment the electron and ion counters.
                   ++nElectrons; ++nIons;
                 } else if (typeDxc == DxcProdTypePhoton && usePhotons && 
@@ -3630,7 +4212,8 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
 // old            ( (nCollTemp > nCollSkip) && (t > toldest) )||
             // megan: changed t > toldest to t >= toldest ... does this change anything?
             // also changed to nCollTemp >= nCollSkip instead of >
-            ( (nCollTemp >= nCollSkip) && (t > toldest) )|| 
+            (!useTimeSlices && (nCollTemp >= nCollSkip) && (t > toldest)) ||
+            (useTimeSlices && t > tSlice) || 
             cstype == ElectronCollisionTypeIonisation || 
             (plotExcitations && cstype == ElectronCollisionTypeExcitation) ||
             (plotAttachments && cstype == ElectronCollisionTypeAttachment)) {
@@ -3666,11 +4249,8 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
 //        << potential << std::endl;
 
       // Add a new point to the drift line (if enabled).
-      if (useDriftLines) {
-        point newPoint;
-        newPoint.x = x; newPoint.y = y; newPoint.z = z; newPoint.t = t;
-        stack[iE].driftLine.push_back(newPoint);
-      }
+      plottingPolicy::AddPoint(driftLines, useDriftLines, stack[iE].driftLine,
+                               x, y, z, t);
     }
   }
   nElectronEndpoints = endpointsElectrons.size();
@@ -3736,6 +4316,255 @@ std::cout << "current collisions. elastic: " << pnElastic << " ionizations: " <<
     
 }
 
+void
+AvalancheMicroscopic::FillExpVariates() {
+
+  const int n = 1024;
+  expVariates.resize(n);
+  RndmUniformArray(n, &expVariates[0]);
+  for (int i = n; i--;) {
+    while (expVariates[i] <= 0.) expVariates[i] = RndmUniform();
+  }
+  FastExponentialVariates(n, &expVariates[0], &expVariates[0]);
+  nextExpVariate = 0;
+
+}
+
+double
+AvalancheMicroscopic::GetNullCollisionRate(Medium* medium, const int band,
+                                           const double eMax) {
+
+  // The null-collision rate of the medium is the maximum of its 
+  // collision rate table.
+  double fNull = medium->GetElectronNullCollisionRate(band);
+  if (fNull <= 0.) return fNull;
+  const std::pair<int, int> key(medium->GetId(), band);
+  std::map<std::pair<int, int>, nullCollisionRate>::iterator it = 
+    nullCollisionRates.find(key);
+  if (it != nullCollisionRates.end() && it->second.fMedium == fNull &&
+      it->second.eMax >= eMax) {
+    return it->second.fLim;
+  }
+  // Make sure the table covers the max. energy (this may extend it)
+  // and take the largest rate up to this energy.
+  double fLim = fNull;
+  if (eMax > 0.) {
+    fLim = medium->GetElectronCollisionRate(eMax, band);
+    fNull = medium->GetElectronNullCollisionRate(band);
+    if (fNull <= 0.) return fNull;
+    fLim = std::max(fLim, fNull);
+  }
+  if (it != nullCollisionRates.end() && it->second.fMedium == fNull) {
+    // Keep a rate which was increased during a previous flight.
+    fLim = std::max(fLim, it->second.fLim);
+  }
+  nullCollisionRate& rate = nullCollisionRates[key];
+  rate.fMedium = fNull;
+  rate.eMax = std::max(eMax, 0.);
+  rate.fLim = fLim;
+  if (debug) {
+    std::cout << className << "::GetNullCollisionRate:\n";
+    std::cout << "    Null-collision rate " << fLim << " ns-1 up to " 
+              << eMax << " eV (medium " << key.first << ", band " 
+              << band << ").\n";
+  }
+  return fLim;
+
+}
+
+void
+AvalancheMicroscopic::RaiseNullCollisionRate(Medium* medium, const int band,
+                                             const double fLim) {
+
+  const std::pair<int, int> key(medium->GetId(), band);
+  std::map<std::pair<int, int>, nullCollisionRate>::iterator it = 
+    nullCollisionRates.find(key);
+  if (it == nullCollisionRates.end()) return;
+  if (fLim > it->second.fLim) it->second.fLim = fLim;
+
+}
+
+double
+AvalancheMicroscopic::ComputeNullRateFactor(const double rIon, 
+                                            const double rOnsager,
+                                            const double eCloud, 
+                                            const double eExt) {
+
+  double f = nullRateFactor;
+  if (useAdaptiveNullRate) {
+    // Closeness to the nearest ion, relative to the given number 
+    // of Onsager radii.
+    double s = 0.;
+    if (rOnsager > 0.) {
+      s = rIon > Small ? nullRateDistance * rOnsager / rIon : 1.;
+    }
+    // Strength of the cloud field relative to the external field.
+    if (eCloud > nullRateFieldRatio * eExt) {
+      s = 1.;
+    } else if (eExt > Small) {
+      s = std::max(s, eCloud / (nullRateFieldRatio * eExt));
+    }
+    f = std::max(1., std::min(nullRateFactorMax, s * nullRateFactorMax));
+  }
+  ++nNullRateSteps;
+  sumNullRateFactor += f;
+  if (!useAdaptiveNullRate || f >= nullRateFactorMax) ++nNullRateStepsMax;
+  return f;
+
+}
+
+void
+AvalancheMicroscopic::FillIonTable(SpatialHash& ions) const {
+
+  const int nIons = stack.size();
+  std::vector<double> xi(nIons), yi(nIons), zi(nIons);
+  for (int i = nIons; i--;) {
+    xi[i] = stack[i].xi;
+    yi[i] = stack[i].yi;
+    zi[i] = stack[i].zi;
+  }
+  ions.Build(xi, yi, zi);
+
+}
+
+double
+AvalancheMicroscopic::AddChargePotential(const double q, const double xc,
+                                         const double yc, const double zc,
+                                         const double x, const double y, 
+                                         const double z,
+                                         const double eps, const double d,
+                                         double& p, double& px, 
+                                         double& py, double& pz) const {
+
+  const double r0 = sqrt((xc - x) * (xc - x) + (yc - y) * (yc - y) + 
+                         (zc - z) * (zc - z));
+  p += q * ElementaryCharge / (4 * Pi * eps * r0);
+  double r = sqrt((xc - (x + d)) * (xc - (x + d)) + (yc - y) * (yc - y) + 
+                  (zc - z) * (zc - z));
+  px += q * ElementaryCharge / (4 * Pi * eps * r);
+  r = sqrt((xc - x) * (xc - x) + (yc - (y + d)) * (yc - (y + d)) + 
+           (zc - z) * (zc - z));
+  py += q * ElementaryCharge / (4 * Pi * eps * r);
+  r = sqrt((xc - x) * (xc - x) + (yc - y) * (yc - y) + 
+           (zc - (z + d)) * (zc - (z + d)));
+  pz += q * ElementaryCharge / (4 * Pi * eps * r);
+  return r0;
+
+}
+
+void
+AvalancheMicroscopic::ComputeCloudPotential(const int iE,
+                                            const double x, const double y, 
+                                            const double z,
+                                            const double eps, const double d,
+                                            double& p, double& px, 
+                                            double& py, double& pz,
+                                            double& rmin) const {
+
+  p = px = py = pz = 0.;
+  rmin = 1.e99;
+  for (int i = stack.size(); i--;) {
+    // Ion (calculations assume we are computing the potential 
+    // of a positive charge)
+    double r = AddChargePotential(+1., stack[i].xi, stack[i].yi, stack[i].zi,
+                                  x, y, z, eps, d, p, px, py, pz);
+    rmin = std::min(rmin, r);
+    // Electron (excluding self)
+    if (i == iE) continue;
+    r = AddChargePotential(-1., stack[i].x, stack[i].y, stack[i].z,
+                           x, y, z, eps, d, p, px, py, pz);
+    rmin = std::min(rmin, r);
+  }
+
+}
+
+void
+AvalancheMicroscopic::ComputeFarPotential(const int iE,
+                                          const double x, const double y, 
+                                          const double z,
+                                          const double eps, const double d,
+                                          double* pFar,
+                                          std::vector<int>& nearIons,
+                                          std::vector<int>& nearElectrons) const {
+
+  pFar[0] = pFar[1] = pFar[2] = pFar[3] = 0.;
+  nearIons.clear();
+  nearElectrons.clear();
+  const double r2Near = multiRateDistance * multiRateDistance;
+  for (int i = stack.size(); i--;) {
+    const electron& e = stack[i];
+    double r2 = (e.xi - x) * (e.xi - x) + (e.yi - y) * (e.yi - y) + 
+                (e.zi - z) * (e.zi - z);
+    if (r2 < r2Near) {
+      nearIons.push_back(i);
+    } else {
+      AddChargePotential(+1., e.xi, e.yi, e.zi, x, y, z, eps, d, 
+                         pFar[0], pFar[1], pFar[2], pFar[3]);
+    }
+    if (i == iE) continue;
+    r2 = (e.x - x) * (e.x - x) + (e.y - y) * (e.y - y) + 
+         (e.z - z) * (e.z - z);
+    if (r2 < r2Near) {
+      nearElectrons.push_back(i);
+    } else {
+      AddChargePotential(-1., e.x, e.y, e.z, x, y, z, eps, d, 
+                         pFar[0], pFar[1], pFar[2], pFar[3]);
+    }
+  }
+
+}
+
+void
+AvalancheMicroscopic::ComputeNearPotential(const double x, const double y, 
+                                           const double z,
+                                           const double eps, const double d,
+                                           const std::vector<int>& nearIons,
+                                           const std::vector<int>& nearElectrons,
+                                           double& p, double& px, 
+                                           double& py, double& pz) const {
+
+  for (int j = nearIons.size(); j--;) {
+    const electron& e = stack[nearIons[j]];
+    AddChargePotential(+1., e.xi, e.yi, e.zi, x, y, z, eps, d, p, px, py, pz);
+  }
+  for (int j = nearElectrons.size(); j--;) {
+    const electron& e = stack[nearElectrons[j]];
+    AddChargePotential(-1., e.x, e.y, e.z, x, y, z, eps, d, p, px, py, pz);
+  }
+
+}
+
+double
+AvalancheMicroscopic::FreezeCloudField(const double eps, const double d) {
+
+  const int n = stack.size();
+  if (n <= 0) return timeSliceMax;
+  // Numerical prefactor for the velocity
+  const double c1 = SpeedOfLight * sqrt(2. / ElectronMass);
+  // Max. time step of each electron/hole
+  std::vector<double> dtMax(n, timeSliceMax);
+  // The sum over all pairs only reads the positions in the stack,
+  // so the electrons/holes can be distributed over threads.
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 16)
+#endif
+  for (int i = 0; i < n; ++i) {
+    electron& e = stack[i];
+    double rmin = 0.;
+    ComputeCloudPotential(i, e.x, e.y, e.z, eps, d,
+                          e.cloudPotential[0], e.cloudPotential[1],
+                          e.cloudPotential[2], e.cloudPotential[3], rmin);
+    e.frozen = true;
+    // The field of the closest charge changes on a length scale of r / 2.
+    const double v = c1 * sqrt(std::max(e.energy, Small));
+    if (v > 0.) {
+      dtMax[i] = std::min(timeSliceMax, 0.5 * timeSliceFraction * rmin / v);
+    }
+  }
+  return *std::min_element(dtMax.begin(), dtMax.end());
+
+}
+
 void
 AvalancheMicroscopic::TransportPhoton(const double x0, const double y0, 
                                       const double z0, 
@@ -3855,7 +4684,7 @@ AvalancheMicroscopic::TransportPhoton(const double x0, const double y0,
     newElectron.ky = sin(phi) * stheta;
     newElectron.kz = ctheta;
     newElectron.status = 0;
-    newElectron.driftLine.clear();
+    newElectron.driftLine = -1;
     if (sizeCut <= 0 || (int)stack.size() < sizeCut) stack.push_back(newElectron);
     // Increment the electron and ion counters.        
     ++nElectrons; ++nIons;
@@ -3886,7 +4715,7 @@ AvalancheMicroscopic::TransportPhoton(const double x0, const double y0,
         newElectron.ky = sin(phi) * stheta;
         newElectron.kz = ctheta;
         newElectron.status = 0;
-        newElectron.driftLine.clear();
+        newElectron.driftLine = -1;
         stack.push_back(newElectron);
         // Increment the electron and ion counters.        
         ++nElectrons; ++nIons;
@@ -3914,68 +4743,4 @@ AvalancheMicroscopic::TransportPhoton(const double x0, const double y0,
 
 }
 
-void 
-AvalancheMicroscopic::ComputeRotationMatrix(
-    const double bx, const double by, const double bz, const double bmag, 
-    const double ex, const double ey, const double ez) {
-
-  // Adopting the Magboltz convention, the stepping is performed
-  // in a coordinate system with the B field along the x axis
-  // and the electric field at an angle btheta in the x-z plane.
-
-  // Calculate the first rotation matrix (to align B with x axis).
-  const double bt = by * by + bz * bz;
-  if (bt < Small) {
-    // B field is already along axis.
-    rb11 = rb22 = rb33 = 1.;
-    rb12 = rb13 = rb21 = rb23 = rb31 = rb32 = 0.;
-  } else {
-    rb11 = bx / bmag;
-    rb12 = by / bmag; rb21 = -rb12;
-    rb13 = bz / bmag; rb31 = -rb13;
-    rb22 = (rb11 * by * by + bz * bz) / bt;
-    rb33 = (rb11 * bz * bz + by * by) / bt;
-    rb23 = rb32 = (rb11 - 1.) * by * bz / bt;
-  }
-  // Calculate the second rotation matrix (rotation around x axis).
-  const double fy = rb21 * ex + rb22 * ey + rb23 * ez;
-  const double fz = rb31 * ex + rb32 * ey + rb33 * ez;
-  const double ft = sqrt(fy * fy + fz * fz);
-  if (ft < Small) {
-    // E and B field are parallel.
-    rx22 = rx33 = 1.;
-    rx23 = rx32 = 0.;
-  } else {
-    rx22 = rx33 = fz / ft;
-    rx23 = - fy / ft; rx32 = -rx23;
-  }
-
-}
-
-void
-AvalancheMicroscopic::RotateGlobal2Local(double& dx, double& dy, double& dz) {
-
-  const double dx1 = rb11 * dx + rb12 * dy + rb13 * dz;
-  const double dy1 = rb21 * dx + rb22 * dy + rb23 * dz;
-  const double dz1 = rb31 * dx + rb32 * dy + rb33 * dz;
-  
-  dx = dx1;
-  dy = rx22 * dy1 + rx23 * dz1;
-  dz = rx32 * dy1 + rx33 * dz1;
-
-}
-
-void
-AvalancheMicroscopic::RotateLocal2Global(double& dx, double& dy, double& dz) {
-
-  const double dx1 = dx;
-  const double dy1 = rx22 * dy + rx32 * dz;
-  const double dz1 = rx23 * dy + rx33 * dz;
-  
-  dx = rb11 * dx1 + rb21 * dy1 + rb31 * dz1;
-  dy = rb12 * dx1 + rb22 * dy1 + rb32 * dz1;
-  dz = rb13 * dx1 + rb23 * dy1 + rb33 * dz1;
-
-}
-
 }
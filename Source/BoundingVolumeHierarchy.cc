@@ -0,0 +1,150 @@
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "BoundingVolumeHierarchy.hh"
+
+namespace Garfield {
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy() {
+
+  boxes.clear();
+  nodes.clear();
+
+}
+
+void
+BoundingVolumeHierarchy::AddBox(const int i,
+                const double xmin, const double ymin, const double zmin,
+                const double xmax, const double ymax, const double zmax) {
+
+  box newBox;
+  newBox.xmin = std::min(xmin, xmax); newBox.xmax = std::max(xmin, xmax);
+  newBox.ymin = std::min(ymin, ymax); newBox.ymax = std::max(ymin, ymax);
+  newBox.zmin = std::min(zmin, zmax); newBox.zmax = std::max(zmin, zmax);
+  newBox.index = i;
+  boxes.push_back(newBox);
+  nodes.clear();
+
+}
+
+void
+BoundingVolumeHierarchy::Build() {
+
+  nodes.clear();
+  if (boxes.empty()) return;
+  nodes.reserve(2 * boxes.size() / nMaxLeaf + 1);
+  BuildNode(0, boxes.size());
+
+}
+
+void
+BoundingVolumeHierarchy::Clear() {
+
+  boxes.clear();
+  nodes.clear();
+
+}
+
+int
+BoundingVolumeHierarchy::BuildNode(const int first, const int count) {
+
+  const int k = nodes.size();
+  nodes.push_back(node());
+  node newNode;
+  newNode.left = newNode.right = -1;
+  newNode.first = first;
+  newNode.count = count;
+  // Envelope of the boxes and range of their centres
+  const box& b0 = boxes[first];
+  newNode.xmin = b0.xmin; newNode.ymin = b0.ymin; newNode.zmin = b0.zmin;
+  newNode.xmax = b0.xmax; newNode.ymax = b0.ymax; newNode.zmax = b0.zmax;
+  newNode.imax = b0.index;
+  double cmin[3] = {0.5 * (b0.xmin + b0.xmax), 0.5 * (b0.ymin + b0.ymax),
+                    0.5 * (b0.zmin + b0.zmax)};
+  double cmax[3] = {cmin[0], cmin[1], cmin[2]};
+  for (int i = first + 1; i < first + count; ++i) {
+    const box& b = boxes[i];
+    newNode.xmin = std::min(newNode.xmin, b.xmin);
+    newNode.ymin = std::min(newNode.ymin, b.ymin);
+    newNode.zmin = std::min(newNode.zmin, b.zmin);
+    newNode.xmax = std::max(newNode.xmax, b.xmax);
+    newNode.ymax = std::max(newNode.ymax, b.ymax);
+    newNode.zmax = std::max(newNode.zmax, b.zmax);
+    newNode.imax = std::max(newNode.imax, b.index);
+    const double c[3] = {0.5 * (b.xmin + b.xmax), 0.5 * (b.ymin + b.ymax),
+                         0.5 * (b.zmin + b.zmax)};
+    for (int j = 0; j < 3; ++j) {
+      cmin[j] = std::min(cmin[j], c[j]);
+      cmax[j] = std::max(cmax[j], c[j]);
+    }
+  }
+
+  if (count > nMaxLeaf) {
+    // Split at the median centre along the axis of largest extent.
+    int axis = 0;
+    for (int j = 1; j < 3; ++j) {
+      if (cmax[j] - cmin[j] > cmax[axis] - cmin[axis]) axis = j;
+    }
+    std::vector<std::pair<double, int> > keys(count);
+    for (int i = 0; i < count; ++i) {
+      const box& b = boxes[first + i];
+      const double c = axis == 0 ? b.xmin + b.xmax :
+                       axis == 1 ? b.ymin + b.ymax : b.zmin + b.zmax;
+      keys[i] = std::make_pair(c, first + i);
+    }
+    const int half = count / 2;
+    std::nth_element(keys.begin(), keys.begin() + half, keys.end());
+    std::vector<box> sorted(count);
+    for (int i = 0; i < count; ++i) sorted[i] = boxes[keys[i].second];
+    std::copy(sorted.begin(), sorted.end(), boxes.begin() + first);
+    newNode.left = BuildNode(first, half);
+    newNode.right = BuildNode(first + half, count - half);
+    newNode.count = 0;
+  }
+  nodes[k] = newNode;
+  return k;
+
+}
+
+void
+BoundingVolumeHierarchy::FindBoxes(const double x, const double y,
+                                   const double z,
+                                   std::vector<int>& indices,
+                                   const int imin) const {
+
+  indices.clear();
+  if (nodes.empty()) return;
+
+  // The tree is balanced, its depth is at most log2(number of boxes).
+  int stack[64];
+  int nStack = 0;
+  stack[nStack++] = 0;
+  while (nStack > 0) {
+    const node& n = nodes[stack[--nStack]];
+    if (n.imax <= imin) continue;
+    if (x < n.xmin || x > n.xmax ||
+        y < n.ymin || y > n.ymax ||
+        z < n.zmin || z > n.zmax) continue;
+    if (n.count > 0) {
+      for (int i = n.first; i < n.first + n.count; ++i) {
+        const box& b = boxes[i];
+        if (b.index <= imin) continue;
+        if (x < b.xmin || x > b.xmax ||
+            y < b.ymin || y > b.ymax ||
+            z < b.zmin || z > b.zmax) continue;
+        indices.push_back(b.index);
+      }
+      continue;
+    }
+    stack[nStack++] = n.left;
+    stack[nStack++] = n.right;
+  }
+  if (indices.size() > 1) {
+    std::sort(indices.begin(), indices.end(), std::greater<int>());
+  }
+
+}
+
+}
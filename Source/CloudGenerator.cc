@@ -0,0 +1,272 @@
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#include "CloudGenerator.hh"
+#include "Track.hh"
+#include "TrackHeed.hh"
+#include "CloudPartition.hh"
+#include "AvalancheMicroscopic.hh"
+#include "Random.hh"
+
+namespace Garfield {
+
+CloudGenerator::CloudGenerator() :
+  track(0), trackHeed(0),
+  useSpectrum(true), energy(0.), spectrumWidth(7.6), spectrumMax(7.),
+  nBatchMax(1000), partition(0), hasTrack(false), nBatches(0), nPairs(0),
+  nUsed(0),
+  debug(false) {
+
+  className = "CloudGenerator";
+
+}
+
+void
+CloudGenerator::SetTrack(Track* t) {
+
+  if (!t) {
+    std::cerr << className << "::SetTrack:\n";
+    std::cerr << "    Track pointer is null.\n";
+    return;
+  }
+  track = t;
+  trackHeed = 0;
+  hasTrack = false;
+
+}
+
+void
+CloudGenerator::SetTrack(TrackHeed* t) {
+
+  if (!t) {
+    std::cerr << className << "::SetTrack:\n";
+    std::cerr << "    Track pointer is null.\n";
+    return;
+  }
+  track = t;
+  trackHeed = t;
+  hasTrack = false;
+
+}
+
+void
+CloudGenerator::SetInitialEnergy(const double e) {
+
+  if (e < 0.) {
+    std::cerr << className << "::SetInitialEnergy:\n";
+    std::cerr << "    Energy must not be negative.\n";
+    return;
+  }
+  energy = e;
+  useSpectrum = false;
+
+}
+
+void
+CloudGenerator::SetEnergySpectrum(const double w, const double emax) {
+
+  if (w <= 0. || emax <= 0.) {
+    std::cerr << className << "::SetEnergySpectrum:\n";
+    std::cerr << "    Width and max. energy must be greater than zero.\n";
+    return;
+  }
+  spectrumWidth = w;
+  spectrumMax = emax;
+  useSpectrum = true;
+
+}
+
+void
+CloudGenerator::SetBatchSize(const int n) {
+
+  if (n <= 0) {
+    std::cerr << className << "::SetBatchSize:\n";
+    std::cerr << "    Batch size must be greater than zero.\n";
+    return;
+  }
+  nBatchMax = n;
+
+}
+
+void
+CloudGenerator::EnablePartitioning(CloudPartition* p) {
+
+  if (!p) {
+    std::cerr << className << "::EnablePartitioning:\n";
+    std::cerr << "    Partition pointer is null.\n";
+    return;
+  }
+  partition = p;
+
+}
+
+bool
+CloudGenerator::NewTrack(const double x0, const double y0, const double z0,
+                         const double t0,
+                         const double dx0, const double dy0,
+                         const double dz0) {
+
+  hasTrack = false;
+  nBatches = nPairs = 0;
+  nUsed = 0;
+  xc.clear(); yc.clear(); zc.clear(); tc.clear();
+  ec.clear(); dxc.clear(); dyc.clear(); dzc.clear();
+  if (!track) {
+    std::cerr << className << "::NewTrack:\n";
+    std::cerr << "    Track is not defined.\n";
+    return false;
+  }
+  if (!track->NewTrack(x0, y0, z0, t0, dx0, dy0, dz0)) {
+    std::cerr << className << "::NewTrack:\n";
+    std::cerr << "    Track could not be generated.\n";
+    return false;
+  }
+  hasTrack = true;
+  return true;
+
+}
+
+bool
+CloudGenerator::NextBatch() {
+
+  xb.clear(); yb.clear(); zb.clear(); tb.clear();
+  eb.clear(); dxb.clear(); dyb.clear(); dzb.clear();
+  if (!hasTrack) return false;
+
+  while ((int)xb.size() < nBatchMax) {
+    if (nUsed >= (int)xc.size() && !NextCluster()) {
+      hasTrack = false;
+      break;
+    }
+    // Take as many electrons of the cluster as fit into the batch.
+    const int nFree = nBatchMax - xb.size();
+    const int nLast = std::min((int)xc.size(), nUsed + nFree);
+    for (int i = nUsed; i < nLast; ++i) {
+      xb.push_back(xc[i]); yb.push_back(yc[i]); zb.push_back(zc[i]);
+      tb.push_back(tc[i]);
+      eb.push_back(ec[i] > 0. ? ec[i] : DrawEnergy());
+      dxb.push_back(dxc[i]); dyb.push_back(dyc[i]); dzb.push_back(dzc[i]);
+    }
+    nUsed = nLast;
+  }
+
+  if (xb.empty()) return false;
+  ++nBatches;
+  nPairs += xb.size();
+  if (debug) {
+    std::cout << className << "::NextBatch:\n";
+    std::cout << "    Batch " << nBatches << " with " << xb.size()
+              << " electrons (" << nPairs << " in total).\n";
+  }
+  return true;
+
+}
+
+bool
+CloudGenerator::Transport(AvalancheMicroscopic* aval,
+                          const bool deBroglieRecomb) {
+
+  if (!aval) {
+    std::cerr << className << "::Transport:\n";
+    std::cerr << "    Avalanche pointer is null.\n";
+    return false;
+  }
+  // Movie output is switched off.
+  double movieframetime[1] = {0.};
+  bool ok = true;
+  while (NextBatch()) {
+    if (partition) {
+      if (!TransportGroups(aval, deBroglieRecomb)) ok = false;
+      continue;
+    }
+    if (!aval->AvalancheCloud(xb.size(), &xb[0], &yb[0], &zb[0], &tb[0],
+                              &eb[0], &dxb[0], &dyb[0], &dzb[0],
+                              deBroglieRecomb, movieframetime, 0)) {
+      std::cerr << className << "::Transport:\n";
+      std::cerr << "    Transport of batch " << nBatches << " failed.\n";
+      ok = false;
+    }
+  }
+  return ok;
+
+}
+
+bool
+CloudGenerator::TransportGroups(AvalancheMicroscopic* aval,
+                                const bool deBroglieRecomb) {
+
+  const int nGroups = partition->Partition(xb.size(), &xb[0], &yb[0], &zb[0]);
+  double movieframetime[1] = {0.};
+  std::vector<double> x, y, z, t, e, dx, dy, dz;
+  std::vector<int> members;
+  bool ok = true;
+  for (int g = 0; g < nGroups; ++g) {
+    partition->GetGroupMembers(g, members);
+    const int n = members.size();
+    x.resize(n); y.resize(n); z.resize(n); t.resize(n);
+    e.resize(n); dx.resize(n); dy.resize(n); dz.resize(n);
+    for (int i = 0; i < n; ++i) {
+      const int j = members[i];
+      x[i] = xb[j]; y[i] = yb[j]; z[i] = zb[j]; t[i] = tb[j];
+      e[i] = eb[j]; dx[i] = dxb[j]; dy[i] = dyb[j]; dz[i] = dzb[j];
+    }
+    if (!aval->AvalancheCloud(n, &x[0], &y[0], &z[0], &t[0],
+                              &e[0], &dx[0], &dy[0], &dz[0],
+                              deBroglieRecomb, movieframetime, 0)) {
+      std::cerr << className << "::TransportGroups:\n";
+      std::cerr << "    Transport of group " << g << " (" << n 
+                << " pairs) of batch " << nBatches << " failed.\n";
+      ok = false;
+    }
+  }
+  return ok;
+
+}
+
+bool
+CloudGenerator::NextCluster() {
+
+  xc.clear(); yc.clear(); zc.clear(); tc.clear();
+  ec.clear(); dxc.clear(); dyc.clear(); dzc.clear();
+  nUsed = 0;
+
+  double xcls = 0., ycls = 0., zcls = 0., tcls = 0.;
+  double ecls = 0., extra = 0.;
+  int n = 0;
+  // Skip clusters without electrons.
+  while (n <= 0) {
+    if (!track->GetCluster(xcls, ycls, zcls, tcls, n, ecls, extra)) {
+      return false;
+    }
+  }
+
+  double x = 0., y = 0., z = 0., t = 0., e = 0.;
+  double dx = 0., dy = 0., dz = 0.;
+  for (int i = 0; i < n; ++i) {
+    if (trackHeed) {
+      if (!trackHeed->GetElectron(i, x, y, z, t, e, dx, dy, dz)) continue;
+    } else {
+      x = xcls; y = ycls; z = zcls; t = tcls;
+      e = 0.;
+      dx = dy = dz = 0.;
+    }
+    xc.push_back(x); yc.push_back(y); zc.push_back(z); tc.push_back(t);
+    ec.push_back(e);
+    dxc.push_back(dx); dyc.push_back(dy); dzc.push_back(dz);
+  }
+  return true;
+
+}
+
+double
+CloudGenerator::DrawEnergy() const {
+
+  if (!useSpectrum) return energy;
+  // Inverse of the cumulative distribution of 1 / (E^2 + w^2).
+  const double umax = atan(spectrumMax / spectrumWidth);
+  return spectrumWidth * tan(RndmUniform() * umax);
+
+}
+
+}
@@ -0,0 +1,213 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "CloudPartition.hh"
+#include "FundamentalConstants.hh"
+#include "GarfieldConstants.hh"
+
+namespace Garfield {
+
+CloudPartition::CloudPartition() :
+  onsagerRadius(0.), field(0.), dielectricConstant(1.),
+  distanceFactor(10.),
+  nGroups(0),
+  debug(false) {
+
+  className = "CloudPartition";
+
+}
+
+void
+CloudPartition::SetOnsagerRadius(const double r) {
+
+  if (r < 0.) {
+    std::cerr << className << "::SetOnsagerRadius:\n";
+    std::cerr << "    Radius must not be negative.\n";
+    return;
+  }
+  onsagerRadius = r;
+
+}
+
+void
+CloudPartition::SetElectricField(const double e) {
+
+  field = fabs(e);
+
+}
+
+void
+CloudPartition::SetDielectricConstant(const double eps) {
+
+  if (eps < 1.) {
+    std::cerr << className << "::SetDielectricConstant:\n";
+    std::cerr << "    Dielectric constant must be at least 1.\n";
+    return;
+  }
+  dielectricConstant = eps;
+
+}
+
+void
+CloudPartition::SetDistanceFactor(const double k) {
+
+  if (k <= 0.) {
+    std::cerr << className << "::SetDistanceFactor:\n";
+    std::cerr << "    Factor must be greater than zero.\n";
+    return;
+  }
+  distanceFactor = k;
+
+}
+
+double
+CloudPartition::GetInteractionRange() const {
+
+  // Distance at which the field of an elementary charge
+  // equals the external field.
+  double r = 0.;
+  if (field > Small) {
+    r = sqrt(ElementaryCharge /
+             (FourPiEpsilon0 * dielectricConstant * field));
+  }
+  return std::max(r, onsagerRadius);
+
+}
+
+int
+CloudPartition::Partition(const int n,
+                          const double x[], const double y[],
+                          const double z[]) {
+
+  nGroups = 0;
+  groups.clear();
+  groupOffsets.assign(1, 0);
+  groupMembers.clear();
+  if (n <= 0) return 0;
+
+  const double d = GetLinkingDistance();
+  if (d <= Small) {
+    std::cerr << className << "::Partition:\n";
+    std::cerr << "    Linking distance is not set (no Onsager radius"
+              << " and no electric field).\n";
+    std::cerr << "    All pairs are put in one group.\n";
+    groups.assign(n, 0);
+    nGroups = 1;
+    SortMembers();
+    return nGroups;
+  }
+
+  // Sort the pairs by grid cell (cell size equal to the linking distance).
+  std::vector<cell> cells(n);
+  for (int i = 0; i < n; ++i) {
+    cells[i].ix = int(floor(x[i] / d));
+    cells[i].iy = int(floor(y[i] / d));
+    cells[i].iz = int(floor(z[i] / d));
+    cells[i].index = i;
+  }
+  std::sort(cells.begin(), cells.end());
+
+  // Link pairs closer than the linking distance (union-find),
+  // looking only at the neighbouring cells.
+  std::vector<int> parent(n);
+  for (int i = 0; i < n; ++i) parent[i] = i;
+  const double d2 = d * d;
+  for (int k = 0; k < n; ++k) {
+    const int i = cells[k].index;
+    for (int jx = -1; jx <= 1; ++jx) {
+      for (int jy = -1; jy <= 1; ++jy) {
+        for (int jz = -1; jz <= 1; ++jz) {
+          cell key;
+          key.ix = cells[k].ix + jx;
+          key.iy = cells[k].iy + jy;
+          key.iz = cells[k].iz + jz;
+          key.index = -1;
+          std::vector<cell>::const_iterator it =
+            std::lower_bound(cells.begin(), cells.end(), key);
+          for (; it != cells.end() && it->ix == key.ix &&
+                 it->iy == key.iy && it->iz == key.iz; ++it) {
+            const int j = it->index;
+            if (j <= i) continue;
+            const double dx = x[j] - x[i];
+            const double dy = y[j] - y[i];
+            const double dz = z[j] - z[i];
+            if (dx * dx + dy * dy + dz * dz > d2) continue;
+            const int ri = Root(parent, i);
+            const int rj = Root(parent, j);
+            if (ri != rj) parent[std::max(ri, rj)] = std::min(ri, rj);
+          }
+        }
+      }
+    }
+  }
+
+  // Number the groups in the order of their first pair.
+  groups.assign(n, -1);
+  std::vector<int> label(n, -1);
+  for (int i = 0; i < n; ++i) {
+    const int r = Root(parent, i);
+    if (label[r] < 0) label[r] = nGroups++;
+    groups[i] = label[r];
+  }
+  SortMembers();
+
+  if (debug) {
+    std::cout << className << "::Partition:\n";
+    std::cout << "    " << n << " pairs in " << nGroups
+              << " groups (linking distance " << d << " cm).\n";
+  }
+  return nGroups;
+
+}
+
+int
+CloudPartition::GetGroup(const int i) const {
+
+  if (i < 0 || i >= (int)groups.size()) {
+    std::cerr << className << "::GetGroup:\n";
+    std::cerr << "    Index " << i << " out of range.\n";
+    return -1;
+  }
+  return groups[i];
+
+}
+
+void
+CloudPartition::GetGroupMembers(const int g, std::vector<int>& members) const {
+
+  members.clear();
+  if (g < 0 || g >= nGroups) return;
+  members.assign(groupMembers.begin() + groupOffsets[g],
+                 groupMembers.begin() + groupOffsets[g + 1]);
+
+}
+
+void
+CloudPartition::SortMembers() {
+
+  // Counting sort of the pairs by group (pairs in increasing order
+  // within each group).
+  const int n = groups.size();
+  groupOffsets.assign(nGroups + 1, 0);
+  for (int i = 0; i < n; ++i) ++groupOffsets[groups[i] + 1];
+  for (int g = 0; g < nGroups; ++g) groupOffsets[g + 1] += groupOffsets[g];
+  groupMembers.resize(n);
+  std::vector<int> next(groupOffsets.begin(), groupOffsets.end() - 1);
+  for (int i = 0; i < n; ++i) groupMembers[next[groups[i]]++] = i;
+
+}
+
+int
+CloudPartition::Root(std::vector<int>& parent, int i) {
+
+  while (parent[i] != i) {
+    // Path halving
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+
+}
+
+}
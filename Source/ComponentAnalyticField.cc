@@ -13,6 +13,7 @@ ComponentAnalyticField::ComponentAnalyticField() {
   
   className = "ComponentAnalyticField";
   chargeCheck = false;
+  useUniformShortcut = true;
   CellInit();
 
 }
@@ -89,6 +90,21 @@ void ComponentAnalyticField::ElectricField (
    
 }
 
+bool
+ComponentAnalyticField::IsUniformCell() {
+
+  // Make sure the cell is prepared.
+  if (!cellset) {
+    if (!Prepare()) {
+      std::cerr << className << "::IsUniformCell:\n";
+      std::cerr << "    Cell could not be setup.\n";
+      return false;
+    }
+  }
+  return uniformCell && n3d <= 0;
+
+}
+
 bool 
 ComponentAnalyticField::GetVoltageRange(double& pmin, double& pmax) {
 
@@ -905,6 +921,14 @@ ComponentAnalyticField::Field(
     }
   }
 
+  // Uniform field between the planes (no wires, no 3d charges)
+  if (uniformCell && useUniformShortcut && n3d <= 0) {
+    ex = -corvta;
+    ey = -corvtb;
+    volt = v0 + corvta * xpos + corvtb * ypos + corvtc;
+    return 0;
+  }
+
   // If (xpos, ypos) is within a wire, there is no field either.
   for (int i = nWires; i--;) {
     double dxwir = xpos - w[i].x;
@@ -1042,6 +1066,7 @@ ComponentAnalyticField::CellInit() {
 
   cellset = false;
   sigset = false;
+  uniformCell = false;
   
   // Coordinate system
   polar = false;
@@ -1190,6 +1215,13 @@ ComponentAnalyticField::Prepare() {
      return false;
   }
   
+  // Without wires, the field is given by the planes alone.
+  uniformCell = !tube && nWires <= 0 && !dipole;
+  if (debug && uniformCell) {
+    std::cout << className << "::Prepare:\n";
+    std::cout << "    Cell has a uniform field.\n";
+  }
+
   cellset = true;
   return true;
 
@@ -9,8 +9,8 @@
 #include <vector>
 #include <iomanip>
 
-#include "TMath.h"
 #include "ComponentCST.hh"
+#include "GarfieldConstants.hh"
 
 namespace Garfield {
 
@@ -24,6 +24,7 @@ ComponentCST::ComponentCST() : ComponentFieldMap() {
   m_xlines.clear();
   m_ylines.clear();
   m_zlines.clear();
+  m_lastIx = m_lastIy = m_lastIz = -1;
 
 }
 
@@ -223,6 +224,10 @@ ComponentCST::Initialise(std::string elist, std::string nlist,
   // Read the node list
   nodes.clear();
   nNodes = 0;
+  m_xlines.clear();
+  m_ylines.clear();
+  m_zlines.clear();
+  m_lastIx = m_lastIy = m_lastIz = -1;
   il = 0;
   int xlines = 0, ylines = 0, zlines = 0;
   int lines_type = -1;
@@ -354,6 +359,12 @@ ComponentCST::Initialise(std::string elist, std::string nlist,
   elements.clear();
   nElements = 0;
   element newElement;
+  // Element number for each cell of the grid (-1 for deleted background)
+  m_elementIndex.clear();
+  if (m_xlines.size() > 1 && m_ylines.size() > 1 && m_zlines.size() > 1) {
+    m_elementIndex.assign((m_xlines.size() - 1) * (m_ylines.size() - 1) *
+                          (m_zlines.size() - 1), -1);
+  }
   int ndegenerate = 0;
   int nbackground = 0;
   il = 0;
@@ -452,6 +463,9 @@ ComponentCST::Initialise(std::string elist, std::string nlist,
       if(node_nb.at(node) > highestnode) highestnode = node_nb.at(node);
       newElement.emap[node] = node_nb.at(node);
     }
+    if (ielem >= 0 && ielem < int(m_elementIndex.size())) {
+      m_elementIndex[ielem] = nElements;
+    }
     elements.push_back(newElement);
     ++nElements;
   }
@@ -528,6 +542,9 @@ ComponentCST::Initialise(std::string elist, std::string nlist,
     std::cerr << "    match the node list (" << nNodes << ")." << std::endl;
     ok = false;
   }
+  // Copy the potentials to a contiguous array for the interpolation
+  m_potential.resize(nNodes);
+  for (int i = nNodes; i--;) m_potential[i] = nodes[i].v;
   // Set the ready flag
   if (ok) {
     ready = true;
@@ -578,6 +595,7 @@ ComponentCST::SetWeightingField(std::string prnsol, std::string label) {
     for (int j = nNodes; j--;) {
       nodes[j].w.resize(nWeightingFields);
     }
+    m_weightingPotential.resize(nWeightingFields);
   } else {
     std::cout << className << "::SetWeightingField:" << std::endl;
     std::cout << "    Replacing existing weighting field " << label << "." << std::endl;
@@ -632,6 +650,8 @@ ComponentCST::SetWeightingField(std::string prnsol, std::string label) {
   }
   // Close the file
   fprnsol.close();
+  m_weightingPotential[iw].resize(nNodes);
+  for (int i = nNodes; i--;) m_weightingPotential[iw][i] = nodes[i].w[iw];
   // Tell how many lines read
   std::cout << className << "::SetWeightingField:" << std::endl;
   std::cout << "    Read " << nread << " potentials from file " << prnsol << "." << std::endl;
@@ -698,10 +718,10 @@ ComponentCST::ElectricField(
     std::cout << className << "::ElectricField:" << std::endl;
     std::cout << "    Warnings have been issued for this field map." << std::endl;
   }
-  double t1, t2, t3;
-  TMatrixD* jac = new TMatrixD(3,3);;
-  std::vector<TMatrixD*> dN;
-  int imap = FindElementCube(x, y, z, t1, t2, t3, jac, dN);
+  // Find the cell of the grid that contains this point
+  unsigned int i, j, k;
+  double u, v, w;
+  int imap = FindCell(x, y, z, i, j, k, u, v, w);
 
   if (imap < 0) {
     if (debug) {
@@ -711,55 +731,17 @@ ComponentCST::ElectricField(
       std::cout << "    it is background or PEC." << std::endl;
     }
     status = -6;
-    ComponentCST::ClearVec(dN);
-    delete jac;
     return;
   }
   // Save element number of last element
   lastElement = imap;
 
-  // invert Matrix
-//  jac->InvertFast();
-  if (debug) {
-    std::cout << className << "::ElectricField:" << std::endl;
-    std::cout << "    Inverse Jacobian is:" << std::endl;
-    jac->Print();
-  }
   // Field calculation
-  volt = (nodes[elements[imap].emap[0]].v * (1 - t1) * (1 - t2) * (1 - t3) +
-          nodes[elements[imap].emap[1]].v * (1 + t1) * (1 - t2) * (1 - t3) +
-          nodes[elements[imap].emap[2]].v * (1 + t1) * (1 + t2) * (1 - t3) +
-          nodes[elements[imap].emap[3]].v * (1 - t1) * (1 + t2) * (1 - t3) +
-          nodes[elements[imap].emap[4]].v * (1 - t1) * (1 - t2) * (1 + t3) +
-          nodes[elements[imap].emap[5]].v * (1 + t1) * (1 - t2) * (1 + t3) +
-          nodes[elements[imap].emap[6]].v * (1 + t1) * (1 + t2) * (1 + t3) +
-          nodes[elements[imap].emap[7]].v * (1 - t1) * (1 + t2) * (1 + t3)) / 8.;
-//  TMatrixD E(3,1);
-//  E = -1.*(nodes[elements[imap].emap[0]].v * (*jac) * (*dN.at(0)) +
-//      nodes[elements[imap].emap[1]].v * (*jac) * (*dN.at(1)) +
-//      nodes[elements[imap].emap[2]].v * (*jac) * (*dN.at(2)) +
-//      nodes[elements[imap].emap[3]].v * (*jac) * (*dN.at(3)) +
-//      nodes[elements[imap].emap[4]].v * (*jac) * (*dN.at(4)) +
-//      nodes[elements[imap].emap[5]].v * (*jac) * (*dN.at(5)) +
-//      nodes[elements[imap].emap[6]].v * (*jac) * (*dN.at(6)) +
-//      nodes[elements[imap].emap[7]].v * (*jac) * (*dN.at(7)));
-//
-//  ex = E(0,0);
-//  ey = E(1,0);
-//  ez = E(2,0);
-  TMatrixD E(3,1);
-  for(int node = 0; node < 8; node++) {
-    E(0,0) += -1 * nodes[elements[imap].emap[node]].v * ((*dN.at(node))(0,0)) * 1./TMath::Sqrt(TMath::Power(((*jac)(0,0)),2)+TMath::Power(((*jac)(0,1)),2)+TMath::Power(((*jac)(0,2)),2));
-    E(1,0) += -1 * nodes[elements[imap].emap[node]].v * ((*dN.at(node))(1,0)) * 1./TMath::Sqrt(TMath::Power(((*jac)(1,0)),2)+TMath::Power(((*jac)(1,1)),2)+TMath::Power(((*jac)(1,2)),2));
-    E(2,0) += -1 * nodes[elements[imap].emap[node]].v * ((*dN.at(node))(2,0)) * 1./TMath::Sqrt(TMath::Power(((*jac)(2,0)),2)+TMath::Power(((*jac)(2,1)),2)+TMath::Power(((*jac)(2,2)),2));
-  }
-  if(debug) {
-    E.Print();
-  }
-  // here two times -1 because t1 is in opposite direction of x
-  ex = -1 * E(1,0);
-  ey = E(0,0);
-  ez = E(2,0);
+  double gx, gy, gz;
+  Interpolate(m_potential, i, j, k, u, v, w, volt, gx, gy, gz);
+  ex = -gx;
+  ey = -gy;
+  ez = -gz;
 
   // Transform field to global coordinates
   UnmapFields(ex, ey, ez, x, y, z,
@@ -771,7 +753,8 @@ ComponentCST::ElectricField(
     std::cout << "    Element number: " << imap << "." << std::endl;
     std::cout << "    Material " << elements[imap].matmap << ", drift flag " 
               << materials[elements[imap].matmap].driftmedium << "." << std::endl;
-    std::cout << "    Local Coordinates (" << t1 << "," << t2 << "," << t3 
+    std::cout << "    Cell (" << i << "," << j << "," << k 
+              << "), local coordinates (" << u << "," << v << "," << w
               << ") Voltage: " << volt << "" << std::endl;
     std::cout << std::setprecision(15) << "    E-Field (" << ex << "," << ey << "," << ez << ")" << std::endl;
     std::cout << "*******End of ComponentCST::ElectricField********\n" << std::endl;
@@ -784,8 +767,6 @@ ComponentCST::ElectricField(
       if (m->IsDriftable()) status = 0;
     }
   }
-  ComponentCST::ClearVec(dN);
-  delete jac;
 
 }
 
@@ -832,55 +813,27 @@ ComponentCST::WeightingField(
     std::cout << "    Warnings have been issued for this field map." << std::endl;
   }
 
-  // Find the element that contains this point
-  double t1, t2, t3;
-  TMatrixD* jac = new TMatrixD(3,3);;
-  std::vector<TMatrixD*> dN;
-  int imap = FindElementCube(x, y, z, t1, t2, t3, jac, dN);
+  // Find the cell of the grid that contains this point
+  unsigned int i, j, k;
+  double u, v, w;
+  int imap = FindCell(x, y, z, i, j, k, u, v, w);
 
   // Check if the point is in the mesh
-  if (imap < 0) {
-    ComponentCST::ClearVec(dN);
-    delete jac;
-    return;
-  }
+  if (imap < 0) return;
 
   if (debug) {
     std::cout << className << "::WeightingField:" << std::endl;
     std::cout << "    Global: (" << x << "," << y << "," << z << ")," << std::endl;
-    std::cout << "    Local: (" << t1 << "," << t2 << "," << t3 
+    std::cout << "    Local: (" << u << "," << v << "," << w 
               << ") in element " << imap << " " << std::endl;
-    std::cout << "    Node xyzV" << std::endl;
-    for (int i = 0; i < 8; i++) {
-      std::cout << std::setprecision(15) << "  " << elements[imap].emap[i]
-                << " " << nodes[elements[imap].emap[i]].x
-                << " " << nodes[elements[imap].emap[i]].y
-                << " " << nodes[elements[imap].emap[i]].z
-                << " " << nodes[elements[imap].emap[i]].w[iw] << "" << std::endl;
-    }
   }
-  // invert Matrix
-  jac->InvertFast();
   // Field calculation
-  TMatrixD E(3,1);
-  E = (nodes[elements[imap].emap[0]].w[iw] * (*jac) * (*dN.at(0)) +
-      nodes[elements[imap].emap[1]].w[iw] * (*jac) * (*dN.at(1)) +
-      nodes[elements[imap].emap[2]].w[iw] * (*jac) * (*dN.at(2)) +
-      nodes[elements[imap].emap[3]].w[iw] * (*jac) * (*dN.at(3)) +
-      nodes[elements[imap].emap[4]].w[iw] * (*jac) * (*dN.at(4)) +
-      nodes[elements[imap].emap[5]].w[iw] * (*jac) * (*dN.at(5)) +
-      nodes[elements[imap].emap[6]].w[iw] * (*jac) * (*dN.at(6)) +
-      nodes[elements[imap].emap[7]].w[iw] * (*jac) * (*dN.at(7)));
-
-  wx = E(0,0);
-  wy = E(1,0);
-  wz = E(2,0);
+  double p;
+  Interpolate(m_weightingPotential[iw], i, j, k, u, v, w, p, wx, wy, wz);
   // Transform field to global coordinates
   UnmapFields(wx, wy, wz, x, y, z,
               xmirrored, ymirrored, zmirrored,
               rcoordinate, rotation);
-  ComponentCST::ClearVec(dN);
-  delete jac;
 }
 
 
@@ -923,37 +876,23 @@ ComponentCST::WeightingPotential(
     std::cout << "Warnings have been issued for this field map." << std::endl;
   }
 
-  // Find the element that contains this point
-  double t1, t2, t3;
-  TMatrixD* jac = 0;
-  std::vector<TMatrixD*> dN;
-  int imap = FindElementCube(x, y, z, t1, t2, t3, jac, dN);
+  // Find the cell of the grid that contains this point
+  unsigned int i, j, k;
+  double u, v, w;
+  int imap = FindCell(x, y, z, i, j, k, u, v, w);
   // Check if the point is in the mesh
   if (imap < 0) return 0.;
 
   if (debug) {
     std::cout << className << "::WeightingPotential:" << std::endl;
     std::cout << "    Global: (" << x << "," << y << "," << z << ")," << std::endl;
-    std::cout << "    Local: (" << t1 << "," << t2 << "," << t3 
+    std::cout << "    Local: (" << u << "," << v << "," << w 
               << ") in element " << imap << "" << std::endl;
-    std::cout << "  Node xyzV" << std::endl;
-    for (int i = 0; i < 8; ++i) {
-      std::cout << "  " << elements[imap].emap[i]
-                << " " <<  nodes[elements[imap].emap[i]].x
-                << " " <<  nodes[elements[imap].emap[i]].y
-                << " " <<  nodes[elements[imap].emap[i]].z
-                << " " <<  nodes[elements[imap].emap[i]].w[iw] << "" << std::endl;
-    }
   }
 
-  return (nodes[elements[imap].emap[0]].w[iw] * (1 - t1) * (1 - t2) * (1 - t3) +
-      nodes[elements[imap].emap[1]].w[iw] * (1 + t1) * (1 - t2) * (1 - t3) +
-      nodes[elements[imap].emap[2]].w[iw] * (1 + t1) * (1 + t2) * (1 - t3) +
-      nodes[elements[imap].emap[3]].w[iw] * (1 - t1) * (1 + t2) * (1 - t3) +
-      nodes[elements[imap].emap[4]].w[iw] * (1 - t1) * (1 - t2) * (1 + t3) +
-      nodes[elements[imap].emap[5]].w[iw] * (1 + t1) * (1 - t2) * (1 + t3) +
-      nodes[elements[imap].emap[6]].w[iw] * (1 + t1) * (1 + t2) * (1 + t3) +
-      nodes[elements[imap].emap[7]].w[iw] * (1 - t1) * (1 + t2) * (1 + t3)) / 8.;
+  double p, px, py, pz;
+  Interpolate(m_weightingPotential[iw], i, j, k, u, v, w, p, px, py, pz);
+  return p;
 
 }
 
@@ -987,9 +926,7 @@ ComponentCST::GetMedium(const double xin, const double yin, const double zin,
 
   // Find the element that contains this point.
   double t1, t2, t3;
-  TMatrixD* jac = 0;
-  std::vector<TMatrixD*> dN;
-  int imap = FindElementCube(x, y, z, t1, t2, t3, jac, dN);
+  int imap = FindElementCube(x, y, z, t1, t2, t3);
   if (imap < 0) {
     if (debug) {
       std::cerr << className << "::GetMedium:" << std::endl;
@@ -1134,137 +1071,117 @@ ComponentCST::GetNodesForElement(int element, std::vector<int> &nodes){
 
 int
 ComponentCST::FindElementCube(const double x, const double y, const double z,
-                              double& t1, double& t2, double& t3,
-                              TMatrixD* &jac, std::vector<TMatrixD*> &dN){
-
-  int imap = -1;
-  // check if point is in the component
-  if(!zPeriodic && !zMirrorPeriodic && !zAxiallyPeriodic && !zRotationSymmetry &&
-          (z < zMinBoundingBox || z >  zMaxBoundingBox))
-    return -1;
-  if(!yPeriodic && !yMirrorPeriodic && !yAxiallyPeriodic && !yRotationSymmetry &&
-          (y < yMinBoundingBox || y >  yMaxBoundingBox))
-    return -1;
-  if(!xPeriodic && !xMirrorPeriodic && !xAxiallyPeriodic && !xRotationSymmetry &&
-      (x < xMinBoundingBox || x >  xMaxBoundingBox))
-    return -1;
-
-
+                              double& t1, double& t2, double& t3){
 
-
-  // check if the last element matches
-  // if yes than leave directly
-  if (lastElement >= 0 &&
-      x >= nodes[elements[lastElement].emap[3]].x &&
-      y >= nodes[elements[lastElement].emap[3]].y &&
-      z >= nodes[elements[lastElement].emap[3]].z &&
-      x < nodes[elements[lastElement].emap[0]].x &&
-      y < nodes[elements[lastElement].emap[2]].y &&
-      z < nodes[elements[lastElement].emap[7]].z) {
-    imap = lastElement;
-    CoordinatesCube(x,y,z,t1,t2,t3,jac,dN,imap);
-    return imap;
-  }
-
-  // CST specific element search without an element loop
-  int index_x = 0, index_y = 0, index_z = 0;
-  if (imap == -1) {
-    std::vector<double>::iterator it;
-    double my_x[] = {x};
-    it = std::search(m_xlines.begin(),m_xlines.end(),my_x,my_x+1,Greater);
-    index_x = std::distance(m_xlines.begin(),(it-1));
-    double my_y[] = {y};
-    it = std::search(m_ylines.begin(),m_ylines.end(),my_y,my_y+1,Greater);
-    index_y = std::distance(m_ylines.begin(),(it-1));
-    double my_z[] = {z};
-    it = std::search(m_zlines.begin(),m_zlines.end(),my_z,my_z+1,Greater);
-    index_z = std::distance(m_zlines.begin(),(it-1));
-    /* Behavior at borders:
-    * x < x_min -> index_x = -1
-     * x = x_min -> index_x = 0
-     * x = x_max -> index_x = m_xlines.size() - 1
-     * x > x_max -> index_x = m_xlines.size() - 1
-    */
-
-    // check if the point is out of the mesh
-    if (index_x < 0 || index_y < 0 || index_z < 0 ||
-        index_x == int(m_xlines.size() - 1) || 
-        index_y == int(m_ylines.size() - 1) || 
-        index_z == int(m_zlines.size() - 1)) {
-      return -1;
-    } else {
-      imap = index_x + (m_xlines.size() - 1) * index_y + (m_xlines.size() - 1) * (m_ylines.size() - 1) * index_z;
-    }
-    if (debug && imap != -1) {
-      if (x < nodes[elements[imap].emap[3]].x || 
-          x > nodes[elements[imap].emap[0]].x ||
-          y < nodes[elements[imap].emap[3]].y || 
-          y > nodes[elements[imap].emap[2]].y ||
-          z < nodes[elements[imap].emap[3]].z || 
-          z > nodes[elements[imap].emap[7]].z) {
-        std::cout << "Element: " << imap << "\tPoint: (" << x << "," << y << "," << z << ")" << std::endl
-                  << "x: " << nodes[elements[imap].emap[3]].x << " - " << nodes[elements[imap].emap[0]].x << "" << std::endl
-                << "y: " << nodes[elements[imap].emap[3]].y << " - " << nodes[elements[imap].emap[2]].y << "" << std::endl
-                << "z: " << nodes[elements[imap].emap[3]].z << " - " << nodes[elements[imap].emap[7]].z << "\n" << std::endl;
-      }
-    }
-  }
-  // final test - should never fail
-  if (imap < 0 || imap > nElements) {
-    std::cerr << className << "::FindElementCube:" << std::endl;
-    std::cerr << "    Index of the element (imap is " << imap << ") is to large!"
-              << "    Number of Elements: " << nElements
-              << "\n    index_x: "   << index_x
-              << "\n    index_y: " << index_y
-              << "\n    index_z: " << index_z << std::endl;
+  unsigned int i, j, k;
+  double u, v, w;
+  const int imap = FindCell(x, y, z, i, j, k, u, v, w);
+  if (imap < 0) {
     if (debug) {
       std::cout << className << "::FindElementCube:" << std::endl;
       std::cout << "    Point (" << x << "," << y << "," << z
                 << ") not in the mesh, it is background or PEC." << std::endl;
-      std::cout << "    First node ("
-                << nodes[elements[0].emap[3]].x << ","
-                << nodes[elements[0].emap[3]].y << ","
-                << nodes[elements[0].emap[3]].z
-                << ") in the mesh." << std::endl;
-      std::cout << "    dx= " << (nodes[elements[0].emap[0]].x-nodes[elements[0].emap[3]].x)
-                << ", dy= " << (nodes[elements[0].emap[2]].y-nodes[elements[0].emap[3]].y)
-                << ", dz= " << (nodes[elements[0].emap[7]].z-nodes[elements[0].emap[3]].z)
-                << "" << std::endl;
-      std::cout << "    Last node (" << nodes[elements[nElements-1].emap[5]].x
-                << "," << nodes[elements[nElements-1].emap[5]].y
-                << "," << nodes[elements[nElements-1].emap[5]].z
-                << ") in the mesh." << std::endl;
-      std::cout << "  dx= " << (nodes[elements[nElements-1].emap[0]].x-nodes[elements[nElements-1].emap[3]].x)
-                << ", dy= " << (nodes[elements[nElements-1].emap[2]].y-nodes[elements[nElements-1].emap[3]].y)
-                << ", dz= " << (nodes[elements[nElements-1].emap[7]].z-nodes[elements[nElements-1].emap[3]].z)
-                << "" << std::endl;
     }
     return -1;
   }
-  CoordinatesCube(x,y,z,t1,t2,t3,jac,dN,imap);
+  // Hexahedral coordinates: t1 along y, t2 opposite to x, t3 along z
+  t1 = 2. * v - 1.;
+  t2 = 1. - 2. * u;
+  t3 = 2. * w - 1.;
   if (debug) {
     std::cout << className << "::FindElementCube:" << std::endl;
     std::cout << "Global: (" << x << "," << y << "," << z << ") in element "
               << imap << " (degenerate: "
               << elements[imap].degenerate << ")" << std::endl;
    std::cout << "      Node xyzV" << std::endl;
-    for (int i = 0; i < 8; i++) {
-      std::cout << "  " << elements[imap].emap[i]
-                << " " << nodes[elements[imap].emap[i]].x
-                << " " << nodes[elements[imap].emap[i]].y
-                << " " << nodes[elements[imap].emap[i]].z
-                << " " << nodes[elements[imap].emap[i]].v
+    for (int n = 0; n < 8; n++) {
+      std::cout << "  " << elements[imap].emap[n]
+                << " " << nodes[elements[imap].emap[n]].x
+                << " " << nodes[elements[imap].emap[n]].y
+                << " " << nodes[elements[imap].emap[n]].z
+                << " " << nodes[elements[imap].emap[n]].v
                 << "" << std::endl;
     }
   }
   return imap;
 }
-void ComponentCST::ClearVec(std::vector<TMatrixD*> &vec){
-  std::vector<TMatrixD*>::iterator it = vec.begin();
-  std::vector<TMatrixD*>::iterator end = vec.end();
-  while(it != end){
-    delete *it;
-    it++;
-  }
+
+int
+ComponentCST::FindCell(const double x, const double y, const double z,
+                       unsigned int& i, unsigned int& j, unsigned int& k,
+                       double& u, double& v, double& w) {
+
+  // check if point is in the component
+  if(!zPeriodic && !zMirrorPeriodic && !zAxiallyPeriodic && !zRotationSymmetry &&
+          (z < zMinBoundingBox || z >  zMaxBoundingBox))
+    return -1;
+  if(!yPeriodic && !yMirrorPeriodic && !yAxiallyPeriodic && !yRotationSymmetry &&
+          (y < yMinBoundingBox || y >  yMaxBoundingBox))
+    return -1;
+  if(!xPeriodic && !xMirrorPeriodic && !xAxiallyPeriodic && !xRotationSymmetry &&
+      (x < xMinBoundingBox || x >  xMaxBoundingBox))
+    return -1;
+
+  // The mesh is a tensor-product grid: 
+  // locate the point on each axis separately.
+  if (!FindLine(m_xlines, x, m_lastIx) ||
+      !FindLine(m_ylines, y, m_lastIy) ||
+      !FindLine(m_zlines, z, m_lastIz)) return -1;
+  i = m_lastIx; j = m_lastIy; k = m_lastIz;
+  u = (x - m_xlines[i]) / (m_xlines[i + 1] - m_xlines[i]);
+  v = (y - m_ylines[j]) / (m_ylines[j + 1] - m_ylines[j]);
+  w = (z - m_zlines[k]) / (m_zlines[k + 1] - m_zlines[k]);
+  return m_elementIndex[i + (m_xlines.size() - 1) * 
+                        (j + (m_ylines.size() - 1) * k)];
+
+}
+
+bool
+ComponentCST::FindLine(const std::vector<double>& lines, const double x, 
+                       int& index) {
+
+  // Check if we are still between the same lines as in the previous call.
+  if (index >= 0 && index < int(lines.size()) - 1 &&
+      x >= lines[index] && x < lines[index + 1]) return true;
+  // Binary search for the first line above x
+  std::vector<double>::const_iterator it = 
+    std::upper_bound(lines.begin(), lines.end(), x);
+  if (it == lines.begin() || it == lines.end()) return false;
+  index = int(it - lines.begin()) - 1;
+  return true;
+
+}
+
+void
+ComponentCST::Interpolate(const std::vector<double>& f,
+                          const unsigned int i, const unsigned int j,
+                          const unsigned int k,
+                          const double u, const double v, const double w,
+                          double& f0, double& fx, double& fy, double& fz) {
+
+  // Values at the corners of the cell
+  const unsigned int nx = m_xlines.size();
+  const unsigned int nxy = nx * m_ylines.size();
+  const unsigned int n = i + nx * j + nxy * k;
+  const double f000 = f[n],            f100 = f[n + 1];
+  const double f010 = f[n + nx],       f110 = f[n + nx + 1];
+  const double f001 = f[n + nxy],      f101 = f[n + nxy + 1];
+  const double f011 = f[n + nxy + nx], f111 = f[n + nxy + nx + 1];
+  // Interpolate along x, y and z
+  const double f00 = f000 + u * (f100 - f000);
+  const double f10 = f010 + u * (f110 - f010);
+  const double f01 = f001 + u * (f101 - f001);
+  const double f11 = f011 + u * (f111 - f011);
+  const double g0 = f00 + v * (f10 - f00);
+  const double g1 = f01 + v * (f11 - f01);
+  f0 = g0 + w * (g1 - g0);
+  // Gradient
+  fx = ((1. - v) * (1. - w) * (f100 - f000) + v * (1. - w) * (f110 - f010) +
+        (1. - v) * w * (f101 - f001) + v * w * (f111 - f011)) / 
+       (m_xlines[i + 1] - m_xlines[i]);
+  fy = ((1. - w) * (f10 - f00) + w * (f11 - f01)) / 
+       (m_ylines[j + 1] - m_ylines[j]);
+  fz = (g1 - g0) / (m_zlines[k + 1] - m_zlines[k]);
+
 }
 }
@@ -482,8 +482,7 @@ ComponentFieldMap::FindElement13(const double x, const double y, const double z,
 
 int
 ComponentFieldMap::FindElementCube(const double x, const double y, const double z,
-                      double& t1, double& t2, double& t3,
-                      TMatrixD* &jac, std::vector<TMatrixD*> &dN){
+                      double& t1, double& t2, double& t3){
   
   int imap = -1;
 
@@ -536,7 +535,7 @@ ComponentFieldMap::FindElementCube(const double x, const double y, const double
     }
     return -1;
   }
-  CoordinatesCube(x,y,z,t1,t2,t3,jac,dN,imap);
+  CoordinatesCube(x,y,z,t1,t2,t3,imap);
   if (debug) {
     std::cout << className << "::FindElementCube:\n";
     std::cout << "Global: (" << x << "," << y << "," << z << ") in element " 
@@ -1211,13 +1210,9 @@ v*nodes[elements[i].emap[7]].x-w*nodes[elements[i].emap[8]].x))*
 
 void
 ComponentFieldMap::JacobianCube(int element, double t1, double t2, double t3,
-                    TMatrixD* &jac, std::vector<TMatrixD*> &dN){
-  if (jac == 0) {
-    std::cerr << className << "::JacobianCube:\n";
-    std::cerr << "    Pointer to Jacobian matrix is empty!\n";
-    return;
-  }
-  dN.clear();
+                                double jac[3][3], double dN[8][3]) {
+
+  for (int j = 0; j < 3; ++j) jac[j][0] = jac[j][1] = jac[j][2] = 0.;
   // Be sure that the element is within range
   if (element < 0 || element >= nElements) {
     std::cerr << className << "::JacobianCube:\n";
@@ -1225,42 +1220,44 @@ ComponentFieldMap::JacobianCube(int element, double t1, double t2, double t3,
     return;
   }
   // Here the partial derivatives of the 8 shaping functions are calculated
-  double N1[3] = {-1 * (1 - t2) * (1 - t3), (1 - t1) * -1 * (1 - t3), (1 - t1) * (1 - t2) * -1};
-  double N2[3] = {+1 * (1 - t2) * (1 - t3), (1 + t1) * -1 * (1 - t3), (1 + t1) * (1 - t2) * -1};
-  double N3[3] = {+1 * (1 + t2) * (1 - t3), (1 + t1) * +1 * (1 - t3), (1 + t1) * (1 + t2) * -1};
-  double N4[3] = {-1 * (1 + t2) * (1 - t3), (1 - t1) * +1 * (1 - t3), (1 - t1) * (1 + t2) * -1};
-  double N5[3] = {-1 * (1 - t2) * (1 + t3), (1 - t1) * -1 * (1 + t3), (1 - t1) * (1 - t2) * +1};
-  double N6[3] = {+1 * (1 - t2) * (1 + t3), (1 + t1) * -1 * (1 + t3), (1 + t1) * (1 - t2) * +1};
-  double N7[3] = {+1 * (1 + t2) * (1 + t3), (1 + t1) * +1 * (1 + t3), (1 + t1) * (1 + t2) * +1};
-  double N8[3] = {-1 * (1 + t2) * (1 + t3), (1 - t1) * +1 * (1 + t3), (1 - t1) * (1 + t2) * +1};
-  // Partial derivatives are stored in dN
-  TMatrixD* m_N1 = new TMatrixD(3,1,N1); *m_N1 = (1./8. * (*m_N1)); dN.push_back(m_N1);
-  TMatrixD* m_N2 = new TMatrixD(3,1,N2); *m_N2 = (1./8. * (*m_N2)); dN.push_back(m_N2);
-  TMatrixD* m_N3 = new TMatrixD(3,1,N3); *m_N3 = (1./8. * (*m_N3)); dN.push_back(m_N3);
-  TMatrixD* m_N4 = new TMatrixD(3,1,N4); *m_N4 = (1./8. * (*m_N4)); dN.push_back(m_N4);
-  TMatrixD* m_N5 = new TMatrixD(3,1,N5); *m_N5 = (1./8. * (*m_N5)); dN.push_back(m_N5);
-  TMatrixD* m_N6 = new TMatrixD(3,1,N6); *m_N6 = (1./8. * (*m_N6)); dN.push_back(m_N6);
-  TMatrixD* m_N7 = new TMatrixD(3,1,N7); *m_N7 = (1./8. * (*m_N7)); dN.push_back(m_N7);
-  TMatrixD* m_N8 = new TMatrixD(3,1,N8); *m_N8 = (1./8. * (*m_N8)); dN.push_back(m_N8);
+  // and stored in dN. Shaping function i is 
+  // (1 + s1[i] * t1) * (1 + s2[i] * t2) * (1 + s3[i] * t3) / 8.
+  static const double s1[8] = {-1., +1., +1., -1., -1., +1., +1., -1.};
+  static const double s2[8] = {-1., -1., +1., +1., -1., -1., +1., +1.};
+  static const double s3[8] = {-1., -1., -1., -1., +1., +1., +1., +1.};
+  for (int node = 0; node < 8; ++node) {
+    const double f1 = 1. + s1[node] * t1;
+    const double f2 = 1. + s2[node] * t2;
+    const double f3 = 1. + s3[node] * t3;
+    dN[node][0] = s1[node] * f2 * f3 / 8.;
+    dN[node][1] = s2[node] * f1 * f3 / 8.;
+    dN[node][2] = s3[node] * f1 * f2 / 8.;
+  }
   // Calculation of the jacobian using dN
-  for(int node = 0; node<8; node++){
-      (*jac)(0,0) += nodes[elements[element].emap[node]].x * ((*dN.at(node))(0,0));
-      (*jac)(0,1) += nodes[elements[element].emap[node]].y * ((*dN.at(node))(0,0));
-      (*jac)(0,2) += nodes[elements[element].emap[node]].z * ((*dN.at(node))(0,0));
-      (*jac)(1,0) += nodes[elements[element].emap[node]].x * ((*dN.at(node))(1,0));
-      (*jac)(1,1) += nodes[elements[element].emap[node]].y * ((*dN.at(node))(1,0));
-      (*jac)(1,2) += nodes[elements[element].emap[node]].z * ((*dN.at(node))(1,0));
-      (*jac)(2,0) += nodes[elements[element].emap[node]].x * ((*dN.at(node))(2,0));
-      (*jac)(2,1) += nodes[elements[element].emap[node]].y * ((*dN.at(node))(2,0));
-      (*jac)(2,2) += nodes[elements[element].emap[node]].z * ((*dN.at(node))(2,0));
+  for (int node = 0; node < 8; ++node) {
+    const double xn = nodes[elements[element].emap[node]].x;
+    const double yn = nodes[elements[element].emap[node]].y;
+    const double zn = nodes[elements[element].emap[node]].z;
+    for (int j = 0; j < 3; ++j) {
+      jac[j][0] += xn * dN[node][j];
+      jac[j][1] += yn * dN[node][j];
+      jac[j][2] += zn * dN[node][j];
+    }
   }
 
   // compute determinant
-  if(debug){
+  if (debug) {
+    const double det = 
+      jac[0][0] * (jac[1][1] * jac[2][2] - jac[1][2] * jac[2][1]) -
+      jac[0][1] * (jac[1][0] * jac[2][2] - jac[1][2] * jac[2][0]) +
+      jac[0][2] * (jac[1][0] * jac[2][1] - jac[1][1] * jac[2][0]);
     std::cout << className << "::JacobianCube:" << std::endl;
-    std::cout << "   Det.: " << jac->Determinant() << std::endl;
+    std::cout << "   Det.: " << det << std::endl;
     std::cout << "   Jacobian matrix.: " << std::endl;
-    jac->Print("%11.10g");
+    for (int j = 0; j < 3; ++j) {
+      std::cout << "     " << jac[j][0] << "  " << jac[j][1] 
+                << "  " << jac[j][2] << std::endl;
+    }
     std::cout << "   Hexahedral coordinates (t, u, v) = (" << t1 << "," << t2 << "," << t3 << ")" << std::endl;
     std::cout << "   Node xyzV" << std::endl;
     for (int node = 0; node < 8; node++) {
@@ -2215,8 +2212,7 @@ ComponentFieldMap::Coordinates13(double x, double y, double z,
 
 int
 ComponentFieldMap::CoordinatesCube(double x, double y, double z,
-            double& t1, double& t2, double& t3,
-            TMatrixD* &jac, std::vector<TMatrixD*> &dN, int imap) {
+            double& t1, double& t2, double& t3, int imap) {
             
    /*
    global coordinates   7__ _ _ 6     t3    t2
@@ -2272,7 +2268,6 @@ ComponentFieldMap::CoordinatesCube(double x, double y, double z,
     std::cout << "    Hexahedral coordinates (t, u, v) = (" << t1 << "," << t2 << "," << t3 << ")\n";
     std::cout << "    Checksum - 1:           " << (sr - 1) << "\n";
   }
-  if(jac != 0) JacobianCube(imap,t1,t2,t3,jac,dN);
   // This should always work.
   ifail = 0;
   return ifail;
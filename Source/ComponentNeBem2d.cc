@@ -2,6 +2,7 @@
 #include <iomanip>
 #include <fstream>
 #include <cmath>
+#include <algorithm>
 
 #include "ComponentNeBem2d.hh"
 #include "Random.hh"
@@ -13,13 +14,14 @@ namespace Garfield {
 ComponentNeBem2d::ComponentNeBem2d() :
   projAxis(2), nDivisions(5), nCollocationPoints(3), minSize(1.e-3),
   autoSize(false), randomCollocation(false), nMaxIterations(3), 
+  iterativeSolver(false), solverTolerance(1.e-8), 
+  nMaxSolverIterations(1000), nKrylov(50),
   nPanels(0), nWires(0), nElements(0), 
-  matrixInversionFlag(false) {
+  matrixFactorisedFlag(false) {
 
   className = "ComponentNeBem2d";
   
   influenceMatrix.clear();
-  inverseMatrix.clear(); 
   
 }
 
@@ -173,7 +175,7 @@ ComponentNeBem2d::AddPanel(const double x0, const double y0,
   }
       
   ready = false;
-  matrixInversionFlag = false;
+  matrixFactorisedFlag = false;
 
 }
 
@@ -203,7 +205,7 @@ ComponentNeBem2d::AddWire(const double x0, const double y0,
   }
 
   ready = false;
-  matrixInversionFlag = false;
+  matrixFactorisedFlag = false;
 
 }
 
@@ -218,7 +220,7 @@ ComponentNeBem2d::SetNumberOfDivisions(const int ndiv) {
 
   nDivisions = ndiv;
   ready = false;
-  matrixInversionFlag = false;
+  matrixFactorisedFlag = false;
 
 }
 
@@ -233,7 +235,7 @@ ComponentNeBem2d::SetNumberOfCollocationPoints(const int ncoll) {
   
   nCollocationPoints = ncoll;
   ready = false;
-  matrixInversionFlag = false;
+  matrixFactorisedFlag = false;
 
 }
 
@@ -248,7 +250,7 @@ ComponentNeBem2d::SetMinimumElementSize(const double min) {
 
   minSize = min;
   ready = false;
-  matrixInversionFlag = false;
+  matrixFactorisedFlag = false;
 
 }
 
@@ -294,16 +296,16 @@ ComponentNeBem2d::Initialise() {
       return false;
     }
     
-    // Invert the influence matrix
-    if (!InvertMatrix()) {
+    // Factorise the influence matrix
+    if (!Factorise()) {
       std::cerr << className << "::Initialise:\n";
-      std::cerr << "     Error inverting the influence matrix.\n";
+      std::cerr << "     Error factorising the influence matrix.\n";
       return false;
     }
 
     if (debug) {
       std::cout << className << "::Initialise:\n";
-      std::cout << "    Matrix inversion ok.\n";
+      std::cout << "    Matrix factorisation ok.\n";
     }
   
     // Compute the right hand side vector
@@ -392,97 +394,79 @@ ComponentNeBem2d::Discretise() {
 bool 
 ComponentNeBem2d::ComputeInfluenceMatrix() {
 
-  if (matrixInversionFlag) return true;
+  if (matrixFactorisedFlag) return true;
 
-  // Coordinates, rotation and length of target and source element
-  double xF, yF, phiF;
-  double xS, yS, phiS, lenS;
-  // Geometric type
-  int gtS;
-  // Boundary type of target element
-  int etF;
-
-  // Global and local distance
-  double dx, dy;
-  double du, dv;
-  // Field components in local and global coordinates
-  double fx, fy;
-  double ex, ey;
-
-  // Influence coefficient
-  double infCoeff;
+  // Check the boundary types of the target elements
+  for (int iF = 0; iF < nElements; ++iF) {
+    const int etF = elements[iF].bcType;
+    if (etF < 0 || etF > 2) {
+      std::cerr << className << "::ComputeInfluenceMatrix:\n";
+      std::cerr << "    Unknown boundary type: " << etF << ".\n";
+      return false;
+    }
+  }
 
-  // Re-dimension the influence matrix
-  int nEntries = nElements + 1;
-  influenceMatrix.resize(nEntries);
-  for (int i = nEntries; i--;) influenceMatrix[i].resize(nEntries);
+  // Re-dimension the influence matrix (stored row by row)
+  const int nEntries = nElements + 1;
+  influenceMatrix.assign(nEntries * nEntries, 0.);
 
+  int nErrors = 0;
   // Loop over the target elements (F)
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 16) reduction(+:nErrors)
+#endif
   for (int iF = 0; iF < nElements; ++iF) {
-    phiF = elements[iF].phi;
+    const double phiF = elements[iF].phi;
     // Boundary type
-    etF = elements[iF].bcType;
+    const int etF = elements[iF].bcType;
     // Collocation point
-    xF = elements[iF].cX;
-    yF = elements[iF].cY;
+    const double xF = elements[iF].cX;
+    const double yF = elements[iF].cY;
+    double* row = &influenceMatrix[iF * nEntries];
     
     // Loop over the source elements (S)
     for (int jS = 0; jS < nElements; ++jS) {
-      gtS = elements[jS].geoType;
-      xS = elements[jS].cX; yS = elements[jS].cY;
-      phiS = elements[jS].phi;
-      lenS = elements[jS].len;
+      const int gtS = elements[jS].geoType;
+      const double phiS = elements[jS].phi;
+      const double lenS = elements[jS].len;
       // Transform to local coordinate system of source element
-      dx = xF - xS; dy = yF - yS;
+      const double dx = xF - elements[jS].cX;
+      const double dy = yF - elements[jS].cY;
+      double du, dv;
       Rotate(dx, dy, phiS, Global2Local, du, dv);
-      infCoeff = 0.;
+      // Influence coefficient
+      double infCoeff = 0.;
       // Depending on the element type at the field point 
       // different boundary conditions need to be applied
-      switch (etF) {
-        // Conductor at fixed potential
-        case 0:
-         if (!ComputePotential(gtS, lenS, du, dv, infCoeff)) {
-            return false;
-          }
-          break;
-       // Floating conductor (not implemented)
-        case 1:
-          if (!ComputePotential(gtS, lenS, du, dv, infCoeff)) {
-            return false;
-          }
-          break;
+      if (etF == 2) {
         // Dielectric-dielectric interface
         // Normal component of the displacement vector is continuous 
-        case 2:
-          if (iF == jS) {
-            // Self-influence
-            infCoeff = 1. / (2. * elements[jS].lambda * VacuumPermittivity);
-          } else {
-            // Compute flux at field point in global coordinate system
-            if (!ComputeFlux(gtS, lenS, phiS, du, dv, fx, fy)) {
-              return false;
-             }
-            // Rotate to local coordinate system of field element
-            Rotate(fx, fy, phiF, Global2Local, ex, ey);
-            infCoeff = ey;
-          }
-          break;
-        default:
-          std::cerr << className << "::ComputeInfluenceMatrix:\n";
-          std::cerr << "    Unknown boundary type: " << etF << ".\n";
-          return false;
-          break;
+        if (iF == jS) {
+          // Self-influence
+          infCoeff = 1. / (2. * elements[jS].lambda * VacuumPermittivity);
+        } else {
+          // Compute flux at field point in global coordinate system
+          double fx = 0., fy = 0.;
+          if (!ComputeFlux(gtS, lenS, phiS, du, dv, fx, fy)) ++nErrors;
+          // Rotate to local coordinate system of field element
+          double ex, ey;
+          Rotate(fx, fy, phiF, Global2Local, ex, ey);
+          infCoeff = ey;
+        }
+      } else {
+        // Conductor at fixed potential or
+        // floating conductor (not implemented)
+        if (!ComputePotential(gtS, lenS, du, dv, infCoeff)) ++nErrors;
       }
-      influenceMatrix[iF][jS] = infCoeff;
+      row[jS] = infCoeff;
     }
   }
+  if (nErrors > 0) return false;
   
   // Add charge neutrality condition
   for (int i = 0; i < nElements; ++i) {
-    influenceMatrix[nElements][i] = elements[i].len;
-    influenceMatrix[i][nElements] = 0.;
+    influenceMatrix[nElements * nEntries + i] = elements[i].len;
   }
-  influenceMatrix[nElements][nElements] = 0.;
 
   return true;
   
@@ -521,44 +505,44 @@ ComponentNeBem2d::SplitElement(const int iel) {
 
 }
 
+void
+ComponentNeBem2d::SetIterativeSolverParameters(const double tol,
+                                               const int nmax,
+                                               const int restart) {
+
+  if (tol < Small || nmax <= 0 || restart <= 0) {
+    std::cerr << className << "::SetIterativeSolverParameters:\n";
+    std::cerr << "    Tolerance, number of iterations and restart length\n";
+    std::cerr << "    must be greater than zero.\n";
+    return;
+  }
+
+  solverTolerance = tol;
+  nMaxSolverIterations = nmax;
+  nKrylov = restart;
+  ready = false;
+
+}
+
 bool 
-ComponentNeBem2d::InvertMatrix() {
+ComponentNeBem2d::Factorise() {
 
-  // Check if matrix inversion has already been done
-  if (matrixInversionFlag) return true;
- 
-  const int nEntries = nElements + 1;
+  // Check if the matrix has already been factorised
+  if (matrixFactorisedFlag) return true;
  
-  // Initialise the inverse influence matrix
-  inverseMatrix.resize(nEntries);
-  for (int i = nEntries; i--;) inverseMatrix[i].resize(nEntries);
-   
-  // Initialise temporary arrays for LU decomposition/substitution
-  col.resize(nEntries);
-  index.resize(nEntries);
-
-  // Decompose the influence matrix
-  if (!LUDecomposition()) {
-    std::cerr << className << "::InvertMatrix:\n";
-    std::cerr << "    LU Decomposition failed.\n";
-    return false;
-  }
-  
-  // Invert the matrix
-  for (int j = 0; j < nEntries; ++j) {
-    for (int i = 0; i < nEntries; ++i) col[i] = 0.;
-    col[j] = 1.;
-    LUSubstitution();
-    for (int i = 0; i < nEntries; ++i) inverseMatrix[i][j] = col[i];
+  // The iterative solver works on the influence matrix itself
+  if (!iterativeSolver) {
+    index.resize(nElements);
+    // Decompose the influence matrix
+    if (!LUDecomposition()) {
+      std::cerr << className << "::Factorise:\n";
+      std::cerr << "    LU Decomposition failed.\n";
+      return false;
+    }
   }
   
-  // Clear the influence matrix and the temporary arrays
-  influenceMatrix.clear();
-  col.clear();
-  index.clear();
-  
-  // Set flag that the matrix has been inverted
-  matrixInversionFlag = true;
+  // Set flag that the matrix has been factorised
+  matrixFactorisedFlag = true;
   
   return true;
   
@@ -567,25 +551,28 @@ ComponentNeBem2d::InvertMatrix() {
 bool 
 ComponentNeBem2d::LUDecomposition() {
 
-  // The influence matrix is replaced by the LU decomposition of a rowwise
-  // permutation of itself. 
+  // The influence matrix is replaced in place by the LU decomposition 
+  // of a rowwise permutation of itself (implicit scaling, partial pivoting).
   // The implementation is based on:
   // W. H. Press,
   // Numerical recipes in C++: the Art of Scientific Computing (version 2.11)
+  // but eliminates row by row (right-looking) such that the update 
+  // of the remaining rows can be distributed over several threads.
 
   const int n = nElements;
+  const int ld = nElements + 1;
+  double* a = &influenceMatrix[0];
   
   // v stores the implicit scaling of each row
   std::vector<double> v;
   v.resize(n);
 
-  int i, j, k;
   // Loop over rows to get the implicit scaling information.
   double big = 0., temp = 0.;
-  for (i = 0; i < n; ++i) {
+  for (int i = 0; i < n; ++i) {
     big = 0.;
-    for (j = 0; j < n; ++j) {
-      temp = fabs(influenceMatrix[i][j]);
+    for (int j = 0; j < n; ++j) {
+      temp = fabs(a[i * ld + j]);
       if (temp > big) big = temp;
     }
     if (big == 0.) return false;
@@ -594,24 +581,14 @@ ComponentNeBem2d::LUDecomposition() {
   }
   
   // Loop over columns
-  double sum = 0., dum = 0.;
+  double dum = 0.;
   int imax = 0;
-  for (j = 0; j < n; ++j) {
-    for (i = 0; i < j; ++i) {
-      sum = influenceMatrix[i][j];
-      for (k = 0; k < i; ++k) sum -= influenceMatrix[i][k] * 
-                                     influenceMatrix[k][j];
-      influenceMatrix[i][j] = sum;
-    }
-    // Initialise for the search for the largest pivot element
+  for (int j = 0; j < n; ++j) {
+    // Search for the largest pivot element
     big = 0.;
-    for (i = j; i < n; ++i) {
-      sum = influenceMatrix[i][j];
-      for (k = 0; k < j; ++k) sum -= influenceMatrix[i][k] * 
-                                     influenceMatrix[k][j];
-      influenceMatrix[i][j] = sum;
-      // Is the figure of merit for the pivot better than the best so far?      
-      dum = v[i] * fabs(sum);
+    imax = j;
+    for (int i = j; i < n; ++i) {
+      dum = v[i] * fabs(a[i * ld + j]);
       if (dum >= big) {
         big = dum;
         imax = i;
@@ -619,20 +596,30 @@ ComponentNeBem2d::LUDecomposition() {
     }
     // Do we need to interchange rows?
     if (j != imax) {
-      for (k = 0; k < n; ++k) {
-        dum = influenceMatrix[imax][k];
-        influenceMatrix[imax][k] = influenceMatrix[j][k];
-        influenceMatrix[j][k] = dum;
+      double* rj = a + j * ld;
+      double* rm = a + imax * ld;
+      for (int k = 0; k < n; ++k) {
+        dum = rm[k];
+        rm[k] = rj[k];
+        rj[k] = dum;
       }
       // Interchange the scale factor
       v[imax] = v[j];
     }
     index[j] = imax;
-    if (influenceMatrix[j][j] == 0.) influenceMatrix[j][j] = Small;
-    if (j != n - 1) {
-      // Divide by the pivot element
-      dum = 1. / (influenceMatrix[j][j]);
-      for (i = j + 1; i < n; ++i) influenceMatrix[i][j] *= dum;
+    if (a[j * ld + j] == 0.) a[j * ld + j] = Small;
+    // Divide by the pivot element and update the remaining rows
+    const double pivot = 1. / a[j * ld + j];
+    const double* rj = a + j * ld;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) if (n - j > 128)
+#endif
+    for (int i = j + 1; i < n; ++i) {
+      double* ri = a + i * ld;
+      ri[j] *= pivot;
+      const double f = ri[j];
+      if (f == 0.) continue;
+      for (int k = j + 1; k < n; ++k) ri[k] -= f * rj[k];
     }
   }
   
@@ -641,36 +628,180 @@ ComponentNeBem2d::LUDecomposition() {
 }
 
 void 
-ComponentNeBem2d::LUSubstitution() {
+ComponentNeBem2d::LUSubstitution(std::vector<double>& x) {
 
   const int n = nElements;  
+  const int ld = nElements + 1;
+  const double* a = &influenceMatrix[0];
   
   double sum = 0.;
-  int i, j;
   int ii = 0, ip = 0;
 
   // Forward substitution
-  for (i = 0; i < n; ++i) {
+  for (int i = 0; i < n; ++i) {
     ip = index[i];
-    sum = col[ip];
-    col[ip] = col[i];
+    sum = x[ip];
+    x[ip] = x[i];
     if (ii != 0) {
-      for (j = ii - 1; j < i; ++j) sum -= influenceMatrix[i][j] * col[j];
+      const double* ri = a + i * ld;
+      for (int j = ii - 1; j < i; ++j) sum -= ri[j] * x[j];
     } else if (sum != 0.) {
       ii = i + 1;
     }
-    col[i] = sum;
+    x[i] = sum;
   }
 
   // Backsubstitution  
-  for (i = n - 1; i >= 0; i--) {
-    sum = col[i];
-    for (j = i + 1; j < n; ++j) sum -= influenceMatrix[i][j] * col[j];
-    col[i] = sum / influenceMatrix[i][i];
+  for (int i = n - 1; i >= 0; i--) {
+    const double* ri = a + i * ld;
+    sum = x[i];
+    for (int j = i + 1; j < n; ++j) sum -= ri[j] * x[j];
+    x[i] = sum / ri[i];
   }
   
 }
 
+void
+ComponentNeBem2d::MultiplyInfluenceMatrix(const std::vector<double>& x,
+                                          std::vector<double>& y) {
+
+  const int n = nElements;
+  const int ld = nElements + 1;
+  const double* a = &influenceMatrix[0];
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static) if (n > 256)
+#endif
+  for (int i = 0; i < n; ++i) {
+    const double* ri = a + i * ld;
+    double sum = 0.;
+    for (int j = 0; j < n; ++j) sum += ri[j] * x[j];
+    y[i] = sum;
+  }
+
+}
+
+bool
+ComponentNeBem2d::SolveIterative(std::vector<double>& x) {
+
+  // Restarted GMRES with Jacobi (row scaling) preconditioning
+  // Y. Saad and M. H. Schultz, 
+  // SIAM J. Sci. Stat. Comput. 7 (1986), 856-869
+
+  const int n = nElements;
+  const int ld = nElements + 1;
+  const int m = std::min(nKrylov, n);
+
+  // Preconditioner: inverse of the diagonal
+  std::vector<double> d(n, 1.);
+  for (int i = n; i--;) {
+    const double aii = influenceMatrix[i * ld + i];
+    if (fabs(aii) > Small) d[i] = 1. / aii;
+  }
+
+  // Preconditioned right-hand side
+  std::vector<double> b(n, 0.);
+  double bnorm = 0.;
+  for (int i = n; i--;) {
+    b[i] = d[i] * x[i];
+    bnorm += b[i] * b[i];
+  }
+  bnorm = sqrt(bnorm);
+  x.assign(n, 0.);
+  if (bnorm < Small) return true;
+
+  // Krylov basis, Hessenberg matrix and Givens rotations
+  std::vector<std::vector<double> > v(m + 1, std::vector<double>(n, 0.));
+  std::vector<std::vector<double> > h(m + 1, std::vector<double>(m, 0.));
+  std::vector<double> cs(m, 0.), sn(m, 0.), g(m + 1, 0.), y(m, 0.);
+  std::vector<double> w(n, 0.);
+
+  int nIter = 0;
+  double residual = 1.;
+  while (nIter < nMaxSolverIterations) {
+    // Compute the (preconditioned) residual
+    MultiplyInfluenceMatrix(x, w);
+    double beta = 0.;
+    for (int i = n; i--;) {
+      v[0][i] = b[i] - d[i] * w[i];
+      beta += v[0][i] * v[0][i];
+    }
+    beta = sqrt(beta);
+    residual = beta / bnorm;
+    if (residual < solverTolerance) break;
+    for (int i = n; i--;) v[0][i] /= beta;
+    g.assign(m + 1, 0.);
+    g[0] = beta;
+
+    int k = 0;
+    while (k < m && nIter < nMaxSolverIterations) {
+      MultiplyInfluenceMatrix(v[k], w);
+      for (int i = n; i--;) w[i] *= d[i];
+      // Modified Gram-Schmidt orthogonalisation
+      for (int j = 0; j <= k; ++j) {
+        double s = 0.;
+        for (int i = n; i--;) s += w[i] * v[j][i];
+        h[j][k] = s;
+        for (int i = n; i--;) w[i] -= s * v[j][i];
+      }
+      double wnorm = 0.;
+      for (int i = n; i--;) wnorm += w[i] * w[i];
+      wnorm = sqrt(wnorm);
+      h[k + 1][k] = wnorm;
+      if (wnorm > 0.) {
+        for (int i = n; i--;) v[k + 1][i] = w[i] / wnorm;
+      }
+      // Apply the previous rotations to the new column
+      for (int j = 0; j < k; ++j) {
+        const double t = cs[j] * h[j][k] + sn[j] * h[j + 1][k];
+        h[j + 1][k] = -sn[j] * h[j][k] + cs[j] * h[j + 1][k];
+        h[j][k] = t;
+      }
+      // Compute the rotation eliminating h[k + 1][k]
+      const double r = sqrt(h[k][k] * h[k][k] + wnorm * wnorm);
+      if (r > 0.) {
+        cs[k] = h[k][k] / r;
+        sn[k] = wnorm / r;
+      } else {
+        cs[k] = 1.;
+        sn[k] = 0.;
+      }
+      h[k][k] = r;
+      h[k + 1][k] = 0.;
+      g[k + 1] = -sn[k] * g[k];
+      g[k] = cs[k] * g[k];
+      ++k;
+      ++nIter;
+      residual = fabs(g[k]) / bnorm;
+      if (residual < solverTolerance || wnorm == 0.) break;
+    }
+
+    // Solve the upper triangular system and update the solution
+    for (int i = k; i--;) {
+      double s = g[i];
+      for (int j = i + 1; j < k; ++j) s -= h[i][j] * y[j];
+      y[i] = h[i][i] != 0. ? s / h[i][i] : 0.;
+    }
+    for (int j = 0; j < k; ++j) {
+      for (int i = n; i--;) x[i] += y[j] * v[j][i];
+    }
+    if (residual < solverTolerance) break;
+  }
+
+  if (debug) {
+    std::cout << className << "::SolveIterative:\n";
+    std::cout << "    " << nIter << " iterations, relative residual "
+              << residual << ".\n";
+  }
+  if (residual >= solverTolerance) {
+    std::cerr << className << "::SolveIterative:\n";
+    std::cerr << "    No convergence after " << nIter << " iterations"
+              << " (relative residual " << residual << ").\n";
+    return false;
+  }
+  return true;
+
+}
+
 bool 
 ComponentNeBem2d::GetBoundaryConditions() {   
  
@@ -700,18 +831,17 @@ ComponentNeBem2d::GetBoundaryConditions() {
 bool 
 ComponentNeBem2d::Solve() {
 
-  const int nEntries = nElements + 1;
-
-  int i, j;
-  double solution = 0.;
-  for (i = nElements; i--;) {
-    solution = 0.;
-    for (j = nEntries; j--;) {
-      solution += inverseMatrix[i][j] * boundaryConditions[j];
-    }
-    elements[i].solution = solution;
+  std::vector<double> x(boundaryConditions.begin(), 
+                        boundaryConditions.begin() + nElements);
+  if (iterativeSolver) {
+    if (!SolveIterative(x)) return false;
+  } else {
+    LUSubstitution(x);
   }
 
+  int i;
+  for (i = nElements; i--;) elements[i].solution = x[i];
+
   if (debug) {
     std::cout << className << "::Solve:\n";
     std::cout << "  Element  Solution\n";
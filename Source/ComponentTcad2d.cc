@@ -6,6 +6,7 @@
 #include <cmath>
 
 #include "ComponentTcad2d.hh"
+#include "GarfieldConstants.hh"
 
 namespace Garfield {
 
@@ -16,7 +17,8 @@ ComponentTcad2d::ComponentTcad2d() :
   hasElectronMobility(false), hasHoleMobility(false),
   pMin(0.), pMax(0.),
   hasBoundingBox(false), hasRangeZ(false), 
-  lastElement(0) {
+  lastElement(0),
+  nGridX(1), nGridY(1), xGridStep(1.), yGridStep(1.) {
 
   className = "ComponentTcad2d";
     
@@ -93,226 +95,32 @@ ComponentTcad2d::ElectricField(
   
   // Initialise the electric field and potential.
   ex = ey = ez = p = 0.;
-  // Assume this will work.
-  status = 0;
-  // Check if the point is still located in the previously found element.
-  int i = lastElement;
-  switch (elements[i].type) {
-    case 1:
-      if (CheckLine(x, y, i)) {
-        ex = w[0] * vertices[elements[i].vertex[0]].ex + 
-             w[1] * vertices[elements[i].vertex[1]].ex;
-        ey = w[0] * vertices[elements[i].vertex[0]].ey + 
-             w[1] * vertices[elements[i].vertex[1]].ey;
-        p  = w[0] * vertices[elements[i].vertex[0]].p + 
-             w[1] * vertices[elements[i].vertex[1]].p;
-        if (xMirrored) ex = -ex;
-        if (yMirrored) ey = -ey;
-        m = regions[elements[i].region].medium;
-        if (!regions[elements[i].region].drift || m == 0) status = -5;
-        return;
-      } 
-      break;
-    case 2:
-      if (CheckTriangle(x, y, i)) {
-        ex = w[0] * vertices[elements[i].vertex[0]].ex + 
-             w[1] * vertices[elements[i].vertex[1]].ex + 
-             w[2] * vertices[elements[i].vertex[2]].ex;
-        ey = w[0] * vertices[elements[i].vertex[0]].ey + 
-             w[1] * vertices[elements[i].vertex[1]].ey + 
-             w[2] * vertices[elements[i].vertex[2]].ey;
-        p  = w[0] * vertices[elements[i].vertex[0]].p + 
-             w[1] * vertices[elements[i].vertex[1]].p + 
-             w[2] * vertices[elements[i].vertex[2]].p;
-        if (xMirrored) ex = -ex;
-        if (yMirrored) ey = -ey;
-        m = regions[elements[i].region].medium;
-        if (!regions[elements[i].region].drift || m == 0) status = -5;
-        return;
-      }
-      break;  
-    case 3:
-      if (CheckRectangle(x, y, i)) {
-        ex = w[0] * vertices[elements[i].vertex[0]].ex + 
-             w[1] * vertices[elements[i].vertex[1]].ex + 
-             w[2] * vertices[elements[i].vertex[2]].ex + 
-             w[3] * vertices[elements[i].vertex[3]].ex;
-        ey = w[0] * vertices[elements[i].vertex[0]].ey + 
-             w[1] * vertices[elements[i].vertex[1]].ey + 
-             w[2] * vertices[elements[i].vertex[2]].ey + 
-             w[3] * vertices[elements[i].vertex[3]].ey;
-        p  = w[0] * vertices[elements[i].vertex[0]].p + 
-             w[1] * vertices[elements[i].vertex[1]].p + 
-             w[2] * vertices[elements[i].vertex[2]].p + 
-             w[3] * vertices[elements[i].vertex[3]].p;
-        if (xMirrored) ex = -ex;
-        if (yMirrored) ey = -ey;
-        m = regions[elements[i].region].medium;
-        if (!regions[elements[i].region].drift || m == 0) status = -5;
-        return;
-      }
-      break;
-    default: 
+
+  // Find the element which contains the point.
+  const int i = FindElement(x, y);
+  if (i < 0) {
+    // Point is outside the mesh.
+    if (debug) {
       std::cerr << className << "::ElectricField:\n";
-      std::cerr << "    Unknown element type (" 
-                << elements[i].type << ").\n";
-      status = -11;
-      return;
-      break;
-  }
-  
-  // The point is not in the previous element.
-  // Check the adjacent elements.
-  for (int j = elements[lastElement].nNeighbours; j--;) {
-    i = elements[lastElement].neighbours[j];
-    if (x < vertices[elements[i].vertex[0]].x) continue;
-    switch (elements[i].type) {
-      case 1:
-        if (CheckLine(x, y, i)) {
-          ex = w[0] * vertices[elements[i].vertex[0]].ex + 
-               w[1] * vertices[elements[i].vertex[1]].ex;
-          ey = w[0] * vertices[elements[i].vertex[0]].ey + 
-               w[1] * vertices[elements[i].vertex[1]].ey;
-          p  = w[0] * vertices[elements[i].vertex[0]].p + 
-               w[1] * vertices[elements[i].vertex[1]].p;
-          if (xMirrored) ex = -ex;
-          if (yMirrored) ey = -ey;
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (!regions[elements[i].region].drift || m == 0) status = -5; 
-          return;
-        }
-        break;
-      case 2:
-        if (CheckTriangle(x, y, i)) {
-          ex = w[0] * vertices[elements[i].vertex[0]].ex + 
-               w[1] * vertices[elements[i].vertex[1]].ex + 
-               w[2] * vertices[elements[i].vertex[2]].ex;
-          ey = w[0] * vertices[elements[i].vertex[0]].ey + 
-               w[1] * vertices[elements[i].vertex[1]].ey + 
-               w[2] * vertices[elements[i].vertex[2]].ey;
-          p  = w[0] * vertices[elements[i].vertex[0]].p + 
-               w[1] * vertices[elements[i].vertex[1]].p + 
-               w[2] * vertices[elements[i].vertex[2]].p;               
-          if (xMirrored) ex = -ex;
-          if (yMirrored) ey = -ey;
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (!regions[elements[i].region].drift || m == 0) status = -5; 
-          return;
-        }
-        break;    
-      case 3:
-        if (CheckRectangle(x, y, i)) {
-          ex = w[0] * vertices[elements[i].vertex[0]].ex + 
-               w[1] * vertices[elements[i].vertex[1]].ex + 
-               w[2] * vertices[elements[i].vertex[2]].ex + 
-               w[3] * vertices[elements[i].vertex[3]].ex;
-          ey = w[0] * vertices[elements[i].vertex[0]].ey + 
-               w[1] * vertices[elements[i].vertex[1]].ey + 
-               w[2] * vertices[elements[i].vertex[2]].ey + 
-               w[3] * vertices[elements[i].vertex[3]].ey;
-          p  = w[0] * vertices[elements[i].vertex[0]].p + 
-               w[1] * vertices[elements[i].vertex[1]].p + 
-               w[2] * vertices[elements[i].vertex[2]].p + 
-               w[3] * vertices[elements[i].vertex[3]].p;               
-          if (xMirrored) ex = -ex;
-          if (yMirrored) ey = -ey;
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (!regions[elements[i].region].drift || m == 0) status = -5;
-          return;
-        }
-        break;
-      default:
-        std::cerr << className << "::ElectricField:\n";
-        std::cerr << "    Invalid element type (" 
-                  << elements[i].type << ").\n";
-        status = -11;
-        return;
-        break;
-    }
-  }
-  
-  // The point is not in the previous element nor in the adjacent ones.
-  // We have to loop over all elements.
-  for (i = nElements; i--;) {
-    if (x < vertices[elements[i].vertex[0]].x) continue;
-    switch (elements[i].type) {
-      case 1:
-        if (CheckLine(x, y, i)) {
-          ex = w[0] * vertices[elements[i].vertex[0]].ex + 
-               w[1] * vertices[elements[i].vertex[1]].ex;
-          ey = w[0] * vertices[elements[i].vertex[0]].ey + 
-               w[1] * vertices[elements[i].vertex[1]].ey;
-          p  = w[0] * vertices[elements[i].vertex[0]].p + 
-               w[1] * vertices[elements[i].vertex[1]].p;
-          if (xMirrored) ex = -ex;
-          if (yMirrored) ey = -ey;
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (!regions[elements[i].region].drift || m == 0) status = -5; 
-          return;
-        }
-        break;
-      case 2:
-        if (CheckTriangle(x, y, i)) {
-          ex = w[0] * vertices[elements[i].vertex[0]].ex + 
-               w[1] * vertices[elements[i].vertex[1]].ex + 
-               w[2] * vertices[elements[i].vertex[2]].ex;
-          ey = w[0] * vertices[elements[i].vertex[0]].ey + 
-               w[1] * vertices[elements[i].vertex[1]].ey + 
-               w[2] * vertices[elements[i].vertex[2]].ey;
-          p  = w[0] * vertices[elements[i].vertex[0]].p + 
-               w[1] * vertices[elements[i].vertex[1]].p + 
-               w[2] * vertices[elements[i].vertex[2]].p;               
-          if (xMirrored) ex = -ex;
-          if (yMirrored) ey = -ey;
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (!regions[elements[i].region].drift || m == 0) status = -5; 
-          return;
-        }
-        break;    
-      case 3:
-        if (CheckRectangle(x, y, i)) {
-          ex = w[0] * vertices[elements[i].vertex[0]].ex + 
-               w[1] * vertices[elements[i].vertex[1]].ex + 
-               w[2] * vertices[elements[i].vertex[2]].ex + 
-               w[3] * vertices[elements[i].vertex[3]].ex;
-          ey = w[0] * vertices[elements[i].vertex[0]].ey + 
-               w[1] * vertices[elements[i].vertex[1]].ey + 
-               w[2] * vertices[elements[i].vertex[2]].ey + 
-               w[3] * vertices[elements[i].vertex[3]].ey;
-          p  = w[0] * vertices[elements[i].vertex[0]].p + 
-               w[1] * vertices[elements[i].vertex[1]].p + 
-               w[2] * vertices[elements[i].vertex[2]].p + 
-               w[3] * vertices[elements[i].vertex[3]].p;               
-          if (xMirrored) ex = -ex;
-          if (yMirrored) ey = -ey;
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (!regions[elements[i].region].drift || m == 0) status = -5;
-          return;
-        }
-        break;
-      default:
-        std::cerr << className << "::ElectricField:\n";
-        std::cerr << "    Invalid element type (" 
-                  << elements[i].type << ").\n";
-        status = -11;
-        return;
-        break;
+      std::cerr << "    Point (" << x << ", " << y 
+                << ") is outside the mesh.\n";
     }
+    status = -6;
+    return;
   }
-  // Point is outside the mesh.
-  if (debug) {
-    std::cerr << className << "::ElectricField:\n";
-    std::cerr << "    Point (" << x << ", " << y 
-              << ") is outside the mesh.\n";
+
+  // Assume this will work.
+  status = 0;
+  const int nNodes = elements[i].type + 1;
+  for (int j = 0; j < nNodes; ++j) {
+    ex += w[j] * vertices[elements[i].vertex[j]].ex;
+    ey += w[j] * vertices[elements[i].vertex[j]].ey;
+    p  += w[j] * vertices[elements[i].vertex[j]].p;
   }
-  status = -6;
-  return;
+  if (xMirrored) ex = -ex;
+  if (yMirrored) ey = -ey;
+  m = regions[elements[i].region].medium;
+  if (!regions[elements[i].region].drift || m == 0) status = -5;
 
 }
 
@@ -379,116 +187,12 @@ ComponentTcad2d::GetMedium(
     }
   }
   
-  // Check if the point is still located in the previous element.
-  int i = lastElement;
-  switch (elements[i].type) {
-    case 1:
-      if (CheckLine(x, y, i)) {
-        m = regions[elements[i].region].medium;
-        if (m == 0) return false;
-        return true;
-      } 
-      break;
-    case 2:
-      if (CheckTriangle(x, y, i)) {
-        m = regions[elements[i].region].medium;
-        if (m == 0) return false;
-        return true;
-      }
-      break;  
-    case 3:
-      if (CheckRectangle(x, y, i)) {
-        m = regions[elements[i].region].medium;
-        if (m == 0) return false;
-        return true;
-      }
-      break;
-    default: 
-      std::cerr << className << "::GetMedium:\n";
-      std::cerr << "    Invalid element type (" 
-                << elements[i].type << ").\n";
-      return false;
-      break;
-  }
-  
-  // The point is not in the previous element.
-  // Check the adjacent elements.
-  for (int j = elements[lastElement].nNeighbours; j--;) {
-    i = elements[lastElement].neighbours[j];
-    if (x < vertices[elements[i].vertex[0]].x) continue;
-    switch (elements[i].type) {
-      case 1:
-        if (CheckLine(x, y, i)) {
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (m == 0) return false;
-          return true;
-        }
-        break;
-      case 2:
-        if (CheckTriangle(x, y, i)) {
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (m == 0) return false;
-          return true;
-        }
-        break;    
-      case 3:
-        if (CheckRectangle(x, y, i)) {
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (m == 0) return false;
-          return true;
-        }
-        break;
-      default:
-        std::cerr << className << "::GetMedium:\n";
-        std::cerr << "    Invalid element type (" 
-                  << elements[i].type << ").\n";
-        return false;
-        break;
-    }
-  }
-  
-  // The point is not in the previous element nor in the adjacent ones.
-  // We have to loop over all elements.
-  for (i = nElements; i--;) {
-    if (x < vertices[elements[i].vertex[0]].x) continue;
-    switch (elements[i].type) {
-      case 1:
-        if (CheckLine(x, y, i)) {
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (m == 0) return false;
-          return true;
-        }
-        break;
-      case 2:
-        if (CheckTriangle(x, y, i)) {
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (m == 0) return false;
-          return true;
-        }
-        break;    
-      case 3:
-        if (CheckRectangle(x, y, i)) {
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (m == 0) return false;
-          return true;
-        }
-        break;
-      default:
-        std::cerr << className << "::GetMedium:\n";
-        std::cerr << "    Invalid element type (" 
-                  << elements[i].type << ").\n";
-        return false;
-        break;
-    }
-  }
-  // The point is outside the mesh.
-  return false;
+  // Find the element which contains the point.
+  const int i = FindElement(x, y);
+  if (i < 0) return false;
+  m = regions[elements[i].region].medium;
+  if (m == 0) return false;
+  return true;
 
 }
 
@@ -545,157 +249,24 @@ ComponentTcad2d::GetMobility(
     }
   }
   
-  // Check if the point is still located in the previously found element.
-  int i = lastElement;
-  switch (elements[i].type) {
-    case 1:
-      if (CheckLine(x, y, i)) {
-        emob = w[0] * vertices[elements[i].vertex[0]].emob + 
-               w[1] * vertices[elements[i].vertex[1]].emob;
-        hmob = w[0] * vertices[elements[i].vertex[0]].hmob + 
-               w[1] * vertices[elements[i].vertex[1]].hmob;
-        return true;
-      } 
-      break;
-    case 2:
-      if (CheckTriangle(x, y, i)) {
-        emob = w[0] * vertices[elements[i].vertex[0]].emob + 
-               w[1] * vertices[elements[i].vertex[1]].emob + 
-               w[2] * vertices[elements[i].vertex[2]].emob;
-        hmob = w[0] * vertices[elements[i].vertex[0]].hmob + 
-               w[1] * vertices[elements[i].vertex[1]].hmob + 
-               w[2] * vertices[elements[i].vertex[2]].hmob;
-        return true;
-      }
-      break;  
-    case 3:
-      if (CheckRectangle(x, y, i)) {
-        emob = w[0] * vertices[elements[i].vertex[0]].emob + 
-               w[1] * vertices[elements[i].vertex[1]].emob + 
-               w[2] * vertices[elements[i].vertex[2]].emob + 
-               w[3] * vertices[elements[i].vertex[3]].emob;
-        hmob = w[0] * vertices[elements[i].vertex[0]].hmob + 
-               w[1] * vertices[elements[i].vertex[1]].hmob + 
-               w[2] * vertices[elements[i].vertex[2]].hmob + 
-               w[3] * vertices[elements[i].vertex[3]].hmob;
-        return true;
-      }
-      break;
-    default: 
+  // Find the element which contains the point.
+  const int i = FindElement(x, y);
+  if (i < 0) {
+    // Point is outside the mesh.
+    if (debug) {
       std::cerr << className << "::GetMobility:\n";
-      std::cerr << "    Unknown element type (" 
-                << elements[i].type << ").\n";
-      return false;
-      break;
-  }
-  
-  // The point is not in the previous element.
-  // Check the adjacent elements.
-  for (int j = elements[lastElement].nNeighbours; j--;) {
-    i = elements[lastElement].neighbours[j];
-    if (x < vertices[elements[i].vertex[0]].x) continue;
-    switch (elements[i].type) {
-      case 1:
-        if (CheckLine(x, y, i)) {
-          emob = w[0] * vertices[elements[i].vertex[0]].emob + 
-                 w[1] * vertices[elements[i].vertex[1]].emob;
-          hmob = w[0] * vertices[elements[i].vertex[0]].hmob + 
-                 w[1] * vertices[elements[i].vertex[1]].hmob;
-          lastElement = i;
-          return true;
-        }
-        break;
-      case 2:
-        if (CheckTriangle(x, y, i)) {
-          emob = w[0] * vertices[elements[i].vertex[0]].emob + 
-                 w[1] * vertices[elements[i].vertex[1]].emob + 
-                 w[2] * vertices[elements[i].vertex[2]].emob;
-          hmob = w[0] * vertices[elements[i].vertex[0]].hmob + 
-                 w[1] * vertices[elements[i].vertex[1]].hmob + 
-                 w[2] * vertices[elements[i].vertex[2]].hmob;
-          lastElement = i;
-          return true;
-        }
-        break;    
-      case 3:
-        if (CheckRectangle(x, y, i)) {
-          emob = w[0] * vertices[elements[i].vertex[0]].emob + 
-                 w[1] * vertices[elements[i].vertex[1]].emob + 
-                 w[2] * vertices[elements[i].vertex[2]].emob + 
-                 w[3] * vertices[elements[i].vertex[3]].emob;
-          hmob = w[0] * vertices[elements[i].vertex[0]].hmob + 
-                 w[1] * vertices[elements[i].vertex[1]].hmob + 
-                 w[2] * vertices[elements[i].vertex[2]].hmob + 
-                 w[3] * vertices[elements[i].vertex[3]].hmob;
-          lastElement = i;
-          return true;
-        }
-        break;
-      default:
-        std::cerr << className << "::GetMobility:\n";
-        std::cerr << "    Invalid element type (" 
-                  << elements[i].type << ").\n";
-        return false;
-        break;
-    }
-  }
-  
-  // The point is not in the previous element nor in the adjacent ones.
-  // We have to loop over all elements.
-  for (i = nElements; i--;) {
-    if (x < vertices[elements[i].vertex[0]].x) continue;
-    switch (elements[i].type) {
-      case 1:
-        if (CheckLine(x, y, i)) {
-          emob = w[0] * vertices[elements[i].vertex[0]].emob + 
-                 w[1] * vertices[elements[i].vertex[1]].emob;
-          hmob = w[0] * vertices[elements[i].vertex[0]].hmob + 
-                 w[1] * vertices[elements[i].vertex[1]].hmob;
-          lastElement = i;
-          return true;
-        }
-        break;
-      case 2:
-        if (CheckTriangle(x, y, i)) {
-          emob = w[0] * vertices[elements[i].vertex[0]].emob + 
-                 w[1] * vertices[elements[i].vertex[1]].emob + 
-                 w[2] * vertices[elements[i].vertex[2]].emob;
-          hmob = w[0] * vertices[elements[i].vertex[0]].hmob + 
-                 w[1] * vertices[elements[i].vertex[1]].hmob + 
-                 w[2] * vertices[elements[i].vertex[2]].hmob;
-          lastElement = i;
-          return true;
-        }
-        break;    
-      case 3:
-        if (CheckRectangle(x, y, i)) {
-          emob = w[0] * vertices[elements[i].vertex[0]].emob + 
-                 w[1] * vertices[elements[i].vertex[1]].emob + 
-                 w[2] * vertices[elements[i].vertex[2]].emob + 
-                 w[3] * vertices[elements[i].vertex[3]].emob;
-          hmob = w[0] * vertices[elements[i].vertex[0]].hmob + 
-                 w[1] * vertices[elements[i].vertex[1]].hmob + 
-                 w[2] * vertices[elements[i].vertex[2]].hmob + 
-                 w[3] * vertices[elements[i].vertex[3]].hmob;
-          lastElement = i;
-          return true;
-        }
-        break;
-      default:
-        std::cerr << className << "::GetMobility:\n";
-        std::cerr << "    Invalid element type (" 
-                  << elements[i].type << ").\n";
-        return false;
-        break;
+      std::cerr << "    Point (" << x << ", " << y 
+                << ") is outside the mesh.\n";
     }
+    return false;
   }
-  // Point is outside the mesh.
-  if (debug) {
-    std::cerr << className << "::GetMobility:\n";
-    std::cerr << "    Point (" << x << ", " << y 
-              << ") is outside the mesh.\n";
+
+  const int nNodes = elements[i].type + 1;
+  for (int j = 0; j < nNodes; ++j) {
+    emob += w[j] * vertices[elements[i].vertex[j]].emob;
+    hmob += w[j] * vertices[elements[i].vertex[j]].hmob;
   }
-  return false;
+  return true;
 
 }
  
@@ -873,15 +444,17 @@ ComponentTcad2d::Initialise(const std::string gridfilename,
   
   std::cout << "    Number of vertices: " << nVertices << "\n";
   
-  // Find adjacent elements.
-  FindNeighbours();
-  
   if (!ok) {
     ready = false;
     Cleanup();
     return false;
   }
 
+  // Find adjacent elements and set up the search grid.
+  FindNeighbours();
+  BuildSearchGrid();
+  lastElement = 0;
+
   ready = true;
   UpdatePeriodicity();
   return true;
@@ -2025,42 +1598,163 @@ ComponentTcad2d::LoadGrid(const std::string gridfilename) {
 void
 ComponentTcad2d::FindNeighbours() {
 
-
-  std::vector<std::vector<bool> > adjacent;
-  adjacent.resize(nElements);
-  for (int i = nElements; i--;) {
-    adjacent[i].resize(nElements);
-    for (int j = nElements; j--;) {
-      adjacent[i][j] = false;
+  // Make a list of the elements attached to each vertex.
+  std::vector<std::vector<int> > elementsAtVertex(nVertices);
+  for (int i = 0; i < nElements; ++i) {
+    for (int m = nMaxVertices; m--;) {
+      if (elements[i].vertex[m] < 0) continue;
+      elementsAtVertex[elements[i].vertex[m]].push_back(i);
     }
   }
-  
+
+  // Elements are adjacent if they have at least one vertex in common.
   for (int i = nElements; i--;) {
+    elements[i].neighbours.clear();
     for (int m = nMaxVertices; m--;) {
       if (elements[i].vertex[m] < 0) continue;
-      for (int j = nElements; j--;) {
-        if (i == j || adjacent[i][j]) continue;
-        for (int n = nMaxVertices; n--;) {
-          if (elements[i].vertex[m] == elements[j].vertex[n]) {
-            adjacent[i][j] = true;
-            break;
-          }
-        }
+      const std::vector<int>& attached = 
+        elementsAtVertex[elements[i].vertex[m]];
+      const int nAttached = attached.size();
+      for (int j = 0; j < nAttached; ++j) {
+        if (attached[j] != i) elements[i].neighbours.push_back(attached[j]);
       }
     }
+    std::sort(elements[i].neighbours.begin(), elements[i].neighbours.end());
+    elements[i].neighbours.erase(std::unique(elements[i].neighbours.begin(),
+                                             elements[i].neighbours.end()),
+                                 elements[i].neighbours.end());
+    elements[i].nNeighbours = elements[i].neighbours.size();
   }
   
-  for (int i = nElements; i--;) {
-    elements[i].nNeighbours = 0;
-    elements[i].neighbours.clear();
-    for (int j = nElements; j--;) {
-      if (adjacent[i][j]) {
-        elements[i].neighbours.push_back(j);
-        elements[i].nNeighbours += 1;
+}
+
+int
+ComponentTcad2d::FindElement(const double x, const double y) {
+
+  // Check if the point is still located in the previously found element.
+  int i = lastElement;
+  if (CheckElement(x, y, i)) return i;
+
+  // Check the adjacent elements.
+  for (int j = elements[lastElement].nNeighbours; j--;) {
+    i = elements[lastElement].neighbours[j];
+    if (x < vertices[elements[i].vertex[0]].x) continue;
+    if (CheckElement(x, y, i)) {
+      lastElement = i;
+      return i;
+    }
+  }
+
+  // Check the elements overlapping the search grid cell of the point.
+  const int ix = GridCoordinate(x, xMinBoundingBox, xGridStep, nGridX);
+  const int iy = GridCoordinate(y, yMinBoundingBox, yGridStep, nGridY);
+  const int cell = iy * nGridX + ix;
+  for (int k = gridStart[cell]; k < gridStart[cell + 1]; ++k) {
+    i = gridElements[k];
+    if (x < vertices[elements[i].vertex[0]].x) continue;
+    if (CheckElement(x, y, i)) {
+      lastElement = i;
+      return i;
+    }
+  }
+  // The point is outside the mesh.
+  return -1;
+
+}
+
+bool
+ComponentTcad2d::CheckElement(const double x, const double y, const int i) {
+
+  switch (elements[i].type) {
+    case 1:
+      return CheckLine(x, y, i);
+    case 2:
+      return CheckTriangle(x, y, i);
+    case 3:
+      return CheckRectangle(x, y, i);
+    default:
+      break;
+  }
+  return false;
+
+}
+
+void
+ComponentTcad2d::BuildSearchGrid() {
+
+  // Choose the cell size such that there is about one element per cell.
+  const double lx = xMaxBoundingBox - xMinBoundingBox;
+  const double ly = yMaxBoundingBox - yMinBoundingBox;
+  double area = 1.;
+  int nDim = 0;
+  if (lx > Small) { area *= lx; ++nDim; }
+  if (ly > Small) { area *= ly; ++nDim; }
+  const double h = nDim > 0 ? pow(area / nElements, 1. / nDim) : 1.;
+  const double nMax = nElements;
+  nGridX = lx > Small ? 1 + int(std::min(lx / h, nMax)) : 1;
+  nGridY = ly > Small ? 1 + int(std::min(ly / h, nMax)) : 1;
+  xGridStep = lx > Small ? lx / nGridX : 1.;
+  yGridStep = ly > Small ? ly / nGridY : 1.;
+  const int nCells = nGridX * nGridY;
+
+  // Range of cells overlapped by the bounding box of each element.
+  std::vector<int> range(4 * nElements, 0);
+  for (int i = 0; i < nElements; ++i) {
+    const int nNodes = elements[i].type + 1;
+    double x0 = vertices[elements[i].vertex[0]].x, x1 = x0;
+    double y0 = vertices[elements[i].vertex[0]].y, y1 = y0;
+    for (int j = 1; j < nNodes; ++j) {
+      const double xj = vertices[elements[i].vertex[j]].x;
+      const double yj = vertices[elements[i].vertex[j]].y;
+      if (xj < x0) x0 = xj; else if (xj > x1) x1 = xj;
+      if (yj < y0) y0 = yj; else if (yj > y1) y1 = yj;
+    }
+    range[4 * i]     = GridCoordinate(x0, xMinBoundingBox, xGridStep, nGridX);
+    range[4 * i + 1] = GridCoordinate(x1, xMinBoundingBox, xGridStep, nGridX);
+    range[4 * i + 2] = GridCoordinate(y0, yMinBoundingBox, yGridStep, nGridY);
+    range[4 * i + 3] = GridCoordinate(y1, yMinBoundingBox, yGridStep, nGridY);
+  }
+
+  // Count the elements in each cell, then fill the lists.
+  gridStart.assign(nCells + 1, 0);
+  for (int pass = 0; pass < 2; ++pass) {
+    std::vector<int> next;
+    if (pass == 1) {
+      for (int c = 0; c < nCells; ++c) gridStart[c + 1] += gridStart[c];
+      gridElements.resize(gridStart[nCells]);
+      next.assign(gridStart.begin(), gridStart.end() - 1);
+    }
+    for (int i = 0; i < nElements; ++i) {
+      for (int iy = range[4 * i + 2]; iy <= range[4 * i + 3]; ++iy) {
+        for (int ix = range[4 * i]; ix <= range[4 * i + 1]; ++ix) {
+          const int cell = iy * nGridX + ix;
+          if (pass == 0) {
+            ++gridStart[cell + 1];
+          } else {
+            gridElements[next[cell]++] = i;
+          }
+        }
       }
     }
   }
-  
+
+  if (debug) {
+    std::cout << className << "::BuildSearchGrid:\n";
+    std::cout << "    " << nGridX << " x " << nGridY << " cells, " 
+              << gridElements.size() << " entries.\n";
+  }
+
+}
+
+int
+ComponentTcad2d::GridCoordinate(const double u, const double umin,
+                                const double step, const int n) const {
+
+  const int i = int((u - umin) / step);
+  if (i < 0) return 0;
+  if (i >= n) return n - 1;
+  return i;
+
 }
 
 void 
@@ -2073,6 +1767,9 @@ ComponentTcad2d::Cleanup() {
   // Elements
   elements.clear();
   nElements = 0;
+  gridStart.clear();
+  gridElements.clear();
+  lastElement = 0;
   
   // Regions
   regions.clear();
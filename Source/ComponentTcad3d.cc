@@ -14,7 +14,9 @@ ComponentTcad3d::ComponentTcad3d() :
   ComponentBase(), 
   nRegions(0), nVertices(0), nElements(0),
   hasBoundingBox(false), 
-  lastElement(0) {
+  lastElement(0),
+  nGridX(1), nGridY(1), nGridZ(1),
+  xGridStep(1.), yGridStep(1.), zGridStep(1.) {
 
   className = "ComponentTcad3d";
     
@@ -105,139 +107,33 @@ ComponentTcad3d::ElectricField(
     return;
   }
   
-  // Assume this will work.
-  status = 0;
-  // Check if the point is still located in the previously found element.
-  int i = lastElement;
-  switch (elements[i].type) {
-    case 2:
-      if (CheckTriangle(x, y, z, i)) {
-        ex = w[0] * vertices[elements[i].vertex[0]].ex + 
-             w[1] * vertices[elements[i].vertex[1]].ex + 
-             w[2] * vertices[elements[i].vertex[2]].ex;
-        ey = w[0] * vertices[elements[i].vertex[0]].ey + 
-             w[1] * vertices[elements[i].vertex[1]].ey + 
-             w[2] * vertices[elements[i].vertex[2]].ey;
-        ez = w[0] * vertices[elements[i].vertex[0]].ez + 
-             w[1] * vertices[elements[i].vertex[1]].ez + 
-             w[2] * vertices[elements[i].vertex[2]].ez;
-        p  = w[0] * vertices[elements[i].vertex[0]].p + 
-             w[1] * vertices[elements[i].vertex[1]].p + 
-             w[2] * vertices[elements[i].vertex[2]].p;
-        if (xMirrored) ex = -ex;
-        if (yMirrored) ey = -ey;
-        if (zMirrored) ez = -ez;
-        m = regions[elements[i].region].medium;
-        if (!regions[elements[i].region].drift || m == 0) status = -5;
-        return;
-      }
-      break;  
-    case 5:
-      if (CheckTetrahedron(x, y, z, i)) {
-        ex = w[0] * vertices[elements[i].vertex[0]].ex + 
-             w[1] * vertices[elements[i].vertex[1]].ex + 
-             w[2] * vertices[elements[i].vertex[2]].ex +
-             w[3] * vertices[elements[i].vertex[3]].ex;
-        ey = w[0] * vertices[elements[i].vertex[0]].ey + 
-             w[1] * vertices[elements[i].vertex[1]].ey + 
-             w[2] * vertices[elements[i].vertex[2]].ey +
-             w[3] * vertices[elements[i].vertex[3]].ey;
-        ez = w[0] * vertices[elements[i].vertex[0]].ez + 
-             w[1] * vertices[elements[i].vertex[1]].ez + 
-             w[2] * vertices[elements[i].vertex[2]].ez +
-             w[3] * vertices[elements[i].vertex[3]].ez;
-        p  = w[0] * vertices[elements[i].vertex[0]].p + 
-             w[1] * vertices[elements[i].vertex[1]].p + 
-             w[2] * vertices[elements[i].vertex[2]].p +
-             w[3] * vertices[elements[i].vertex[3]].p;
-        if (xMirrored) ex = -ex;
-        if (yMirrored) ey = -ey;
-        if (zMirrored) ez = -ez;
-        m = regions[elements[i].region].medium;
-        if (!regions[elements[i].region].drift || m == 0) status = -5;
-        return;
-      }
-      break;  
-    default: 
+  // Find the element which contains the point.
+  const int i = FindElement(x, y, z);
+  if (i < 0) {
+    // Point is outside the mesh.
+    if (debug) {
       std::cerr << className << "::ElectricField:\n";
-      std::cerr << "    Unknown element type (" 
-                << elements[i].type << ").\n";
-      status = -11;
-      return;
-      break;
-  }
-  
-  // The point is not in the previous element.
-  // We have to loop over all elements.
-  for (i = nElements; i--;) {
-    switch (elements[i].type) {
-      case 2:
-        if (CheckTriangle(x, y, z, i)) {
-          ex = w[0] * vertices[elements[i].vertex[0]].ex + 
-               w[1] * vertices[elements[i].vertex[1]].ex + 
-               w[2] * vertices[elements[i].vertex[2]].ex;
-          ey = w[0] * vertices[elements[i].vertex[0]].ey + 
-               w[1] * vertices[elements[i].vertex[1]].ey + 
-               w[2] * vertices[elements[i].vertex[2]].ey;
-          ez = w[0] * vertices[elements[i].vertex[0]].ez + 
-               w[1] * vertices[elements[i].vertex[1]].ez + 
-               w[2] * vertices[elements[i].vertex[2]].ez;
-          p  = w[0] * vertices[elements[i].vertex[0]].p + 
-               w[1] * vertices[elements[i].vertex[1]].p + 
-               w[2] * vertices[elements[i].vertex[2]].p;
-          if (xMirrored) ex = -ex;
-          if (yMirrored) ey = -ey;
-          if (zMirrored) ez = -ez;
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (!regions[elements[i].region].drift || m == 0) status = -5; 
-          return;
-        }
-        break;    
-      case 5:
-        if (CheckTetrahedron(x, y, z, i)) {
-          ex = w[0] * vertices[elements[i].vertex[0]].ex + 
-               w[1] * vertices[elements[i].vertex[1]].ex + 
-               w[2] * vertices[elements[i].vertex[2]].ex +
-               w[3] * vertices[elements[i].vertex[3]].ex;
-          ey = w[0] * vertices[elements[i].vertex[0]].ey + 
-               w[1] * vertices[elements[i].vertex[1]].ey + 
-               w[2] * vertices[elements[i].vertex[2]].ey +
-               w[3] * vertices[elements[i].vertex[3]].ey;
-          ez = w[0] * vertices[elements[i].vertex[0]].ez + 
-               w[1] * vertices[elements[i].vertex[1]].ez + 
-               w[2] * vertices[elements[i].vertex[2]].ez +
-               w[3] * vertices[elements[i].vertex[3]].ez;
-          p  = w[0] * vertices[elements[i].vertex[0]].p + 
-               w[1] * vertices[elements[i].vertex[1]].p +
-               w[2] * vertices[elements[i].vertex[2]].p +
-               w[3] * vertices[elements[i].vertex[3]].p;               
-          if (xMirrored) ex = -ex;
-          if (yMirrored) ey = -ey;
-          if (zMirrored) ez = -ez;
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (!regions[elements[i].region].drift || m == 0) status = -5; 
-          return;
-        }
-        break;
-      default:
-        std::cerr << className << "::ElectricField:\n";
-        std::cerr << "    Invalid element type (" 
-                  << elements[i].type << ").\n";
-        status = -11;
-        return;
-        break;
+      std::cerr << "    Point (" << x << ", " << y << ", " << z
+                << ") is outside the mesh.\n";
     }
+    status = -6;
+    return;
   }
-  // Point is outside the mesh.
-  if (debug) {
-    std::cerr << className << "::ElectricField:\n";
-    std::cerr << "    Point (" << x << ", " << y << ", " << z
-              << ") is outside the mesh.\n";
-  }
-  status = -6;
-  return;
+
+  // Assume this will work.
+  status = 0;
+  const int nNodes = elements[i].type == 2 ? 3 : 4;
+  for (int j = 0; j < nNodes; ++j) {
+    ex += w[j] * vertices[elements[i].vertex[j]].ex;
+    ey += w[j] * vertices[elements[i].vertex[j]].ey;
+    ez += w[j] * vertices[elements[i].vertex[j]].ez;
+    p  += w[j] * vertices[elements[i].vertex[j]].p;
+  }
+  if (xMirrored) ex = -ex;
+  if (yMirrored) ey = -ey;
+  if (zMirrored) ez = -ez;
+  m = regions[elements[i].region].medium;
+  if (!regions[elements[i].region].drift || m == 0) status = -5;
 
 }
 
@@ -313,61 +209,12 @@ ComponentTcad3d::GetMedium(
     return false;
   }
   
-  // Check if the point is still located in the previous element.
-  int i = lastElement;
-  switch (elements[i].type) {
-    case 2:
-      if (CheckTriangle(x, y, z, i)) {
-        m = regions[elements[i].region].medium;
-        if (m == 0) return false;
-        return true;
-      }
-      break;  
-    case 5:
-      if (CheckTetrahedron(x, y, z, i)) {
-        m = regions[elements[i].region].medium;
-        if (m == 0) return false;
-        return true;
-      }
-      break;  
-    default: 
-      std::cerr << className << "::GetMedium:\n";
-      std::cerr << "    Invalid element type (" 
-                << elements[i].type << ").\n";
-      return false;
-      break;
-  }
-  
-  // The point is not in the previous element.
-  // We have to loop over all elements.
-  for (i = nElements; i--;) {
-    switch (elements[i].type) {
-      case 2:
-        if (CheckTriangle(x, y, z, i)) {
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (m == 0) return false;
-          return true;
-        }
-        break;
-      case 5:
-        if (CheckTetrahedron(x, y, z, i)) {
-          lastElement = i;
-          m = regions[elements[i].region].medium;
-          if (m == 0) return false;
-          return true;
-        }
-        break;
-      default:
-        std::cerr << className << "::GetMedium:\n";
-        std::cerr << "    Invalid element type (" 
-                  << elements[i].type << ").\n";
-        return false;
-        break;
-    }
-  }
-  // The point is outside the mesh.
-  return false;
+  // Find the element which contains the point.
+  const int i = FindElement(x, y, z);
+  if (i < 0) return false;
+  m = regions[elements[i].region].medium;
+  if (m == 0) return false;
+  return true;
 
 }
  
@@ -559,6 +406,11 @@ ComponentTcad3d::Initialise(const std::string gridfilename,
     Cleanup();
     return false;
   }
+
+  // Find adjacent elements and set up the search grid.
+  FindNeighbours();
+  BuildSearchGrid();
+  lastElement = 0;
   
   ready = true;
   UpdatePeriodicity();
@@ -1645,6 +1497,10 @@ ComponentTcad3d::Cleanup() {
   // Elements
   elements.clear();
   nElements = 0;
+  neighbours.clear();
+  gridStart.clear();
+  gridElements.clear();
+  lastElement = 0;
   
   // Regions
   regions.clear();
@@ -1652,6 +1508,198 @@ ComponentTcad3d::Cleanup() {
   
 }
 
+int
+ComponentTcad3d::FindElement(const double x, const double y, const double z) {
+
+  // Check if the point is still located in the previously found element.
+  int i = lastElement;
+  if (CheckElement(x, y, z, i)) return i;
+
+  // Walk from the previous element towards the point, each time crossing
+  // the face opposite to the vertex with a negative weighting factor.
+  const int nMaxSteps = 50;
+  for (int k = 0; k < nMaxSteps && elements[i].type == 5; ++k) {
+    // CheckTetrahedron stops at the first negative weighting factor.
+    int j = 0;
+    while (j < 3 && w[j] >= 0.) ++j;
+    i = neighbours[4 * i + j];
+    // Boundary of the mesh
+    if (i < 0) break;
+    if (CheckElement(x, y, z, i)) {
+      lastElement = i;
+      return i;
+    }
+  }
+
+  // Check the elements overlapping the search grid cell of the point.
+  const int ix = GridCoordinate(x, xMinBoundingBox, xGridStep, nGridX);
+  const int iy = GridCoordinate(y, yMinBoundingBox, yGridStep, nGridY);
+  const int iz = GridCoordinate(z, zMinBoundingBox, zGridStep, nGridZ);
+  const int cell = (iz * nGridY + iy) * nGridX + ix;
+  for (int k = gridStart[cell]; k < gridStart[cell + 1]; ++k) {
+    i = gridElements[k];
+    if (CheckElement(x, y, z, i)) {
+      lastElement = i;
+      return i;
+    }
+  }
+  // The point is outside the mesh.
+  return -1;
+
+}
+
+bool
+ComponentTcad3d::CheckElement(const double x, const double y, const double z,
+                              const int i) {
+
+  switch (elements[i].type) {
+    case 2:
+      return CheckTriangle(x, y, z, i);
+    case 5:
+      return CheckTetrahedron(x, y, z, i);
+    default:
+      break;
+  }
+  return false;
+
+}
+
+void
+ComponentTcad3d::FindNeighbours() {
+
+  neighbours.assign(4 * nElements, -1);
+
+  // Make a list of the tetrahedra attached to each vertex.
+  std::vector<std::vector<int> > elementsAtVertex(nVertices);
+  for (int i = 0; i < nElements; ++i) {
+    if (elements[i].type != 5) continue;
+    for (int k = 0; k < 4; ++k) {
+      elementsAtVertex[elements[i].vertex[k]].push_back(i);
+    }
+  }
+
+  for (int i = 0; i < nElements; ++i) {
+    if (elements[i].type != 5) continue;
+    for (int k = 0; k < 4; ++k) {
+      if (neighbours[4 * i + k] >= 0) continue;
+      // Vertices of the face opposite to vertex k
+      const int v0 = elements[i].vertex[(k + 1) % 4];
+      const int v1 = elements[i].vertex[(k + 2) % 4];
+      const int v2 = elements[i].vertex[(k + 3) % 4];
+      const std::vector<int>& candidates = elementsAtVertex[v0];
+      const int nCandidates = candidates.size();
+      for (int l = 0; l < nCandidates; ++l) {
+        const int j = candidates[l];
+        if (j == i) continue;
+        // Find the vertex of the other tetrahedron which is not on the face.
+        int nShared = 0, kj = 0;
+        for (int n = 0; n < 4; ++n) {
+          const int vn = elements[j].vertex[n];
+          if (vn == v0 || vn == v1 || vn == v2) {
+            ++nShared;
+          } else {
+            kj = n;
+          }
+        }
+        if (nShared != 3) continue;
+        neighbours[4 * i + k] = j;
+        neighbours[4 * j + kj] = i;
+        break;
+      }
+    }
+  }
+
+}
+
+void
+ComponentTcad3d::BuildSearchGrid() {
+
+  // Choose the cell size such that there is about one element per cell.
+  const double lx = xMaxBoundingBox - xMinBoundingBox;
+  const double ly = yMaxBoundingBox - yMinBoundingBox;
+  const double lz = zMaxBoundingBox - zMinBoundingBox;
+  double vol = 1.;
+  int nDim = 0;
+  if (lx > Small) { vol *= lx; ++nDim; }
+  if (ly > Small) { vol *= ly; ++nDim; }
+  if (lz > Small) { vol *= lz; ++nDim; }
+  const double h = nDim > 0 ? pow(vol / nElements, 1. / nDim) : 1.;
+  const double nMax = nElements;
+  nGridX = lx > Small ? 1 + int(std::min(lx / h, nMax)) : 1;
+  nGridY = ly > Small ? 1 + int(std::min(ly / h, nMax)) : 1;
+  nGridZ = lz > Small ? 1 + int(std::min(lz / h, nMax)) : 1;
+  xGridStep = lx > Small ? lx / nGridX : 1.;
+  yGridStep = ly > Small ? ly / nGridY : 1.;
+  zGridStep = lz > Small ? lz / nGridZ : 1.;
+  const int nCells = nGridX * nGridY * nGridZ;
+
+  // Range of cells overlapped by the bounding box of each element.
+  std::vector<int> range(6 * nElements, 0);
+  for (int i = 0; i < nElements; ++i) {
+    const int nNodes = elements[i].type == 2 ? 3 : 4;
+    double x0 = vertices[elements[i].vertex[0]].x, x1 = x0;
+    double y0 = vertices[elements[i].vertex[0]].y, y1 = y0;
+    double z0 = vertices[elements[i].vertex[0]].z, z1 = z0;
+    for (int j = 1; j < nNodes; ++j) {
+      const double xj = vertices[elements[i].vertex[j]].x;
+      const double yj = vertices[elements[i].vertex[j]].y;
+      const double zj = vertices[elements[i].vertex[j]].z;
+      if (xj < x0) x0 = xj; else if (xj > x1) x1 = xj;
+      if (yj < y0) y0 = yj; else if (yj > y1) y1 = yj;
+      if (zj < z0) z0 = zj; else if (zj > z1) z1 = zj;
+    }
+    range[6 * i]     = GridCoordinate(x0, xMinBoundingBox, xGridStep, nGridX);
+    range[6 * i + 1] = GridCoordinate(x1, xMinBoundingBox, xGridStep, nGridX);
+    range[6 * i + 2] = GridCoordinate(y0, yMinBoundingBox, yGridStep, nGridY);
+    range[6 * i + 3] = GridCoordinate(y1, yMinBoundingBox, yGridStep, nGridY);
+    range[6 * i + 4] = GridCoordinate(z0, zMinBoundingBox, zGridStep, nGridZ);
+    range[6 * i + 5] = GridCoordinate(z1, zMinBoundingBox, zGridStep, nGridZ);
+  }
+
+  // Count the elements in each cell, then fill the lists.
+  gridStart.assign(nCells + 1, 0);
+  for (int pass = 0; pass < 2; ++pass) {
+    std::vector<int> next;
+    if (pass == 1) {
+      for (int c = 0; c < nCells; ++c) gridStart[c + 1] += gridStart[c];
+      gridElements.resize(gridStart[nCells]);
+      next.assign(gridStart.begin(), gridStart.end() - 1);
+    }
+    for (int i = 0; i < nElements; ++i) {
+      for (int iz = range[6 * i + 4]; iz <= range[6 * i + 5]; ++iz) {
+        for (int iy = range[6 * i + 2]; iy <= range[6 * i + 3]; ++iy) {
+          for (int ix = range[6 * i]; ix <= range[6 * i + 1]; ++ix) {
+            const int cell = (iz * nGridY + iy) * nGridX + ix;
+            if (pass == 0) {
+              ++gridStart[cell + 1];
+            } else {
+              gridElements[next[cell]++] = i;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  if (debug) {
+    std::cout << className << "::BuildSearchGrid:\n";
+    std::cout << "    " << nGridX << " x " << nGridY << " x " << nGridZ
+              << " cells, " << gridElements.size() << " entries.\n";
+  }
+
+}
+
+int
+ComponentTcad3d::GridCoordinate(const double u, const double umin,
+                                const double step, const int n) const {
+
+  const int i = int((u - umin) / step);
+  if (i < 0) return 0;
+  if (i >= n) return n - 1;
+  return i;
+
+}
+
 bool
 ComponentTcad3d::CheckTetrahedron(const double x, const double y, 
                                   const double z, const int i) {
@@ -0,0 +1,90 @@
+#include <iostream>
+
+#include "DriftLinePool.hh"
+
+namespace Garfield {
+
+DriftLinePool::DriftLinePool() :
+  nBlocks(0), nLines(0) {
+
+}
+
+void
+DriftLinePool::Clear() {
+
+  // Keep the allocated blocks and line records for the next event.
+  nBlocks = 0;
+  nLines = 0;
+
+}
+
+int
+DriftLinePool::NewLine() {
+
+  if (nLines < (int)lines.size()) {
+    // Reuse the record (and the memory of its block list).
+    lines[nLines].blocks.clear();
+    lines[nLines].n = 0;
+  } else {
+    line newLine;
+    newLine.n = 0;
+    lines.push_back(newLine);
+  }
+  return nLines++;
+
+}
+
+int
+DriftLinePool::NewBlock() {
+
+  const int n = (nBlocks + 1) * nBlockSize;
+  if (n > (int)xp.size()) {
+    xp.resize(n); yp.resize(n); zp.resize(n); tp.resize(n);
+  }
+  return nBlocks++;
+
+}
+
+void
+DriftLinePool::AddPoint(const int i, const double x, const double y,
+                        const double z, const double t) {
+
+  if (i < 0 || i >= nLines) {
+    std::cerr << "DriftLinePool::AddPoint:\n";
+    std::cerr << "    Drift line index (" << i << ") out of range.\n";
+    return;
+  }
+  line& l = lines[i];
+  const int k = l.n % nBlockSize;
+  if (k == 0) {
+    // The last block is full (or there is none yet).
+    l.blocks.push_back(NewBlock());
+  }
+  const int j = l.blocks.back() * nBlockSize + k;
+  xp[j] = x; yp[j] = y; zp[j] = z; tp[j] = t;
+  ++l.n;
+
+}
+
+int
+DriftLinePool::GetNumberOfPoints(const int i) const {
+
+  if (i < 0 || i >= nLines) return 0;
+  return lines[i].n;
+
+}
+
+bool
+DriftLinePool::GetPoint(const int i, const int ip,
+                        double& x, double& y, double& z, double& t) const {
+
+  if (i < 0 || i >= nLines) return false;
+  const line& l = lines[i];
+  if (ip < 0 || ip >= l.n) return false;
+  const int j = l.blocks[ip / nBlockSize] * nBlockSize + ip % nBlockSize;
+  x = xp[j]; y = yp[j]; z = zp[j]; t = tp[j];
+  return true;
+
+}
+
+}
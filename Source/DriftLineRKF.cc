@@ -12,7 +12,8 @@ DriftLineRKF::DriftLineRKF() :
   maxStepSize(1.e8), intAccuracy(1.e-8), 
   maxSteps(1000), 
   usePlotting(false), viewer(0), 
-  debug(false), verbose(false) {
+  debug(false), verbose(false),
+  lastMeanTime(0.), lastRmsTime(0.), lastGain(1.) {
   
   className = "DriftLineRKF";
   path.clear();
@@ -76,34 +77,46 @@ DriftLineRKF::DisablePlotting() {
 
 }
 
-void
+bool
 DriftLineRKF::DriftElectron(const double x0, const double y0, const double z0,
                             const double t0) {
                             
-  double meanTime = 0.; double rmsTime = 0.; 
-  DriftLine(x0, y0, z0, t0, meanTime, rmsTime, "electron");
+  lastMeanTime = lastRmsTime = 0.;
+  lastGain = 1.;
+  if (!DriftLine(x0, y0, z0, t0, lastMeanTime, lastRmsTime, "electron")) {
+    return false;
+  }
+  return true;
 
 }
 
-void
+bool
 DriftLineRKF::DriftHole(const double x0, const double y0, const double z0,
                         const double t0) {
                             
-  double meanTime = 0.; double rmsTime = 0.; 
-  DriftLine(x0, y0, z0, t0, meanTime, rmsTime, "hole");
+  lastMeanTime = lastRmsTime = 0.;
+  lastGain = 1.;
+  if (!DriftLine(x0, y0, z0, t0, lastMeanTime, lastRmsTime, "hole")) {
+    return false;
+  }
+  return true;
 
 }
 
-void
+bool
 DriftLineRKF::DriftIon(const double x0, const double y0, const double z0,
                        const double t0) {
                             
-  double meanTime = 0.; double rmsTime = 0.; 
-  DriftLine(x0, y0, z0, t0, meanTime, rmsTime, "ion");
+  lastMeanTime = lastRmsTime = 0.;
+  lastGain = 1.;
+  if (!DriftLine(x0, y0, z0, t0, lastMeanTime, lastRmsTime, "ion")) {
+    return false;
+  }
+  return true;
 
 }
 
-void 
+bool 
 DriftLineRKF::DriftLine(double x0, double y0, double z0, double t0,
                         double& meanTime, double& rmsTime, std::string particleType) {
 
@@ -115,7 +128,7 @@ DriftLineRKF::DriftLine(double x0, double y0, double z0, double t0,
   if (!sensor) {
     std::cerr << className << "::DriftLine:\n";
     std::cerr << "    Sensor is not defined.\n";
-    return;
+    return false;
   }
   
   // Check to make sure initial position is in a 
@@ -130,7 +143,7 @@ DriftLineRKF::DriftLine(double x0, double y0, double z0, double t0,
   if (status != 0) {
     std::cerr << className << "::DriftLine:\n";
     std::cerr << "    No valid field at initial position.\n";
-    return;
+    return false;
   }
 
   // Numerical constants for RKF integration
@@ -169,19 +182,19 @@ DriftLineRKF::DriftLine(double x0, double y0, double z0, double t0,
     if (!medium->ElectronVelocity(ex, ey, ez, bx, by, bz, v0[0], v0[1], v0[2])) {
       std::cerr << className << "::DriftLine:\n";
       std::cerr << "    Failed to retrieve drift velocity.\n";
-      return;
+      return false;
     }
   } else if (particleType == "hole") {
     if (!medium->HoleVelocity(ex, ey, ez, bx, by, bz, v0[0], v0[1], v0[2])) {
       std::cerr << className << "::DriftLine:\n";
       std::cerr << "    Failed to retrieve drift velocity.\n";
-      return;
+      return false;
     }
   } else if (particleType == "ion") {
     if (!medium->IonVelocity(ex, ey, ez, bx, by, bz, v0[0], v0[1], v0[2])) {
       std::cerr << className << "::DriftLine:\n";
       std::cerr << "    Failed to retrieve drift velocity.\n";
-      return;
+      return false;
     }
   }
   double vTot = sqrt(v0[0] * v0[0] + v0[1] * v0[1] + v0[2] * v0[2]);
@@ -227,19 +240,19 @@ DriftLineRKF::DriftLine(double x0, double y0, double z0, double t0,
           if (!medium->ElectronVelocity(ex, ey, ez, bx, by, bz, v1[0], v1[1], v1[2])) {
             std::cerr << className << "::DriftLine:\n";
             std::cerr << "    Failed to retrieve drift velocity.\n";
-            return;
+            return false;
           }
         } else if (particleType == "hole") {
           if (!medium->HoleVelocity(ex, ey, ez, bx, by, bz, v1[0], v1[1], v1[2])) {
             std::cerr << className << "::DriftLine:\n";
             std::cerr << "    Failed to retrieve drift velocity.\n";
-            return;
+            return false;
           }
         } else if (particleType == "ion") {
           if (!medium->IonVelocity(ex, ey, ez, bx, by, bz, v1[0], v1[1], v1[2])) {
             std::cerr << className << "::DriftLine:\n";
             std::cerr << "    Failed to retrieve drift velocity.\n";
-            return;
+            return false;
           }
         }
       }
@@ -269,19 +282,19 @@ DriftLineRKF::DriftLine(double x0, double y0, double z0, double t0,
           if (!medium->ElectronVelocity(ex, ey, ez, bx, by, bz, v2[0], v2[1], v2[2])) {
             std::cerr << className << "::DriftLine:\n";
             std::cerr << "    Failed to retrieve drift velocity.\n";
-            return;
+            return false;
           }
         } else if (particleType == "hole") {
           if (!medium->HoleVelocity(ex, ey, ez, bx, by, bz, v2[0], v2[1], v2[2])) {
             std::cerr << className << "::DriftLine:\n";
             std::cerr << "    Failed to retrieve drift velocity.\n";
-            return;
+            return false;
           }
         } else if (particleType == "ion") {
           if (!medium->IonVelocity(ex, ey, ez, bx, by, bz, v2[0], v2[1], v2[2])) {
             std::cerr << className << "::DriftLine:\n";
             std::cerr << "    Failed to retrieve drift velocity.\n";
-            return;
+            return false;
           }
         }
       }     
@@ -311,19 +324,19 @@ DriftLineRKF::DriftLine(double x0, double y0, double z0, double t0,
           if (!medium->ElectronVelocity(ex, ey, ez, bx, by, bz, v3[0], v3[1], v3[2])) {
             std::cerr << className << "::DriftLine:\n";
             std::cerr << "    Failed to retrieve drift velocity.\n";
-            return;
+            return false;
           }
         } else if (particleType == "hole") {
           if (!medium->HoleVelocity(ex, ey, ez, bx, by, bz, v3[0], v3[1], v3[2])) {
             std::cerr << className << "::DriftLine:\n";
             std::cerr << "    Failed to retrieve drift velocity.\n";
-            return;
+            return false;
           }
         } else if (particleType == "ion") {
           if (!medium->IonVelocity(ex, ey, ez, bx, by, bz, v3[0], v3[1], v3[2])) {
             std::cerr << className << "::DriftLine:\n";
             std::cerr << "    Failed to retrieve drift velocity.\n";
-            return;
+            return false;
           }
         }
       }
@@ -396,7 +409,7 @@ DriftLineRKF::DriftLine(double x0, double y0, double z0, double t0,
       std::cerr << className << "::DriftLine:\n";
       std::cerr << "    Step size is zero (program bug).\n";
       std::cerr << "    The calculation is abandoned.\n";
-      return;
+      return false;
     }
    
     // Prevent step size growing to fast
@@ -410,7 +423,7 @@ DriftLineRKF::DriftLine(double x0, double y0, double z0, double t0,
         std::cerr << className << "::DriftLine:\n";
         std::cerr << "    Step size has become smaller than int. accuracy.\n";
         std::cerr << "    The calculation is abandoned.\n";
-        return;
+        return false;
       }
     }
 
@@ -474,6 +487,10 @@ DriftLineRKF::DriftLine(double x0, double y0, double z0, double t0,
   rmsTime = sqrt(rmsTime);
   meanTime = path.back().tf;
 
+  // Multiplication (Townsend minus attachment) along the drift line
+  if (particleType != "ion") lastGain = IntegrateTownsend(particleType);
+  return true;
+
 }
 
 void
@@ -975,11 +992,59 @@ DriftLineRKF::IntegrateDiffusion(const double x, const double y, const double z,
     //getchar()
   }
   const double totalStep = sqrt(pow(x - xe, 2) + pow(y - ye, 2) + pow(z - ze, 2));
-  std::cout << "DLrms = " << dLrms << " Acquired over " << totalStep << " [cm] in  " << stepCounter << " steps.\n";
+  if (debug) {
+    std::cout << "DLrms = " << dLrms << " Acquired over " << totalStep << " [cm] in  " << stepCounter << " steps.\n";
+  }
   return dLrms;
 
 }  
 
+void
+DriftLineRKF::GetDriftTime(double& meanTime, double& rmsTime) const {
+
+  meanTime = lastMeanTime;
+  rmsTime = lastRmsTime;
+
+}
+
+double 
+DriftLineRKF::IntegrateTownsend(const std::string particleType) {
+
+  // Evaluate alpha - eta at the mid-point of each step 
+  // and sum up over the step lengths.
+  double sum = 0.;
+  double ex, ey, ez;
+  double bx, by, bz;
+  int status;
+  const int nSteps = path.size();
+  for (int i = 0; i < nSteps; ++i) {
+    const double x = 0.5 * (path[i].xi + path[i].xf);
+    const double y = 0.5 * (path[i].yi + path[i].yf);
+    const double z = 0.5 * (path[i].zi + path[i].zf);
+    sensor->MagneticField(x, y, z, bx, by, bz, status);
+    sensor->ElectricField(x, y, z, ex, ey, ez, medium, status);
+    if (status != 0 || !medium) continue;
+    double alpha = 0., eta = 0.;
+    if (particleType == "electron") {
+      if (!medium->ElectronTownsend(ex, ey, ez, bx, by, bz, alpha)) alpha = 0.;
+      if (!medium->ElectronAttachment(ex, ey, ez, bx, by, bz, eta)) eta = 0.;
+    } else if (particleType == "hole") {
+      if (!medium->HoleTownsend(ex, ey, ez, bx, by, bz, alpha)) alpha = 0.;
+      if (!medium->HoleAttachment(ex, ey, ez, bx, by, bz, eta)) eta = 0.;
+    }
+    const double ds = sqrt(pow(path[i].xf - path[i].xi, 2) + 
+                           pow(path[i].yf - path[i].yi, 2) + 
+                           pow(path[i].zf - path[i].zi, 2));
+    sum += (alpha - eta) * ds;
+  }
+  if (debug) {
+    std::cout << className << "::IntegrateTownsend:\n";
+    std::cout << "    Integral of alpha - eta: " << sum << "\n";
+  }
+  return exp(sum);
+
+}
+
 void 
 DriftLineRKF::EndDriftLine(const std::string particleType) {
 
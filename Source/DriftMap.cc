@@ -0,0 +1,472 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+
+#include "DriftMap.hh"
+#include "GarfieldConstants.hh"
+#include "Random.hh"
+
+namespace Garfield {
+
+// Identifier and format version at the start of a map file
+const char mapFileTag[8] = {'G', 'D', 'R', 'F', 'T', 'M', 'A', 'P'};
+const int mapFileVersion = 1;
+
+DriftMap::DriftMap() :
+  ready(false), particle("electron"),
+  is3d(false),
+  nX(0), nY(0), nZ(0),
+  xMin(0.), yMin(0.), zMin(0.),
+  xMax(0.), yMax(0.), zMax(0.),
+  dX(0.), dY(0.), dZ(0.),
+  nRefine(1),
+  debug(false) {
+
+  className = "DriftMap";
+
+}
+
+void
+DriftMap::Clear() {
+
+  ready = false;
+  labels.clear();
+  nodes.clear();
+  fineIndex.clear();
+  fineNodes.clear();
+  nX = nY = nZ = 0;
+
+}
+
+bool
+DriftMap::Initialise(const bool threeD,
+                     const double x0, const double y0, const double z0,
+                     const double x1, const double y1, const double z1,
+                     const int nx, const int ny, const int nz,
+                     const int nr, const std::string type) {
+
+  Clear();
+  if (nx <= 0 || ny <= 0 || (threeD && nz <= 0) || nr <= 0) {
+    std::cerr << className << "::Initialise:\n";
+    std::cerr << "    Invalid number of cells.\n";
+    return false;
+  }
+  if (x1 - x0 < Small || y1 - y0 < Small || (threeD && z1 - z0 < Small)) {
+    std::cerr << className << "::Initialise:\n";
+    std::cerr << "    Invalid range.\n";
+    return false;
+  }
+
+  is3d = threeD;
+  nX = nx; nY = ny; nZ = is3d ? nz : 0;
+  xMin = x0; yMin = y0; zMin = z0;
+  xMax = x1; yMax = y1; zMax = is3d ? z1 : z0;
+  dX = (xMax - xMin) / nX;
+  dY = (yMax - yMin) / nY;
+  dZ = is3d ? (zMax - zMin) / nZ : 0.;
+  nRefine = nr;
+  particle = type;
+
+  node empty;
+  empty.t = empty.rms = 0.;
+  empty.gain = 1.;
+  empty.electrode = -1;
+  empty.status = 0;
+  nodes.assign((nX + 1) * (nY + 1) * (nZ + 1), empty);
+  fineIndex.assign(nX * nY * (is3d ? nZ : 1), -1);
+  ready = true;
+  return true;
+
+}
+
+bool
+DriftMap::HasSameGrid(const DriftMap& other) const {
+
+  if (is3d != other.is3d) return false;
+  if (nX != other.nX || nY != other.nY || nZ != other.nZ) return false;
+  if (nRefine != other.nRefine) return false;
+  if (fabs(xMin - other.xMin) > BoundaryDistance ||
+      fabs(yMin - other.yMin) > BoundaryDistance ||
+      fabs(zMin - other.zMin) > BoundaryDistance ||
+      fabs(xMax - other.xMax) > BoundaryDistance ||
+      fabs(yMax - other.yMax) > BoundaryDistance ||
+      fabs(zMax - other.zMax) > BoundaryDistance) return false;
+  if (particle != other.particle) return false;
+  if (labels != other.labels) return false;
+  return true;
+
+}
+
+bool
+DriftMap::Merge(const DriftMap& other) {
+
+  if (!other.ready) {
+    std::cerr << className << "::Merge:\n";
+    std::cerr << "    Map to be added is empty.\n";
+    return false;
+  }
+  if (!ready) {
+    *this = other;
+    return true;
+  }
+  if (!HasSameGrid(other)) {
+    std::cerr << className << "::Merge:\n";
+    std::cerr << "    Maps have different grids.\n";
+    return false;
+  }
+
+  const int nNodes = nodes.size();
+  for (int i = 0; i < nNodes; ++i) {
+    if (nodes[i].status == 0 && other.nodes[i].status != 0) {
+      nodes[i] = other.nodes[i];
+    }
+  }
+  const int nCells = fineIndex.size();
+  const int nFine = GetNumberOfFineNodesPerCell();
+  for (int i = 0; i < nCells; ++i) {
+    const int k = other.fineIndex[i];
+    if (k < 0) continue;
+    if (fineIndex[i] < 0) {
+      fineIndex[i] = fineNodes.size();
+      fineNodes.insert(fineNodes.end(),
+                       other.fineNodes.begin() + k,
+                       other.fineNodes.begin() + k + nFine);
+      continue;
+    }
+    for (int j = 0; j < nFine; ++j) {
+      if (fineNodes[fineIndex[i] + j].status == 0) {
+        fineNodes[fineIndex[i] + j] = other.fineNodes[k + j];
+      }
+    }
+  }
+  return true;
+
+}
+
+bool
+DriftMap::IsComplete() const {
+
+  if (!ready) return false;
+  const int nNodes = nodes.size();
+  for (int i = nNodes; i--;) {
+    if (nodes[i].status == 0) return false;
+  }
+  const int nFineNodes = fineNodes.size();
+  for (int i = nFineNodes; i--;) {
+    if (fineNodes[i].status == 0) return false;
+  }
+  return true;
+
+}
+
+int
+DriftMap::GetNumberOfRefinedCells() const {
+
+  int n = 0;
+  const int nCells = fineIndex.size();
+  for (int i = nCells; i--;) {
+    if (fineIndex[i] >= 0) ++n;
+  }
+  return n;
+
+}
+
+bool
+DriftMap::GetArea(double& xmin, double& ymin, double& zmin,
+                  double& xmax, double& ymax, double& zmax) const {
+
+  if (!ready) return false;
+  xmin = xMin; ymin = yMin; zmin = zMin;
+  xmax = xMax; ymax = yMax; zmax = zMax;
+  return true;
+
+}
+
+bool
+DriftMap::GetElectrode(const int i, std::string& label) const {
+
+  if (i < 0 || i >= (int)labels.size()) {
+    std::cerr << className << "::GetElectrode:\n";
+    std::cerr << "    Electrode " << i << " does not exist.\n";
+    return false;
+  }
+  label = labels[i];
+  return true;
+
+}
+
+bool
+DriftMap::Evaluate(const double x, const double y, const double z,
+                   double& t, double& rms, double& gain, int& electrode) {
+
+  t = rms = 0.;
+  gain = 1.;
+  electrode = -1;
+  if (!ready) {
+    std::cerr << className << "::Evaluate:\n";
+    std::cerr << "    Map is not initialised.\n";
+    return false;
+  }
+
+  if (x < xMin || x > xMax || y < yMin || y > yMax) return false;
+  if (is3d && (z < zMin || z > zMax)) return false;
+
+  // Find the coarse cell and the local coordinates within it.
+  double u = (x - xMin) / dX;
+  double v = (y - yMin) / dY;
+  double w = is3d ? (z - zMin) / dZ : 0.;
+  int ix = int(u); if (ix >= nX) ix = nX - 1;
+  int iy = int(v); if (iy >= nY) iy = nY - 1;
+  int iz = int(w); if (is3d && iz >= nZ) iz = nZ - 1;
+  u -= ix; v -= iy; w -= iz;
+
+  const int nCorners = is3d ? 8 : 4;
+  const node* corners[8];
+  const int offset = fineIndex[CellIndex(ix, iy, iz)];
+  if (offset < 0) {
+    for (int i = nCorners; i--;) {
+      corners[i] = &nodes[NodeIndex(ix + (i & 1), iy + ((i >> 1) & 1),
+                                    iz + ((i >> 2) & 1))];
+    }
+  } else {
+    // Refined cell: find the sub-cell.
+    u *= nRefine; v *= nRefine; w *= nRefine;
+    int jx = int(u); if (jx >= nRefine) jx = nRefine - 1;
+    int jy = int(v); if (jy >= nRefine) jy = nRefine - 1;
+    int jz = int(w); if (is3d && jz >= nRefine) jz = nRefine - 1;
+    u -= jx; v -= jy; w -= jz;
+    for (int i = nCorners; i--;) {
+      corners[i] = &fineNodes[FineNodeIndex(offset,
+                                            jx + (i & 1), jy + ((i >> 1) & 1),
+                                            jz + ((i >> 2) & 1))];
+    }
+  }
+
+  // Interpolate over the corners with valid drift lines.
+  double sum = 0.;
+  double wMax = -1.;
+  for (int i = nCorners; i--;) {
+    if (corners[i]->status != 1) continue;
+    double f = ((i & 1) ? u : 1. - u) * (((i >> 1) & 1) ? v : 1. - v);
+    if (is3d) f *= ((i >> 2) & 1) ? w : 1. - w;
+    sum += f;
+    t += f * corners[i]->t;
+    rms += f * corners[i]->rms;
+    if (f > wMax) {
+      wMax = f;
+      electrode = corners[i]->electrode;
+    }
+  }
+  if (sum < Small) {
+    t = rms = 0.;
+    electrode = -1;
+    if (debug) {
+      std::cerr << className << "::Evaluate:\n";
+      std::cerr << "    No valid nodes around ("
+                << x << ", " << y << ", " << z << ").\n";
+    }
+    return false;
+  }
+  t /= sum;
+  rms /= sum;
+  // Interpolate the gain logarithmically.
+  double logGain = 0.;
+  for (int i = nCorners; i--;) {
+    if (corners[i]->status != 1) continue;
+    double f = ((i & 1) ? u : 1. - u) * (((i >> 1) & 1) ? v : 1. - v);
+    if (is3d) f *= ((i >> 2) & 1) ? w : 1. - w;
+    if (corners[i]->gain > 0.) logGain += f * log(corners[i]->gain);
+  }
+  gain = exp(logGain / sum);
+  return true;
+
+}
+
+bool
+DriftMap::Drift(const double x, const double y, const double z,
+                const double t0, double& t1, int& electrode) {
+
+  t1 = t0;
+  double t = 0., rms = 0., gain = 1.;
+  if (!Evaluate(x, y, z, t, rms, gain, electrode)) return false;
+  t1 = t0 + RndmGaussian(t, rms);
+  if (t1 < t0) t1 = t0;
+  return true;
+
+}
+
+bool
+DriftMap::Save(const std::string filename) const {
+
+  if (!ready) {
+    std::cerr << className << "::Save:\n";
+    std::cerr << "    Map is not initialised.\n";
+    return false;
+  }
+
+  std::ofstream outfile;
+  outfile.open(filename.c_str(), std::ios::out | std::ios::binary);
+  if (outfile.fail()) {
+    std::cerr << className << "::Save:\n";
+    std::cerr << "    Could not open file " << filename << ".\n";
+    return false;
+  }
+
+  outfile.write(mapFileTag, sizeof(mapFileTag));
+  outfile.write((const char*)&mapFileVersion, sizeof(int));
+  const int dims[5] = {is3d ? 1 : 0, nX, nY, nZ, nRefine};
+  outfile.write((const char*)dims, sizeof(dims));
+  const double bounds[6] = {xMin, yMin, zMin, xMax, yMax, zMax};
+  outfile.write((const char*)bounds, sizeof(bounds));
+  // Particle type and electrode labels
+  int n = particle.size();
+  outfile.write((const char*)&n, sizeof(int));
+  outfile.write(particle.data(), n);
+  const int nLabels = labels.size();
+  outfile.write((const char*)&nLabels, sizeof(int));
+  for (int i = 0; i < nLabels; ++i) {
+    n = labels[i].size();
+    outfile.write((const char*)&n, sizeof(int));
+    outfile.write(labels[i].data(), n);
+  }
+  // Coarse nodes, refinement offsets and refined nodes
+  const int nNodes = nodes.size();
+  outfile.write((const char*)&nNodes, sizeof(int));
+  outfile.write((const char*)&nodes[0], nNodes * sizeof(node));
+  const int nCells = fineIndex.size();
+  outfile.write((const char*)&nCells, sizeof(int));
+  outfile.write((const char*)&fineIndex[0], nCells * sizeof(int));
+  const int nFineNodes = fineNodes.size();
+  outfile.write((const char*)&nFineNodes, sizeof(int));
+  if (nFineNodes > 0) {
+    outfile.write((const char*)&fineNodes[0], nFineNodes * sizeof(node));
+  }
+  if (outfile.fail()) {
+    std::cerr << className << "::Save:\n";
+    std::cerr << "    Error writing file " << filename << ".\n";
+    outfile.close();
+    return false;
+  }
+  outfile.close();
+  if (debug) {
+    std::cout << className << "::Save:\n";
+    std::cout << "    Wrote " << nNodes + nFineNodes << " nodes to file "
+              << filename << ".\n";
+  }
+  return true;
+
+}
+
+bool
+DriftMap::Load(const std::string filename) {
+
+  std::ifstream infile;
+  infile.open(filename.c_str(), std::ios::in | std::ios::binary);
+  if (infile.fail()) {
+    std::cerr << className << "::Load:\n";
+    std::cerr << "    Could not open file " << filename << ".\n";
+    return false;
+  }
+
+  Clear();
+  char tag[8];
+  int version = 0;
+  infile.read(tag, sizeof(tag));
+  infile.read((char*)&version, sizeof(int));
+  bool ok = !infile.fail() && version == mapFileVersion;
+  for (int i = 8; i--;) {
+    if (tag[i] != mapFileTag[i]) ok = false;
+  }
+  if (!ok) {
+    std::cerr << className << "::Load:\n";
+    std::cerr << "    " << filename << " is not a drift map file"
+              << " or has an unsupported version.\n";
+    infile.close();
+    return false;
+  }
+
+  int dims[5];
+  double bounds[6];
+  infile.read((char*)dims, sizeof(dims));
+  infile.read((char*)bounds, sizeof(bounds));
+  int n = 0;
+  infile.read((char*)&n, sizeof(int));
+  if (infile.fail() || n < 0 || n > 256) ok = false;
+  std::string type = "";
+  if (ok) {
+    type.resize(n);
+    if (n > 0) infile.read(&type[0], n);
+  }
+  if (!ok ||
+      !Initialise(dims[0] != 0, bounds[0], bounds[1], bounds[2],
+                  bounds[3], bounds[4], bounds[5],
+                  dims[1], dims[2], dims[3], dims[4], type)) {
+    std::cerr << className << "::Load:\n";
+    std::cerr << "    Invalid header in file " << filename << ".\n";
+    infile.close();
+    Clear();
+    return false;
+  }
+
+  int nLabels = 0;
+  infile.read((char*)&nLabels, sizeof(int));
+  for (int i = 0; i < nLabels && !infile.fail(); ++i) {
+    infile.read((char*)&n, sizeof(int));
+    if (n < 0 || n > 256) break;
+    std::string label(n, ' ');
+    if (n > 0) infile.read(&label[0], n);
+    labels.push_back(label);
+  }
+
+  int nNodes = 0, nCells = 0, nFineNodes = 0;
+  infile.read((char*)&nNodes, sizeof(int));
+  if (nNodes == (int)nodes.size()) {
+    infile.read((char*)&nodes[0], nNodes * sizeof(node));
+  }
+  infile.read((char*)&nCells, sizeof(int));
+  if (nCells == (int)fineIndex.size()) {
+    infile.read((char*)&fineIndex[0], nCells * sizeof(int));
+  }
+  infile.read((char*)&nFineNodes, sizeof(int));
+  if (nFineNodes >= 0 &&
+      nFineNodes % GetNumberOfFineNodesPerCell() == 0) {
+    fineNodes.resize(nFineNodes);
+    if (nFineNodes > 0) {
+      infile.read((char*)&fineNodes[0], nFineNodes * sizeof(node));
+    }
+  }
+  if (infile.fail() || (int)labels.size() != nLabels ||
+      nNodes != (int)nodes.size() || nCells != (int)fineIndex.size() ||
+      nFineNodes != (int)fineNodes.size()) {
+    std::cerr << className << "::Load:\n";
+    std::cerr << "    Error reading file " << filename << ".\n";
+    infile.close();
+    Clear();
+    return false;
+  }
+  infile.close();
+
+  // Check the refinement offsets.
+  for (int i = nCells; i--;) {
+    if (fineIndex[i] < 0) continue;
+    if (fineIndex[i] + GetNumberOfFineNodesPerCell() > nFineNodes) {
+      std::cerr << className << "::Load:\n";
+      std::cerr << "    Corrupt refinement table in file "
+                << filename << ".\n";
+      Clear();
+      return false;
+    }
+  }
+
+  std::cout << className << "::Load:\n";
+  std::cout << "    Read " << nNodes + nFineNodes << " nodes ("
+            << GetNumberOfRefinedCells() << " refined cells) from file "
+            << filename << ".\n";
+  if (!IsComplete()) {
+    std::cout << "    Warning: the map is incomplete.\n";
+  }
+  return true;
+
+}
+
+}
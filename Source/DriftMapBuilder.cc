@@ -0,0 +1,347 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "DriftMapBuilder.hh"
+#include "GarfieldConstants.hh"
+
+namespace Garfield {
+
+DriftMapBuilder::DriftMapBuilder() :
+  sensor(0),
+  hasArea(false), is3d(false),
+  xMin(0.), yMin(0.), zMin(0.),
+  xMax(0.), yMax(0.), zMax(0.),
+  nX(10), nY(10), nZ(0),
+  useRefinement(true), nRefine(4), tolerance(0.05),
+  particle("electron"),
+  iJob(0), nJobs(1),
+  nDriftLines(0),
+  debug(false) {
+
+  className = "DriftMapBuilder";
+  labels.clear();
+
+}
+
+void
+DriftMapBuilder::SetSensor(Sensor* s) {
+
+  if (!s) {
+    std::cerr << className << "::SetSensor:\n";
+    std::cerr << "    Sensor pointer is null.\n";
+    return;
+  }
+  sensor = s;
+  drift.SetSensor(s);
+
+}
+
+void
+DriftMapBuilder::SetArea(const double xmin, const double ymin,
+                         const double xmax, const double ymax,
+                         const double z) {
+
+  if (fabs(xmax - xmin) < Small || fabs(ymax - ymin) < Small) {
+    std::cerr << className << "::SetArea:\n";
+    std::cerr << "    Invalid range.\n";
+    return;
+  }
+  xMin = std::min(xmin, xmax); xMax = std::max(xmin, xmax);
+  yMin = std::min(ymin, ymax); yMax = std::max(ymin, ymax);
+  zMin = zMax = z;
+  is3d = false;
+  hasArea = true;
+
+}
+
+void
+DriftMapBuilder::SetArea(const double xmin, const double ymin,
+                         const double zmin,
+                         const double xmax, const double ymax,
+                         const double zmax) {
+
+  if (fabs(xmax - xmin) < Small ||
+      fabs(ymax - ymin) < Small ||
+      fabs(zmax - zmin) < Small) {
+    std::cerr << className << "::SetArea:\n";
+    std::cerr << "    Invalid range.\n";
+    return;
+  }
+  xMin = std::min(xmin, xmax); xMax = std::max(xmin, xmax);
+  yMin = std::min(ymin, ymax); yMax = std::max(ymin, ymax);
+  zMin = std::min(zmin, zmax); zMax = std::max(zmin, zmax);
+  is3d = true;
+  hasArea = true;
+
+}
+
+void
+DriftMapBuilder::SetGrid(const int nx, const int ny, const int nz) {
+
+  if (nx <= 0 || ny <= 0 || nz < 0) {
+    std::cerr << className << "::SetGrid:\n";
+    std::cerr << "    Number of cells must be greater than zero.\n";
+    return;
+  }
+  nX = nx; nY = ny; nZ = nz;
+
+}
+
+void
+DriftMapBuilder::SetRefinement(const int n, const double tol) {
+
+  if (n < 2 || tol <= 0.) {
+    std::cerr << className << "::SetRefinement:\n";
+    std::cerr << "    Number of sub-cells must be at least 2"
+              << " and tolerance must be greater than zero.\n";
+    return;
+  }
+  nRefine = n;
+  tolerance = tol;
+  useRefinement = true;
+
+}
+
+void
+DriftMapBuilder::SetParticleType(const std::string type) {
+
+  if (type != "electron" && type != "hole" && type != "ion") {
+    std::cerr << className << "::SetParticleType:\n";
+    std::cerr << "    Unknown particle type " << type << ".\n";
+    return;
+  }
+  particle = type;
+
+}
+
+void
+DriftMapBuilder::SetJob(const int job, const int n) {
+
+  if (n <= 0 || job < 0 || job >= n) {
+    std::cerr << className << "::SetJob:\n";
+    std::cerr << "    Invalid job number.\n";
+    return;
+  }
+  iJob = job;
+  nJobs = n;
+
+}
+
+bool
+DriftMapBuilder::Build(DriftMap& map) {
+
+  if (!sensor) {
+    std::cerr << className << "::Build:\n";
+    std::cerr << "    Sensor is not defined.\n";
+    return false;
+  }
+  if (!hasArea) {
+    std::cerr << className << "::Build:\n";
+    std::cerr << "    Area is not defined.\n";
+    return false;
+  }
+  if (is3d && nZ <= 0) {
+    std::cerr << className << "::Build:\n";
+    std::cerr << "    Number of cells in z is not set.\n";
+    return false;
+  }
+
+  // Get the electrode labels.
+  labels.clear();
+  const int nElectrodes = sensor->GetNumberOfElectrodes();
+  for (int i = 0; i < nElectrodes; ++i) {
+    std::string label;
+    if (!sensor->GetElectrode(i, label)) continue;
+    bool found = false;
+    for (int j = labels.size(); j--;) {
+      if (labels[j] == label) found = true;
+    }
+    if (!found) labels.push_back(label);
+  }
+
+  // Set up the grid, unless the map has been (partially) computed
+  // on the same grid before, in which case only missing nodes are added.
+  DriftMap grid;
+  if (!grid.Initialise(is3d, xMin, yMin, zMin, xMax, yMax, zMax,
+                       nX, nY, nZ, useRefinement ? nRefine : 1, particle)) {
+    return false;
+  }
+  grid.labels = labels;
+  if (!map.ready || !map.HasSameGrid(grid)) map = grid;
+  map.debug = debug;
+
+  // Range of coarse cells to be computed in this job.
+  const int ix0 = (iJob * nX) / nJobs;
+  const int ix1 = ((iJob + 1) * nX) / nJobs;
+  const int nz = is3d ? nZ : 0;
+
+  std::cout << className << "::Build:\n";
+  std::cout << "    Computing " << particle << " drift lines for "
+            << ix1 - ix0 << " x " << nY << " x " << (is3d ? nZ : 1)
+            << " cells (job " << iJob << " of " << nJobs << ").\n";
+
+  nDriftLines = 0;
+  for (int ix = ix0; ix <= ix1; ++ix) {
+    const double x = xMin + ix * map.dX;
+    for (int iy = 0; iy <= nY; ++iy) {
+      const double y = yMin + iy * map.dY;
+      for (int iz = 0; iz <= nz; ++iz) {
+        const double z = zMin + iz * map.dZ;
+        DriftMap::node& n = map.nodes[map.NodeIndex(ix, iy, iz)];
+        if (n.status != 0) continue;
+        ComputeNode(x, y, z, n);
+      }
+    }
+    if (debug) {
+      std::cout << className << "::Build:\n";
+      std::cout << "    Finished slice " << ix << " of " << nX << ".\n";
+    }
+  }
+
+  int nRefined = 0;
+  if (useRefinement) {
+    for (int ix = ix0; ix < ix1; ++ix) {
+      for (int iy = 0; iy < nY; ++iy) {
+        for (int iz = 0; iz < (is3d ? nZ : 1); ++iz) {
+          if (map.fineIndex[map.CellIndex(ix, iy, iz)] >= 0) continue;
+          if (!NeedsRefinement(map, ix, iy, iz)) continue;
+          RefineCell(map, ix, iy, iz);
+          ++nRefined;
+        }
+      }
+    }
+  }
+
+  std::cout << className << "::Build:\n";
+  std::cout << "    Computed " << nDriftLines << " drift lines, refined "
+            << nRefined << " cells.\n";
+  return true;
+
+}
+
+void
+DriftMapBuilder::ComputeNode(const double x, const double y, const double z,
+                             DriftMap::node& n) {
+
+  n.t = n.rms = 0.;
+  n.gain = 1.;
+  n.electrode = -1;
+  n.status = -1;
+  ++nDriftLines;
+
+  bool ok = false;
+  if (particle == "electron") {
+    ok = drift.DriftElectron(x, y, z, 0.);
+  } else if (particle == "hole") {
+    ok = drift.DriftHole(x, y, z, 0.);
+  } else {
+    ok = drift.DriftIon(x, y, z, 0.);
+  }
+  if (!ok) return;
+
+  double xe = 0., ye = 0., ze = 0., te = 0.;
+  std::string status = "";
+  drift.GetEndPoint(xe, ye, ze, te, status);
+  if (status != "left volume" && status != "Drifted to wire.") {
+    if (debug) {
+      std::cerr << className << "::ComputeNode:\n";
+      std::cerr << "    Drift line from (" << x << ", " << y << ", " << z
+                << ") ended with status \"" << status << "\".\n";
+    }
+    return;
+  }
+
+  double meanTime = 0., rmsTime = 0.;
+  drift.GetDriftTime(meanTime, rmsTime);
+  n.t = meanTime;
+  n.rms = rmsTime;
+  n.gain = drift.GetGain();
+
+  // The drift line ends on the electrode with the largest
+  // weighting potential at the end point.
+  double wMax = 0.5;
+  const int nLabels = labels.size();
+  for (int i = 0; i < nLabels; ++i) {
+    const double w = sensor->WeightingPotential(xe, ye, ze, labels[i]);
+    if (w > wMax) {
+      wMax = w;
+      n.electrode = i;
+    }
+  }
+  n.status = 1;
+
+}
+
+bool
+DriftMapBuilder::NeedsRefinement(const DriftMap& map,
+                                 const int ix, const int iy,
+                                 const int iz) const {
+
+  const int nCorners = is3d ? 8 : 4;
+  int nValid = 0;
+  int electrode = -1;
+  double tMin = 0., tMax = 0.;
+  for (int i = 0; i < nCorners; ++i) {
+    const DriftMap::node& n = map.nodes[map.NodeIndex(ix + (i & 1),
+                                                      iy + ((i >> 1) & 1),
+                                                      iz + ((i >> 2) & 1))];
+    if (n.status != 1) continue;
+    if (nValid == 0) {
+      electrode = n.electrode;
+      tMin = tMax = n.t;
+    } else {
+      // Drift lines ending on different electrodes
+      if (n.electrode != electrode) return true;
+      if (n.t < tMin) tMin = n.t;
+      if (n.t > tMax) tMax = n.t;
+    }
+    ++nValid;
+  }
+  // Boundary of the region where drift lines can be computed
+  if (nValid > 0 && nValid < nCorners) return true;
+  if (nValid == 0) return false;
+  return tMax - tMin > tolerance * 0.5 * (tMax + tMin);
+
+}
+
+void
+DriftMapBuilder::RefineCell(DriftMap& map,
+                            const int ix, const int iy, const int iz) {
+
+  const int offset = map.fineNodes.size();
+  DriftMap::node empty;
+  empty.t = empty.rms = 0.;
+  empty.gain = 1.;
+  empty.electrode = -1;
+  empty.status = 0;
+  map.fineNodes.resize(offset + map.GetNumberOfFineNodesPerCell(), empty);
+  map.fineIndex[map.CellIndex(ix, iy, iz)] = offset;
+
+  const double dx = map.dX / nRefine;
+  const double dy = map.dY / nRefine;
+  const double dz = map.dZ / nRefine;
+  const int nz = is3d ? nRefine : 0;
+  for (int jx = 0; jx <= nRefine; ++jx) {
+    const double x = xMin + ix * map.dX + jx * dx;
+    for (int jy = 0; jy <= nRefine; ++jy) {
+      const double y = yMin + iy * map.dY + jy * dy;
+      for (int jz = 0; jz <= nz; ++jz) {
+        const double z = zMin + iz * map.dZ + jz * dz;
+        DriftMap::node& n = map.fineNodes[map.FineNodeIndex(offset,
+                                                            jx, jy, jz)];
+        // Re-use the nodes of the coarse grid.
+        if (jx % nRefine == 0 && jy % nRefine == 0 &&
+            (!is3d || jz % nRefine == 0)) {
+          n = map.nodes[map.NodeIndex(ix + jx / nRefine, iy + jy / nRefine,
+                                      iz + jz / nRefine)];
+          continue;
+        }
+        ComputeNode(x, y, z, n);
+      }
+    }
+  }
+
+}
+
+}
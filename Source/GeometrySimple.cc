@@ -5,6 +5,7 @@ namespace Garfield {
 
 GeometrySimple::GeometrySimple() :
   nMedia(0), nSolids(0),
+  useSearchTree(true), hasSearchTree(false), lastSolid(-1),
   hasBoundingBox(false),
   debug(false) {
   
@@ -77,6 +78,7 @@ GeometrySimple::AddSolid(Solid* s, Medium* m) {
   newSolid.medium = n;
   solids.push_back(newSolid);
   ++nSolids;    
+  hasSearchTree = false;
 
 }
 
@@ -84,13 +86,10 @@ bool
 GeometrySimple::GetSolid(const double x, const double y, const double z, 
                          Solid*& s) {
                              
-  for (int i = nSolids; i--;) {
-    if (solids[i].solid->IsInside(x, y, z)) {
-      s = solids[i].solid;
-      return true;
-    }
-  }
-  return false;
+  const int i = FindSolid(x, y, z);
+  if (i < 0) return false;
+  s = solids[i].solid;
+  return true;
   
 }
 
@@ -98,14 +97,11 @@ bool
 GeometrySimple::GetMedium(const double x, const double y, const double z, 
                           Medium*& m) {
                
-  for (int i = nSolids; i--;) {
-    if (solids[i].solid->IsInside(x, y, z)) {
-      if (solids[i].medium < 0) return false;
-      m = media[solids[i].medium].medium;
-      return true;
-    }
-  }
-  return false;
+  const int i = FindSolid(x, y, z);
+  if (i < 0) return false;
+  if (solids[i].medium < 0) return false;
+  m = media[solids[i].medium].medium;
+  return true;
                
 }
 
@@ -144,6 +140,9 @@ GeometrySimple::Clear() {
   solids.clear();
   nMedia = 0;
   nSolids = 0;
+  searchTree.Clear();
+  hasSearchTree = false;
+  lastSolid = -1;
 
 }
 
@@ -177,10 +176,7 @@ GeometrySimple::IsInside(const double x, const double y, const double z) {
 
   if (!IsInBoundingBox(x, y, z)) return false;
   
-  for (int i = nSolids; i--;) {
-    if (solids[i].solid->IsInside(x, y, z)) return true;
-  }
-  return false;
+  return FindSolid(x, y, z) >= 0;
 
 }
 
@@ -203,4 +199,57 @@ GeometrySimple::IsInBoundingBox(
 
 }
 
+int
+GeometrySimple::FindSolid(const double x, const double y, const double z) {
+
+  if (!useSearchTree) {
+    for (int i = nSolids; i--;) {
+      if (solids[i].solid->IsInside(x, y, z)) return i;
+    }
+    return -1;
+  }
+
+  if (!hasSearchTree) BuildSearchTree();
+  // Where solids overlap, the one added last takes precedence.
+  // Start from the solid found in the previous call and check only
+  // the solids added after it whose bounding box contains the point.
+  int found = -1;
+  if (lastSolid >= 0 && lastSolid < nSolids &&
+      solids[lastSolid].solid->IsInside(x, y, z)) {
+    found = lastSolid;
+  }
+  searchTree.FindBoxes(x, y, z, candidates, found);
+  const int nCandidates = candidates.size();
+  for (int j = 0; j < nCandidates; ++j) {
+    const int i = candidates[j];
+    if (solids[i].solid->IsInside(x, y, z)) {
+      found = i;
+      break;
+    }
+  }
+  if (found >= 0) lastSolid = found;
+  return found;
+
+}
+
+void
+GeometrySimple::BuildSearchTree() {
+
+  searchTree.Clear();
+  double xmin, ymin, zmin;
+  double xmax, ymax, zmax;
+  for (int i = 0; i < nSolids; ++i) {
+    solids[i].solid->GetBoundingBox(xmin, ymin, zmin, xmax, ymax, zmax);
+    searchTree.AddBox(i, xmin, ymin, zmin, xmax, ymax, zmax);
+  }
+  searchTree.Build();
+  hasSearchTree = true;
+  lastSolid = -1;
+  if (debug) {
+    std::cout << className << "::BuildSearchTree:\n";
+    std::cout << "    Search tree over " << nSolids << " solids.\n";
+  }
+
+}
+
 }
@@ -0,0 +1,227 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+
+#include "RecombinationStatistics.hh"
+#include "GarfieldConstants.hh"
+
+namespace Garfield {
+
+RecombinationStatistics::RecombinationStatistics() :
+  nTimeBins(100), tBinWidth(0.1),
+  nDistanceBins(100), dBinWidth(1.e-6) {
+
+  className = "RecombinationStatistics";
+  Reset();
+
+}
+
+void
+RecombinationStatistics::SetTimeHistogram(const int nBins, const double tmax) {
+
+  if (nBins <= 0 || tmax <= 0.) {
+    std::cerr << className << "::SetTimeHistogram:\n";
+    std::cerr << "    Number of bins and range must be greater than zero.\n";
+    return;
+  }
+  nTimeBins = nBins;
+  tBinWidth = tmax / nBins;
+  Reset();
+
+}
+
+void
+RecombinationStatistics::SetDistanceHistogram(const int nBins,
+                                              const double rmax) {
+
+  if (nBins <= 0 || rmax <= 0.) {
+    std::cerr << className << "::SetDistanceHistogram:\n";
+    std::cerr << "    Number of bins and range must be greater than zero.\n";
+    return;
+  }
+  nDistanceBins = nBins;
+  dBinWidth = rmax / nBins;
+  Reset();
+
+}
+
+void
+RecombinationStatistics::Reset() {
+
+  nClouds = 0;
+  nTotal = 0;
+  nRecombined = nAttached = nTimedOut = nLeftMedium = nEscaped = nOther = 0;
+  nTotalCloud = nRecombinedCloud = 0;
+  fMean = fM2 = 0.;
+  tMean = tM2 = 0.;
+  dMean = dM2 = 0.;
+  nDistance = 0;
+  timeHistogram.assign(nTimeBins, 0);
+  distanceHistogramRecombined.assign(nDistanceBins, 0);
+  distanceHistogramOther.assign(nDistanceBins, 0);
+
+}
+
+void
+RecombinationStatistics::BeginCloud() {
+
+  nTotalCloud = nRecombinedCloud = 0;
+
+}
+
+void
+RecombinationStatistics::Fill(const int status,
+                              const double t, const double d) {
+
+  ++nTotal;
+  ++nTotalCloud;
+  const bool recombined = status == StatusRecombined;
+  if (recombined) {
+    ++nRecombined;
+    ++nRecombinedCloud;
+    Update(t, nRecombined, tMean, tM2);
+    const int bin = std::min(int(std::max(t, 0.) / tBinWidth), nTimeBins - 1);
+    ++timeHistogram[bin];
+  } else if (status == StatusAttached) {
+    ++nAttached;
+  } else if (status == StatusOutsideTimeWindow) {
+    ++nTimedOut;
+  } else if (status == StatusLeftDriftMedium) {
+    ++nLeftMedium;
+  } else if (status == StatusEscaped) {
+    ++nEscaped;
+  } else {
+    ++nOther;
+  }
+
+  ++nDistance;
+  Update(d, nDistance, dMean, dM2);
+  const int bin = std::min(int(std::max(d, 0.) / dBinWidth), nDistanceBins - 1);
+  if (recombined) {
+    ++distanceHistogramRecombined[bin];
+  } else {
+    ++distanceHistogramOther[bin];
+  }
+
+}
+
+void
+RecombinationStatistics::EndCloud() {
+
+  if (nTotalCloud <= 0) return;
+  ++nClouds;
+  Update(double(nRecombinedCloud) / nTotalCloud, nClouds, fMean, fM2);
+
+}
+
+double
+RecombinationStatistics::GetRecombinationFraction() const {
+
+  if (nTotal <= 0) return 0.;
+  return double(nRecombined) / nTotal;
+
+}
+
+double
+RecombinationStatistics::GetRecombinationFractionError() const {
+
+  if (nTotal <= 0) return 0.;
+  const double f = GetRecombinationFraction();
+  return sqrt(f * (1. - f) / nTotal);
+
+}
+
+double
+RecombinationStatistics::GetRmsCloudRecombinationFraction() const {
+
+  if (nClouds < 2) return 0.;
+  return sqrt(fM2 / (nClouds - 1));
+
+}
+
+double
+RecombinationStatistics::GetRmsRecombinationTime() const {
+
+  if (nRecombined < 2) return 0.;
+  return sqrt(tM2 / (nRecombined - 1));
+
+}
+
+double
+RecombinationStatistics::GetRmsDistance() const {
+
+  if (nDistance < 2) return 0.;
+  return sqrt(dM2 / (nDistance - 1));
+
+}
+
+int
+RecombinationStatistics::GetTimeBinContent(const int i) const {
+
+  if (i < 0 || i >= nTimeBins) return 0;
+  return timeHistogram[i];
+
+}
+
+int
+RecombinationStatistics::GetDistanceBinContent(const int i,
+                                               const bool recombined) const {
+
+  if (i < 0 || i >= nDistanceBins) return 0;
+  return recombined ? distanceHistogramRecombined[i] :
+                      distanceHistogramOther[i];
+
+}
+
+bool
+RecombinationStatistics::WriteSummary(const std::string& filename) const {
+
+  std::ofstream outfile(filename.c_str(), std::ios::out);
+  if (!outfile) {
+    std::cerr << className << "::WriteSummary:\n";
+    std::cerr << "    Could not open file " << filename << ".\n";
+    return false;
+  }
+  outfile.precision(8);
+  outfile << "# Recombination statistics\n";
+  outfile << "clouds " << nClouds << "\n";
+  outfile << "electrons " << nTotal << "\n";
+  outfile << "recombined " << nRecombined << "\n";
+  outfile << "attached " << nAttached << "\n";
+  outfile << "timeout " << nTimedOut << "\n";
+  outfile << "leftmedium " << nLeftMedium << "\n";
+  outfile << "escaped " << nEscaped << "\n";
+  outfile << "other " << nOther << "\n";
+  outfile << "fraction " << GetRecombinationFraction() << " "
+          << GetRecombinationFractionError() << "\n";
+  outfile << "cloudfraction " << fMean << " "
+          << GetRmsCloudRecombinationFraction() << "\n";
+  outfile << "time " << tMean << " " << GetRmsRecombinationTime() << "\n";
+  outfile << "distance " << dMean << " " << GetRmsDistance() << "\n";
+  outfile << "# Recombination time: lower bin edge [ns], entries\n";
+  for (int i = 0; i < nTimeBins; ++i) {
+    outfile << i * tBinWidth << " " << timeHistogram[i] << "\n";
+  }
+  outfile << "# Largest distance to an ion: lower bin edge [cm],"
+          << " recombined, not recombined\n";
+  for (int i = 0; i < nDistanceBins; ++i) {
+    outfile << i * dBinWidth << " " << distanceHistogramRecombined[i]
+            << " " << distanceHistogramOther[i] << "\n";
+  }
+  outfile.close();
+  return true;
+
+}
+
+void
+RecombinationStatistics::Update(const double x, const int n,
+                                double& mean, double& m2) {
+
+  const double delta = x - mean;
+  mean += delta / n;
+  m2 += delta * (x - mean);
+
+}
+
+}
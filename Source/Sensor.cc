@@ -1,6 +1,8 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <algorithm>
+#include <functional>
 
 #include "Sensor.hh"
 #include "GarfieldConstants.hh"
@@ -14,6 +16,7 @@ double Sensor::signalConversion = ElementaryCharge;
 
 Sensor::Sensor() :
   nComponents(0), lastComponent(-1), 
+  useSearchTree(false), hasSearchTree(false),
   nElectrodes(0),
   nTimeBins(200), tStart(0.), tStep(10.),
   nEvents(0),
@@ -101,6 +104,16 @@ Sensor::MagneticField(const double x, const double y, const double z,
 
 }
 
+bool
+Sensor::HasUniformMagneticField() {
+
+  for (int i = nComponents; i--;) {
+    if (!components[i].comp->HasUniformMagneticField()) return false;
+  }
+  return true;
+
+}
+
 void 
 Sensor::WeightingField(const double x, const double y, const double z, 
                        double& wx, double& wy, double& wz, 
@@ -149,6 +162,28 @@ Sensor::GetMedium(const double x, const double y, const double z,
     if (m) return true;
   }
 
+  if (useSearchTree) {
+    if (!hasSearchTree) BuildSearchTree();
+    // Try the components whose bounding box contains the point.
+    searchTree.FindBoxes(x, y, z, candidates);
+    candidates.insert(candidates.end(), 
+                      unboundedComponents.begin(), unboundedComponents.end());
+    std::sort(candidates.begin(), candidates.end(), std::greater<int>());
+    const int nCandidates = candidates.size();
+    for (int j = 0; j < nCandidates; ++j) {
+      const int i = candidates[j];
+      if (i == lastComponent) continue;
+      if (components[i].comp->GetMedium(x, y, z, m)) {
+        if (m) {
+          lastComponent = i;
+          return true;
+        }
+      }
+    }
+    m = 0;
+    return false;
+  }
+
   for (int i = nComponents; i--;) {
     if (components[i].comp->GetMedium(x, y, z, m)) {
       // Cross-check that the medium is defined.
@@ -316,6 +351,7 @@ Sensor::AddComponent(ComponentBase* comp) {
   components.push_back(newComponent);
   ++nComponents; 
   if (nComponents == 1) lastComponent = 0; 
+  hasSearchTree = false;
 
 }
 
@@ -353,12 +389,28 @@ Sensor::AddElectrode(ComponentBase* comp, std::string label) {
 
 }
 
+bool 
+Sensor::GetElectrode(const int i, std::string& label) {
+
+  if (i < 0 || i >= nElectrodes) {
+    std::cerr << className << "::GetElectrode:\n";
+    std::cerr << "    Electrode " << i << " does not exist.\n";
+    return false;
+  }
+  label = electrodes[i].label;
+  return true;
+
+}
+
 void 
 Sensor::Clear() {
 
   components.clear();
   nComponents = 0;
   lastComponent = -1;
+  searchTree.Clear();
+  unboundedComponents.clear();
+  hasSearchTree = false;
   electrodes.clear();
   nElectrodes = 0;
   nTimeBins = 200;
@@ -998,4 +1050,30 @@ Sensor::GetBoundingBox(double& xmin, double& ymin, double& zmin,
   
 }
   
+void
+Sensor::BuildSearchTree() {
+
+  searchTree.Clear();
+  unboundedComponents.clear();
+  double xmin, ymin, zmin;
+  double xmax, ymax, zmax;
+  for (int i = nComponents; i--;) {
+    if (components[i].comp->GetBoundingBox(xmin, ymin, zmin,
+                                           xmax, ymax, zmax)) {
+      searchTree.AddBox(i, xmin, ymin, zmin, xmax, ymax, zmax);
+    } else {
+      unboundedComponents.push_back(i);
+    }
+  }
+  searchTree.Build();
+  hasSearchTree = true;
+  if (debug) {
+    std::cout << className << "::BuildSearchTree:\n";
+    std::cout << "    " << searchTree.GetNumberOfBoxes() 
+              << " components with bounding box, "
+              << unboundedComponents.size() << " without.\n";
+  }
+
+}
+
 }
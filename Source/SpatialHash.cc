@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+#include "SpatialHash.hh"
+#include "GarfieldConstants.hh"
+
+namespace Garfield {
+
+SpatialHash::SpatialHash() :
+  cellSize(0.), cell(1.), nBuckets(1) {
+
+  Clear();
+
+}
+
+void
+SpatialHash::Clear() {
+
+  xp.clear(); yp.clear(); zp.clear();
+  nBuckets = 1;
+  bucketStart.assign(2, 0);
+  entries.clear();
+
+}
+
+void
+SpatialHash::Build(const std::vector<double>& x, const std::vector<double>& y,
+                   const std::vector<double>& z) {
+
+  xp = x; yp = y; zp = z;
+  const int nPoints = xp.size();
+  if (nPoints <= 0 || yp.size() != xp.size() || zp.size() != xp.size()) {
+    Clear();
+    return;
+  }
+
+  cell = cellSize;
+  if (cell <= 0.) {
+    // Choose the cell size such that there is about one point per cell.
+    double xmin = xp[0], xmax = xp[0];
+    double ymin = yp[0], ymax = yp[0];
+    double zmin = zp[0], zmax = zp[0];
+    for (int i = nPoints; i--;) {
+      xmin = std::min(xmin, xp[i]); xmax = std::max(xmax, xp[i]);
+      ymin = std::min(ymin, yp[i]); ymax = std::max(ymax, yp[i]);
+      zmin = std::min(zmin, zp[i]); zmax = std::max(zmax, zp[i]);
+    }
+    double vol = 1.;
+    int nDim = 0;
+    if (xmax - xmin > Small) { vol *= xmax - xmin; ++nDim; }
+    if (ymax - ymin > Small) { vol *= ymax - ymin; ++nDim; }
+    if (zmax - zmin > Small) { vol *= zmax - zmin; ++nDim; }
+    cell = nDim > 0 ? pow(vol / nPoints, 1. / nDim) : 1.;
+  }
+
+  // Count the points in each bucket, then fill the lists.
+  nBuckets = 2 * nPoints + 1;
+  std::vector<int> bucket(nPoints, 0);
+  bucketStart.assign(nBuckets + 1, 0);
+  for (int i = 0; i < nPoints; ++i) {
+    bucket[i] = Bucket(CellIndex(xp[i]), CellIndex(yp[i]), CellIndex(zp[i]));
+    ++bucketStart[bucket[i] + 1];
+  }
+  for (int b = 0; b < nBuckets; ++b) bucketStart[b + 1] += bucketStart[b];
+  entries.resize(nPoints);
+  std::vector<int> next(bucketStart.begin(), bucketStart.end() - 1);
+  for (int i = 0; i < nPoints; ++i) entries[next[bucket[i]]++] = i;
+
+}
+
+bool
+SpatialHash::FindNearest(const double x, const double y, const double z,
+                         const double rmax, int& index, double& dist) const {
+
+  index = -1;
+  dist = rmax;
+  if (xp.empty() || rmax <= 0.) return false;
+
+  double d2 = rmax * rmax;
+  // Points within rmax are at most this many cells away.
+  const double nShells = rmax / cell + 1.;
+  if (nShells > nMaxShells) {
+    for (int i = xp.size(); i--;) {
+      const double dx = xp[i] - x, dy = yp[i] - y, dz = zp[i] - z;
+      const double r2 = dx * dx + dy * dy + dz * dz;
+      if (r2 < d2) {
+        d2 = r2;
+        index = i;
+      }
+    }
+  } else {
+    const int ix = CellIndex(x), iy = CellIndex(y), iz = CellIndex(z);
+    for (int k = 0; k <= int(nShells); ++k) {
+      SearchShell(x, y, z, ix, iy, iz, k, index, d2);
+      if (index >= 0 && d2 <= k * k * cell * cell) break;
+    }
+  }
+  if (index < 0 || d2 >= rmax * rmax) {
+    index = -1;
+    return false;
+  }
+  dist = sqrt(d2);
+  return true;
+
+}
+
+bool
+SpatialHash::FindNearest(const double x, const double y, const double z,
+                         int& index, double& dist) const {
+
+  index = -1;
+  dist = 0.;
+  if (xp.empty()) return false;
+
+  double d2 = 0.;
+  const int ix = CellIndex(x), iy = CellIndex(y), iz = CellIndex(z);
+  for (int k = 0; k <= nMaxShells; ++k) {
+    SearchShell(x, y, z, ix, iy, iz, k, index, d2);
+    // All points not seen so far are further away than k cells.
+    if (index >= 0 && d2 <= k * k * cell * cell) {
+      dist = sqrt(d2);
+      return true;
+    }
+  }
+
+  // Nothing close by, loop over all points.
+  for (int i = xp.size(); i--;) {
+    const double dx = xp[i] - x, dy = yp[i] - y, dz = zp[i] - z;
+    const double r2 = dx * dx + dy * dy + dz * dz;
+    if (index < 0 || r2 < d2) {
+      d2 = r2;
+      index = i;
+    }
+  }
+  dist = sqrt(d2);
+  return true;
+
+}
+
+int
+SpatialHash::CellIndex(const double u) const {
+
+  const double c = floor(u / cell);
+  if (c > 1.e9) return 1000000000;
+  if (c < -1.e9) return -1000000000;
+  return int(c);
+
+}
+
+int
+SpatialHash::Bucket(const int ix, const int iy, const int iz) const {
+
+  const unsigned int h = (unsigned(ix) * 73856093u) ^
+                         (unsigned(iy) * 19349663u) ^
+                         (unsigned(iz) * 83492791u);
+  return h % nBuckets;
+
+}
+
+void
+SpatialHash::SearchShell(const double x, const double y, const double z,
+                         const int ix, const int iy, const int iz, const int k,
+                         int& index, double& d2) const {
+
+  for (int jx = -k; jx <= k; ++jx) {
+    for (int jy = -k; jy <= k; ++jy) {
+      // Only the surface of the cube at distance k.
+      const bool inner = abs(jx) < k && abs(jy) < k;
+      const int step = inner ? 2 * k : 1;
+      for (int jz = -k; jz <= k; jz += step) {
+        const int b = Bucket(ix + jx, iy + jy, iz + jz);
+        for (int l = bucketStart[b]; l < bucketStart[b + 1]; ++l) {
+          const int i = entries[l];
+          const double dx = xp[i] - x, dy = yp[i] - y, dz = zp[i] - z;
+          const double r2 = dx * dx + dy * dy + dz * dz;
+          if (index < 0 || r2 < d2) {
+            d2 = r2;
+            index = i;
+          }
+        }
+      }
+    }
+  }
+
+}
+
+}
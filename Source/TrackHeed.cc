@@ -1,4 +1,5 @@
 #include <iostream>
+#include <sstream>
 
 #include "wcpplib/matter/GasLib.h"
 #include "wcpplib/matter/MatterDef.h"
@@ -33,13 +34,17 @@ namespace HeedInterface {
   bool useEfield;
   bool useBfield;
 
+  // Particle counter of the track whose state is loaded
+  long* particleNumber = 0;
+
 }
 
 }
 
 // Global functions and variables required by Heed
-BlkArr<HeedCluster> cluster_bank;
-AbsList<ActivePtr<gparticle> > particle_bank;
+// (pointing to the banks of the active TrackHeed instance)
+BlkArr<HeedCluster>* cluster_bank = 0;
+AbsList<ActivePtr<gparticle> >* particle_bank = 0;
 
 void 
 field_map(const point& pt, vec& efield, vec& bfield, vfloat& mrange) {
@@ -100,8 +105,17 @@ double mparticle::speed_of_light=c_light;
 
 namespace Garfield {
 
+struct TrackHeed::heedState {
+  BlkArr<HeedCluster> clusterBank;
+  AbsList<ActivePtr<gparticle> > particleBank;
+  long lastParticleNumber;
+};
+
+int TrackHeed::nInstances = 0;
+
 TrackHeed::TrackHeed() : 
   ready(false), hasActiveTrack(false),
+  state(0), useEfield(false), useBfield(false), instanceId(nInstances++),
   mediumDensity(-1.), mediumName(""),
   usePhotonReabsorption(true),
   usePacsOutput(false),
@@ -116,9 +130,8 @@ TrackHeed::TrackHeed() :
  
   className = "TrackHeed";
  
-  HeedInterface::sensor = 0;
-  HeedInterface::useEfield = false;
-  HeedInterface::useBfield = false;
+  state = new heedState();
+  state->lastParticleNumber = 0;
   
   deltaElectrons.clear();
   
@@ -140,7 +153,46 @@ TrackHeed::~TrackHeed() {
   if (deltaCs    != 0) delete deltaCs;
   if (chamber    != 0) delete chamber;
   
-  Garfield::HeedInterface::sensor = 0;
+  // Unload the state if this track is the active one.
+  if (HeedInterface::particleNumber == &state->lastParticleNumber) {
+    HeedInterface::particleNumber = 0;
+    HeedInterface::sensor = 0;
+    particle_bank = 0;
+    cluster_bank = 0;
+  }
+  delete state;
+
+}
+
+void
+TrackHeed::Activate() {
+
+  // Save the particle counter of the previously active track 
+  // and load the one of this track.
+  if (HeedInterface::particleNumber != &state->lastParticleNumber) {
+    if (HeedInterface::particleNumber != 0) {
+      *HeedInterface::particleNumber = last_particle_number;
+    }
+    last_particle_number = state->lastParticleNumber;
+    HeedInterface::particleNumber = &state->lastParticleNumber;
+  }
+  particle_bank = &state->particleBank;
+  cluster_bank = &state->clusterBank;
+  HeedInterface::sensor = sensor;
+  HeedInterface::useEfield = useEfield;
+  HeedInterface::useBfield = useBfield;
+
+}
+
+std::string
+TrackHeed::GetMatterName(const std::string& name) const {
+
+  // Matter definitions are registered by name in Heed, 
+  // append the instance number to keep them apart.
+  if (instanceId == 0) return name;
+  std::ostringstream ss;
+  ss << name << "_" << instanceId;
+  return ss.str();
 
 }
 
@@ -151,6 +203,7 @@ TrackHeed::NewTrack(
 
   hasActiveTrack = false;
   ready = false;
+  Activate();
  
   // Make sure the sensor has been set.
   if (sensor == 0) {
@@ -208,8 +261,6 @@ TrackHeed::NewTrack(
     std::cout << "      z: " << cZ << " cm\n";
   }
   
-  HeedInterface::sensor = sensor;
-  
   // Make sure the initial position is inside an ionisable medium.
   Medium* medium;
   if (!sensor->GetMedium(x0, y0, z0, medium)) {
@@ -237,9 +288,9 @@ TrackHeed::NewTrack(
     mediumDensity = medium->GetMassDensity();
   }
   
-  particle_bank.clear();
+  particle_bank->clear();
   deltaElectrons.clear();
-  cluster_bank.allocate_block(100);
+  cluster_bank->allocate_block(100);
   chamber->conduction_electron_bank.allocate_block(1000);
   
   // Check the direction vector.
@@ -384,6 +435,7 @@ TrackHeed::GetCluster(double& xcls, double& ycls, double& zcls,
   extra = 0.;
   n = 0;
   e = 0.;
+  Activate();
   
   // Make sure NewTrack has successfully been called. 
   if (!ready) {
@@ -405,7 +457,7 @@ TrackHeed::GetCluster(double& xcls, double& ycls, double& zcls,
   HeedPhoton* virtualPhoton = 0;
   while (!ok) {
     // Get the first element from the particle bank.
-    node = particle_bank.get_first_node();
+    node = particle_bank->get_first_node();
   
     // Make sure the particle bank is not empty.
     if (node == 0) {
@@ -420,7 +472,7 @@ TrackHeed::GetCluster(double& xcls, double& ycls, double& zcls,
       std::cerr << "    Particle is not a virtual photon.\n";
       std::cerr << "    Program bug!\n";
       // Delete the node.
-      particle_bank.erase(node);
+      particle_bank->erase(node);
       // Try the next node.
       continue;
     }
@@ -429,7 +481,7 @@ TrackHeed::GetCluster(double& xcls, double& ycls, double& zcls,
       std::cerr << className << "::GetCluster:\n";
       std::cerr << "    Virtual photon has an unexpected parent.\n";
       // Delete this virtual photon.
-      particle_bank.erase(node);
+      particle_bank->erase(node);
       continue;
     }
     // Get the location of the interaction (convert from mm to cm
@@ -441,13 +493,13 @@ TrackHeed::GetCluster(double& xcls, double& ycls, double& zcls,
     // Make sure the cluster is inside the drift area.
     if (!sensor->IsInArea(xcls, ycls, zcls)) {
       // Delete this virtual photon and proceed with the next one.
-      particle_bank.erase(node);
+      particle_bank->erase(node);
       continue;
     }
     // Make sure the cluster is inside a medium.
     if (!sensor->GetMedium(xcls, ycls, zcls, medium)) {
       // Delete this virtual photon and proceed with the next one.
-      particle_bank.erase(node);
+      particle_bank->erase(node);
       continue;
     }
     // Make sure the medium has not changed.
@@ -455,7 +507,7 @@ TrackHeed::GetCluster(double& xcls, double& ycls, double& zcls,
         fabs(medium->GetMassDensity() - mediumDensity) > 1.e-9 || 
         !medium->IsIonisable()) {
       // Delete this virtual photon and proceed with the next one.
-      particle_bank.erase(node);
+      particle_bank->erase(node);
       continue;
     }
     // Seems to be ok.
@@ -539,7 +591,7 @@ TrackHeed::GetCluster(double& xcls, double& ycls, double& zcls,
     // Proceed with the next node in the particle bank.
     if (deleteNode) {
       tempNode = nextNode->get_next_node();
-      particle_bank.erase(nextNode);
+      particle_bank->erase(nextNode);
       nextNode = tempNode;
     } else {
       nextNode = nextNode->get_next_node();
@@ -554,7 +606,7 @@ TrackHeed::GetCluster(double& xcls, double& ycls, double& zcls,
   }
   
   // Remove the virtual photon from the particle bank.
-  particle_bank.erase(node);
+  particle_bank->erase(node);
 
   return true;
 
@@ -619,6 +671,7 @@ TrackHeed::TransportDeltaElectron(
       int& nel) {
 
   nel = 0;
+  Activate();
 
   // Check if delta electron transport was disabled.
   if (!useDelta) {
@@ -669,8 +722,6 @@ TrackHeed::TransportDeltaElectron(
   cY = 0.5 * (ymin + ymax);
   cZ = 0.5 * (zmin + zmax);
   
-  HeedInterface::sensor = sensor;
-  
   // Make sure the initial position is inside an ionisable medium.
   Medium* medium;
   if (!sensor->GetMedium(x0, y0, z0, medium)) {
@@ -747,6 +798,7 @@ TrackHeed::TransportPhoton(
           int& nel) {
  
   nel = 0;
+  Activate();
 
   // Make sure the energy is positive.
   if (e0 <= 0.) {
@@ -790,8 +842,6 @@ TrackHeed::TransportPhoton(
   cY = 0.5 * (ymin + ymax);
   cZ = 0.5 * (zmin + zmax);
   
-  HeedInterface::sensor = sensor;
-  
   // Make sure the initial position is inside an ionisable medium.
   Medium* medium;
   if (!sensor->GetMedium(x0, y0, z0, medium)) {
@@ -825,7 +875,7 @@ TrackHeed::TransportPhoton(
   // Clusters from the current track will be lost.
   hasActiveTrack = false;
   last_particle_number = 0;
-  particle_bank.clear();
+  particle_bank->clear();
   deltaElectrons.clear();
   nDeltas = 0;
   chamber->conduction_electron_bank.allocate_block(1000);
@@ -869,7 +919,7 @@ TrackHeed::TransportPhoton(
   
   // Get the first element from the particle bank.
   AbsListNode<ActivePtr<gparticle> >* nextNode = 
-                                      particle_bank.get_first_node();
+                                      particle_bank->get_first_node();
   AbsListNode<ActivePtr<gparticle> >* tempNode = 0;
   // Loop over the particle bank.
   while (nextNode != 0) {
@@ -926,7 +976,7 @@ TrackHeed::TransportPhoton(
     }
     // Proceed with the next node in the particle bank.
     tempNode = nextNode->get_next_node();
-    particle_bank.erase(nextNode);
+    particle_bank->erase(nextNode);
     nextNode = tempNode;
   }
   
@@ -942,28 +992,28 @@ TrackHeed::TransportPhoton(
 void
 TrackHeed::EnableElectricField() {
 
-  HeedInterface::useEfield = true;
+  useEfield = true;
   
 }
 
 void
 TrackHeed::DisableElectricField() {
 
-  HeedInterface::useEfield = false;
+  useEfield = false;
   
 }
 
 void
 TrackHeed::EnableMagneticField() {
 
-  HeedInterface::useBfield = true;
+  useBfield = true;
   
 }
 
 void
 TrackHeed::DisableMagneticField() {
 
-  HeedInterface::useBfield = false;
+  useBfield = false;
 
 }
 
@@ -1204,7 +1254,7 @@ TrackHeed::SetupGas(Medium* medium) {
     pacsfile.close();
   }  
 
-  std::string gasname = medium->GetName();
+  std::string gasname = GetMatterName(medium->GetName());
   if (gas != 0) {
     delete gas; gas = 0;
   }
@@ -1280,7 +1330,7 @@ TrackHeed::SetupMaterial(Medium* medium) {
   if (material != 0) {
     delete material; material = 0;
   }
-  std::string materialName = medium->GetName();
+  std::string materialName = GetMatterName(medium->GetName());
   material = new MatterDef(materialName, materialName, nComponents,
                            notations, fractions, density, temperature);
 